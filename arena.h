@@ -0,0 +1,154 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Bump allocator for objects sharing one lifetime, e.g. everything set up
+ * for one frame or one connection. Allocation only advances an offset and
+ * everything is released at once with arena_reset() or back to a mark, so
+ * there is no per-object free and no fragmentation. Not thread-safe: use
+ * one arena per thread.
+ */
+
+/**
+ * Macro to declare the storage of an arena.
+ * @name: Name of the buffer.
+ * @size: Size of the arena in bytes.
+ */
+#define DECLARE_ARENA_BUFFER(name, size) \
+	_Alignas(max_align_t) uint8_t name[(size)]
+
+/**
+ * struct arena - Bump allocator
+ * @buffer: pointer to the arena storage
+ * @size: size of the storage in bytes
+ * @used: offset of the first free byte
+ */
+struct arena {
+	uint8_t *buffer;
+	size_t size;
+	size_t used;
+};
+
+/**
+ * arena_init - Initialize an empty arena
+ * @arena: pointer to the arena structure
+ * @buffer: storage, declared with DECLARE_ARENA_BUFFER()
+ * @size: size of @buffer in bytes
+ */
+static inline void arena_init(struct arena *arena, uint8_t *buffer, size_t size)
+{
+	arena->buffer = buffer;
+	arena->size = size;
+	arena->used = 0;
+}
+
+/**
+ * arena_alloc_aligned - Allocate memory from the arena
+ * @arena: pointer to the arena structure
+ * @size: number of bytes to allocate
+ * @align: alignment of the allocation, a power of two
+ *
+ * Return: pointer to the memory, or NULL if the arena is exhausted or
+ *         @align is not a power of two
+ */
+static inline void *arena_alloc_aligned(struct arena *arena, size_t size, size_t align)
+{
+	uintptr_t base = (uintptr_t)arena->buffer;
+	uintptr_t start;
+
+	if (!align || (align & (align - 1)))
+		return NULL;
+
+	start = (base + arena->used + align - 1) & ~(uintptr_t)(align - 1);
+
+	if (start - base > arena->size || size > arena->size - (start - base))
+		return NULL;
+
+	arena->used = start - base + size;
+
+	return (void *)start;
+}
+
+/**
+ * arena_alloc - Allocate memory suitably aligned for any object type
+ * @arena: pointer to the arena structure
+ * @size: number of bytes to allocate
+ *
+ * Return: pointer to the memory, or NULL if the arena is exhausted
+ */
+static inline void *arena_alloc(struct arena *arena, size_t size)
+{
+	return arena_alloc_aligned(arena, size, _Alignof(max_align_t));
+}
+
+/**
+ * arena_mark - Remember the current fill level of the arena
+ * @arena: pointer to the arena structure
+ *
+ * Return: mark to pass to arena_release()
+ */
+static inline size_t arena_mark(const struct arena *arena)
+{
+	return arena->used;
+}
+
+/**
+ * arena_release - Free everything allocated since a mark
+ * @arena: pointer to the arena structure
+ * @mark: value returned by arena_mark()
+ */
+static inline void arena_release(struct arena *arena, size_t mark)
+{
+	if (mark < arena->used)
+		arena->used = mark;
+}
+
+/**
+ * arena_reset - Free everything allocated from the arena
+ * @arena: pointer to the arena structure
+ */
+static inline void arena_reset(struct arena *arena)
+{
+	arena->used = 0;
+}
+
+/**
+ * arena_available - Get the number of bytes left in the arena
+ * @arena: pointer to the arena structure
+ *
+ * Return: number of free bytes, ignoring alignment padding
+ */
+static inline size_t arena_available(const struct arena *arena)
+{
+	return arena->size - arena->used;
+}
+
+#endif /* ARENA_H */
@@ -0,0 +1,597 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Benchmark harness for the containers. Every scenario prints one JSON
+ * object per line with its throughput and latency percentiles, so runs can
+ * be collected and compared over time. See the Benchmarks section of the
+ * README for how to build it; the compile-time options of the containers
+ * in effect are reported in the "config" field.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "container_of.h"
+#include "message_queue_core.h"
+#include "mpmc_message_queue.h"
+#include "prio_message_queue.h"
+#include "priority_queue.h"
+#include "ring_buffer.h"
+#include "timer.h"
+#include "histogram.h"
+
+/*
+ * The list engine pops in O(n), which makes the storm sizes used here take
+ * hours rather than seconds.
+ */
+#ifdef PQ_USE_LIST_HEAP
+#error "the benchmarks need the array heap engine, build without -DPQ_USE_LIST_HEAP"
+#endif
+
+#define BENCH_MESSAGE_SIZE 32
+#define BENCH_QUEUE_SLOTS 1024
+#define BENCH_RING_SIZE (64 * 1024)
+#define BENCH_RING_CHUNK 64
+#define BENCH_BATCH 16
+#define BENCH_MPMC_THREADS 2
+
+#define BENCH_STRINGIFY_(x) #x
+#define BENCH_STRINGIFY(x) BENCH_STRINGIFY_(x)
+
+static const char bench_config[] = ""
+    "PQ_HEAP_ARITY=" BENCH_STRINGIFY(PQ_HEAP_ARITY) " "
+#ifdef PQ_INLINE_KEY
+    "PQ_INLINE_KEY "
+#endif
+#ifdef RING_BUFFER_SPSC
+    "RING_BUFFER_SPSC "
+#endif
+#ifdef MESSAGE_QUEUE_SPSC
+    "MESSAGE_QUEUE_SPSC "
+#endif
+#ifdef RING_BUFFER_FREE_RUNNING
+    "RING_BUFFER_FREE_RUNNING "
+#endif
+#ifdef TIMER_USE_WHEEL
+    "TIMER_USE_WHEEL "
+#endif
+#ifdef QUEUE_CACHE_LINE_LAYOUT
+    "QUEUE_CACHE_LINE_LAYOUT "
+#endif
+#if defined(RING_BUFFER_STATS) || defined(MESSAGE_QUEUE_STATS) || defined(PQ_STATS) || defined(TIMER_STATS)
+    "STATS "
+#endif
+    "";
+
+static struct {
+    uint64_t count;
+    uint64_t timers;
+    int producer_cpu;
+    int consumer_cpu;
+    const char *filter;
+} options = { 100000, 1000000, 0, 1, NULL };
+
+/*
+ * Time source: the TSC on x86, calibrated once against CLOCK_MONOTONIC,
+ * otherwise CLOCK_MONOTONIC directly. Both are consistent across cores, so
+ * timestamps may be taken on one thread and compared on another.
+ */
+static double bench_ns_per_tick = 1.0;
+
+static inline uint64_t bench_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static uint64_t bench_monotonic_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void bench_calibrate(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    struct timespec pause = { 0, 50 * 1000 * 1000 };
+    uint64_t ns = bench_monotonic_ns();
+    uint64_t ticks = bench_now();
+
+    nanosleep(&pause, NULL);
+    bench_ns_per_tick = (double)(bench_monotonic_ns() - ns) / (double)(bench_now() - ticks);
+#endif
+}
+
+static bool bench_selected(const char *name)
+{
+    return !options.filter || strstr(name, options.filter);
+}
+
+static void bench_pin(int cpu)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t set;
+
+    if (cpu < 0 || cpus <= 0) {
+        return;
+    }
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu % cpus, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/* Print one result line, latencies are kept in time source ticks */
+static void bench_report(const char *name, uint64_t n, uint64_t ops, uint64_t elapsed, const struct histogram *h)
+{
+    double seconds = (double)elapsed * bench_ns_per_tick / 1e9;
+
+    printf("{\"bench\":\"%s\",\"config\":\"%s\",\"n\":%llu,\"ops\":%llu,\"seconds\":%.6f,\"mops\":%.3f,"
+           "\"p50_ns\":%.1f,\"p99_ns\":%.1f,\"p999_ns\":%.1f,\"max_ns\":%.1f}\n",
+           name, bench_config, (unsigned long long)n, (unsigned long long)ops, seconds,
+           seconds > 0 ? (double)ops / seconds / 1e6 : 0.0,
+           (double)histogram_percentile(h, 50.0) * bench_ns_per_tick,
+           (double)histogram_percentile(h, 99.0) * bench_ns_per_tick,
+           (double)histogram_percentile(h, 99.9) * bench_ns_per_tick, (double)h->max * bench_ns_per_tick);
+    fflush(stdout);
+}
+
+static uint64_t bench_random(uint64_t *state)
+{
+    /* xorshift64, good enough for keys and delays */
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* Single-threaded scenarios */
+
+struct bench_item {
+    uint64_t key;
+    struct heap_node node;
+};
+
+static int bench_item_compare(struct heap_node *a, struct heap_node *b)
+{
+    uint64_t key_a = CONTAINER_OF(a, struct bench_item, node)->key;
+    uint64_t key_b = CONTAINER_OF(b, struct bench_item, node)->key;
+
+    return (key_a < key_b) - (key_a > key_b);
+}
+
+static void bench_priority_queue(void)
+{
+    static struct histogram insert, pop;
+    struct bench_item *items = calloc(options.count, sizeof(*items));
+    struct priority_queue pq;
+    uint64_t state = 88172645463325252ull;
+
+    if (!items) {
+        return;
+    }
+
+    histogram_reset(&insert);
+    histogram_reset(&pop);
+    pq_init(&pq, bench_item_compare);
+
+    uint64_t start = bench_now();
+    for (uint64_t i = 0; i < options.count; i++) {
+        items[i].key = bench_random(&state) % (options.count * 4);
+#ifdef PQ_INLINE_KEY
+        items[i].node.key = items[i].key;
+#endif
+        items[i].node.index = PQ_INDEX_NONE;
+        uint64_t t0 = bench_now();
+        pq_insert(&pq, &items[i].node);
+        pq_reorder(&pq);
+        histogram_record(&insert, bench_now() - t0);
+    }
+    uint64_t middle = bench_now();
+
+    for (uint64_t i = 0; i < options.count; i++) {
+        uint64_t t0 = bench_now();
+        pq_pop(&pq);
+        histogram_record(&pop, bench_now() - t0);
+    }
+    uint64_t end = bench_now();
+
+    bench_report("pq_insert_reorder", options.count, options.count, middle - start, &insert);
+    bench_report("pq_pop", options.count, options.count, end - middle, &pop);
+
+    pq_deinit(&pq);
+    free(items);
+}
+
+static void bench_ring_buffer(void)
+{
+    static uint8_t storage[BENCH_RING_SIZE];
+    static struct histogram write, read;
+    uint8_t chunk[BENCH_RING_CHUNK] = { 0 };
+    struct ring_buffer rb;
+
+    histogram_reset(&write);
+    histogram_reset(&read);
+    ring_buffer_init(&rb, storage, sizeof(storage));
+
+    uint64_t start = bench_now();
+    for (uint64_t i = 0; i < options.count; i++) {
+        uint64_t t0 = bench_now();
+        ring_buffer_copy_from_stream(&rb, chunk, sizeof(chunk));
+        uint64_t t1 = bench_now();
+        ring_buffer_copy_to_stream(&rb, chunk, sizeof(chunk));
+        uint64_t t2 = bench_now();
+
+        histogram_record(&write, t1 - t0);
+        histogram_record(&read, t2 - t1);
+    }
+    uint64_t end = bench_now();
+
+    bench_report("ring_buffer_copy_from_stream", BENCH_RING_CHUNK, options.count, end - start, &write);
+    bench_report("ring_buffer_copy_to_stream", BENCH_RING_CHUNK, options.count, end - start, &read);
+}
+
+static void bench_message_queue(void)
+{
+    static DECLARE_MESSAGE_QUEUE_BUFFER(BENCH_QUEUE_SLOTS, BENCH_MESSAGE_SIZE);
+    static struct histogram push, pop, batch;
+    uint8_t message[BENCH_BATCH][BENCH_MESSAGE_SIZE] = { { 0 } };
+    struct message_queue mq;
+
+    histogram_reset(&push);
+    histogram_reset(&pop);
+    histogram_reset(&batch);
+    message_queue_init(&mq, buffer, BENCH_MESSAGE_SIZE, BENCH_QUEUE_SLOTS);
+
+    uint64_t start = bench_now();
+    for (uint64_t i = 0; i < options.count; i++) {
+        uint64_t t0 = bench_now();
+        message_queue_push(&mq, message[0]);
+        uint64_t t1 = bench_now();
+        message_queue_pop(&mq, message[0]);
+        uint64_t t2 = bench_now();
+
+        histogram_record(&push, t1 - t0);
+        histogram_record(&pop, t2 - t1);
+    }
+    uint64_t middle = bench_now();
+
+    for (uint64_t i = 0; i < options.count / BENCH_BATCH; i++) {
+        uint64_t t0 = bench_now();
+        message_queue_push_n(&mq, message, BENCH_BATCH);
+        message_queue_pop_n(&mq, message, BENCH_BATCH);
+        histogram_record(&batch, bench_now() - t0);
+    }
+    uint64_t end = bench_now();
+
+    bench_report("message_queue_push", BENCH_MESSAGE_SIZE, options.count, middle - start, &push);
+    bench_report("message_queue_pop", BENCH_MESSAGE_SIZE, options.count, middle - start, &pop);
+    bench_report("message_queue_push_pop_n16", BENCH_MESSAGE_SIZE, options.count / BENCH_BATCH * BENCH_BATCH,
+                 end - middle, &batch);
+}
+
+static void bench_prio_message_queue(void)
+{
+    static DECLARE_PRIO_MESSAGE_QUEUE_BUFFER(BENCH_QUEUE_SLOTS, BENCH_MESSAGE_SIZE);
+    static struct histogram push, pop;
+    uint8_t message[BENCH_MESSAGE_SIZE] = { 0 };
+    struct prio_message_queue mq;
+
+    histogram_reset(&push);
+    histogram_reset(&pop);
+    prio_message_queue_init(&mq, buffer, BENCH_MESSAGE_SIZE, BENCH_QUEUE_SLOTS);
+
+    uint64_t start = bench_now();
+    for (uint64_t i = 0; i < options.count; i++) {
+        uint64_t t0 = bench_now();
+        prio_message_queue_push(&mq, message, (uint32_t)(i % PRIO_MESSAGE_QUEUE_BANDS));
+        uint64_t t1 = bench_now();
+        prio_message_queue_pop(&mq, message, NULL);
+        uint64_t t2 = bench_now();
+
+        histogram_record(&push, t1 - t0);
+        histogram_record(&pop, t2 - t1);
+    }
+    uint64_t end = bench_now();
+
+    bench_report("prio_message_queue_push", BENCH_MESSAGE_SIZE, options.count, end - start, &push);
+    bench_report("prio_message_queue_pop", BENCH_MESSAGE_SIZE, options.count, end - start, &pop);
+}
+
+/* Threaded scenarios, latency is measured from push to pop */
+
+struct bench_record {
+    uint64_t stamp;
+    uint64_t sequence;
+};
+
+#ifdef RING_BUFFER_SPSC
+
+static struct ring_buffer bench_spsc_rb;
+
+static void *bench_spsc_producer(void *arg)
+{
+    struct bench_record record = { 0, 0 };
+
+    (void)arg;
+    bench_pin(options.producer_cpu);
+
+    for (uint64_t i = 0; i < options.count; i++) {
+        record.sequence = i;
+        record.stamp = bench_now();
+        while (ring_buffer_copy_from_stream(&bench_spsc_rb, (const uint8_t *)&record, sizeof(record)) < 0) {
+            sched_yield();
+            record.stamp = bench_now();
+        }
+    }
+
+    return NULL;
+}
+
+static void bench_spsc_ring_buffer(void)
+{
+    static uint8_t storage[BENCH_RING_SIZE];
+    static struct histogram latency;
+    struct bench_record record;
+    pthread_t producer;
+
+    histogram_reset(&latency);
+    ring_buffer_init(&bench_spsc_rb, storage, sizeof(storage));
+
+    uint64_t start = bench_now();
+    pthread_create(&producer, NULL, bench_spsc_producer, NULL);
+    bench_pin(options.consumer_cpu);
+
+    for (uint64_t i = 0; i < options.count; i++) {
+        while (ring_buffer_copy_to_stream(&bench_spsc_rb, (uint8_t *)&record, sizeof(record)) < 0) {
+            sched_yield();
+        }
+        histogram_record(&latency, bench_now() - record.stamp);
+    }
+
+    uint64_t end = bench_now();
+    pthread_join(producer, NULL);
+    bench_pin(-1);
+
+    bench_report("ring_buffer_spsc_pair", sizeof(record), options.count, end - start, &latency);
+}
+
+#endif /* RING_BUFFER_SPSC */
+
+static struct mpmc_message_queue bench_mpmc;
+static atomic_uint_fast64_t bench_mpmc_consumed;
+static struct histogram bench_mpmc_latency[BENCH_MPMC_THREADS];
+
+static void *bench_mpmc_producer(void *arg)
+{
+    long id = (long)arg;
+    struct bench_record record = { 0, 0 };
+
+    bench_pin(options.producer_cpu + (int)id * 2);
+
+    for (uint64_t i = 0; i < options.count / BENCH_MPMC_THREADS; i++) {
+        record.sequence = i;
+        record.stamp = bench_now();
+        while (mpmc_message_queue_push(&bench_mpmc, &record) < 0) {
+            sched_yield();
+            record.stamp = bench_now();
+        }
+    }
+
+    return NULL;
+}
+
+static void *bench_mpmc_consumer(void *arg)
+{
+    long id = (long)arg;
+    uint64_t total = options.count / BENCH_MPMC_THREADS * BENCH_MPMC_THREADS;
+    struct bench_record record;
+
+    bench_pin(options.consumer_cpu + (int)id * 2);
+
+    while (atomic_load_explicit(&bench_mpmc_consumed, memory_order_relaxed) < total) {
+        if (mpmc_message_queue_pop(&bench_mpmc, &record) < 0) {
+            sched_yield();
+            continue;
+        }
+
+        histogram_record(&bench_mpmc_latency[id], bench_now() - record.stamp);
+        atomic_fetch_add_explicit(&bench_mpmc_consumed, 1, memory_order_relaxed);
+    }
+
+    return NULL;
+}
+
+static void bench_mpmc_message_queue(void)
+{
+    static DECLARE_MPMC_MESSAGE_QUEUE_BUFFER(BENCH_QUEUE_SLOTS, sizeof(struct bench_record));
+    static struct histogram latency;
+    pthread_t producers[BENCH_MPMC_THREADS], consumers[BENCH_MPMC_THREADS];
+
+    histogram_reset(&latency);
+    mpmc_message_queue_init(&bench_mpmc, buffer, sizeof(struct bench_record), BENCH_QUEUE_SLOTS);
+    atomic_store(&bench_mpmc_consumed, 0);
+
+    uint64_t start = bench_now();
+    for (long i = 0; i < BENCH_MPMC_THREADS; i++) {
+        histogram_reset(&bench_mpmc_latency[i]);
+        pthread_create(&consumers[i], NULL, bench_mpmc_consumer, (void *)i);
+        pthread_create(&producers[i], NULL, bench_mpmc_producer, (void *)i);
+    }
+
+    for (int i = 0; i < BENCH_MPMC_THREADS; i++) {
+        pthread_join(producers[i], NULL);
+        pthread_join(consumers[i], NULL);
+        histogram_merge(&latency, &bench_mpmc_latency[i]);
+    }
+    uint64_t end = bench_now();
+
+    bench_report("mpmc_message_queue_2x2", sizeof(struct bench_record), latency.total, end - start, &latency);
+}
+
+/* Timer storm: many timers armed at once, then ticked until all fired */
+
+static uint64_t bench_timers_fired;
+
+static void bench_timer_callback(struct timer *timer, void *data)
+{
+    (void)timer;
+    (void)data;
+    bench_timers_fired++;
+}
+
+static void bench_timer_storm(uint64_t count)
+{
+    static struct histogram start_latency, tick_latency;
+    static struct timer_base base;
+    struct timer *timers = calloc(count, sizeof(*timers));
+    uint64_t state = 2463534242ull;
+    uint64_t ticks = 0;
+
+    if (!timers) {
+        return;
+    }
+
+    histogram_reset(&start_latency);
+    histogram_reset(&tick_latency);
+    timer_base_init(&base);
+    bench_timers_fired = 0;
+
+    uint64_t start = bench_now();
+    for (uint64_t i = 0; i < count; i++) {
+        timer_init(&timers[i], bench_timer_callback, NULL);
+
+        uint64_t t0 = bench_now();
+        timer_start_on(&base, &timers[i], 1 + bench_random(&state) % 1024, false);
+        histogram_record(&start_latency, bench_now() - t0);
+    }
+    uint64_t middle = bench_now();
+
+    while (bench_timers_fired < count) {
+        uint64_t t0 = bench_now();
+        timer_increment_tick_on(&base);
+        histogram_record(&tick_latency, bench_now() - t0);
+        ticks++;
+    }
+    uint64_t end = bench_now();
+
+    bench_report("timer_storm_start", count, count, middle - start, &start_latency);
+    bench_report("timer_storm_tick", count, ticks, end - middle, &tick_latency);
+
+    timer_base_deinit(&base);
+    free(timers);
+}
+
+static void bench_usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [-n count] [-t max_timers] [-p producer_cpu] [-c consumer_cpu] [-s filter]\n"
+            "  -n  operations per scenario (default 100000)\n"
+            "  -t  largest timer storm, from 10^3 up by powers of ten (default 10^6)\n"
+            "  -p  CPU of the first producer thread (default 0)\n"
+            "  -c  CPU of the first consumer thread (default 1)\n"
+            "  -s  only run scenarios whose name contains filter\n",
+            argv0);
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:t:p:c:s:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            options.count = strtoull(optarg, NULL, 0);
+            break;
+        case 't':
+            options.timers = strtoull(optarg, NULL, 0);
+            break;
+        case 'p':
+            options.producer_cpu = atoi(optarg);
+            break;
+        case 'c':
+            options.consumer_cpu = atoi(optarg);
+            break;
+        case 's':
+            options.filter = optarg;
+            break;
+        default:
+            bench_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (!options.count) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    bench_calibrate();
+
+    if (bench_selected("pq")) {
+        bench_priority_queue();
+    }
+    if (bench_selected("ring_buffer")) {
+        bench_ring_buffer();
+    }
+    if (bench_selected("message_queue")) {
+        bench_message_queue();
+    }
+    if (bench_selected("prio_message_queue")) {
+        bench_prio_message_queue();
+    }
+#ifdef RING_BUFFER_SPSC
+    if (bench_selected("spsc")) {
+        bench_spsc_ring_buffer();
+    }
+#endif
+    if (bench_selected("mpmc")) {
+        bench_mpmc_message_queue();
+    }
+    if (bench_selected("timer_storm")) {
+        for (uint64_t count = 1000; count <= options.timers; count *= 10) {
+            bench_timer_storm(count);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BENCH_HISTOGRAM_H
+#define BENCH_HISTOGRAM_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Log-linear latency histogram in the style of HdrHistogram: values below
+ * 2^HISTOGRAM_SUB_BITS are counted exactly, larger ones in 2^HISTOGRAM_SUB_BITS
+ * buckets per power of two, bounding the relative error of any percentile
+ * to 1 / 2^HISTOGRAM_SUB_BITS. Recording is a couple of shifts and an add.
+ */
+
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_SUB_COUNT (1U << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT)
+
+/**
+ * struct histogram - Latency histogram
+ * @counts: Number of samples per bucket
+ * @total: Number of samples recorded
+ * @max: Largest sample recorded
+ */
+struct histogram {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+};
+
+static inline void histogram_reset(struct histogram *h)
+{
+    memset(h, 0, sizeof(*h));
+}
+
+static inline uint32_t histogram_bucket(uint64_t value)
+{
+    if (value < HISTOGRAM_SUB_COUNT) {
+        return (uint32_t)value;
+    }
+
+    uint32_t exponent = 63 - (uint32_t)__builtin_clzll(value);
+    uint32_t sub = (uint32_t)(value >> (exponent - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_COUNT - 1);
+
+    return (exponent - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT + sub;
+}
+
+/* Smallest value falling into @bucket */
+static inline uint64_t histogram_bucket_value(uint32_t bucket)
+{
+    if (bucket < HISTOGRAM_SUB_COUNT) {
+        return bucket;
+    }
+
+    uint32_t exponent = bucket / HISTOGRAM_SUB_COUNT + HISTOGRAM_SUB_BITS - 1;
+    uint64_t sub = bucket % HISTOGRAM_SUB_COUNT;
+
+    return (HISTOGRAM_SUB_COUNT + sub) << (exponent - HISTOGRAM_SUB_BITS);
+}
+
+static inline void histogram_record(struct histogram *h, uint64_t value)
+{
+    h->counts[histogram_bucket(value)]++;
+    h->total++;
+    if (value > h->max) {
+        h->max = value;
+    }
+}
+
+/* Merge the samples of @from into @into */
+static inline void histogram_merge(struct histogram *into, const struct histogram *from)
+{
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        into->counts[i] += from->counts[i];
+    }
+
+    into->total += from->total;
+    if (from->max > into->max) {
+        into->max = from->max;
+    }
+}
+
+/**
+ * histogram_percentile - Get the value below which a fraction of the samples fall
+ * @h: Pointer to the histogram
+ * @percentile: Percentile between 0 and 100
+ *
+ * Return: lower bound of the bucket holding the percentile, 0 if empty
+ */
+static inline uint64_t histogram_percentile(const struct histogram *h, double percentile)
+{
+    uint64_t rank = (uint64_t)((double)h->total * percentile / 100.0);
+    uint64_t seen = 0;
+
+    if (rank >= h->total) {
+        return h->max;
+    }
+
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen > rank) {
+            return histogram_bucket_value(i);
+        }
+    }
+
+    return h->max;
+}
+
+#endif /* BENCH_HISTOGRAM_H */
@@ -0,0 +1,360 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BYTE_SCAN_H
+#define BYTE_SCAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <string.h>
+#include "ring_buffer.h"
+
+/*
+ * Scanning and checksum kernels for buffered bytes, and ring buffer wrappers
+ * that run them over a range of buffered data in at most two contiguous
+ * pieces. The implementation is picked at compile time from the target
+ * flags: AVX2, SSE2 or NEON compares for byte search, SSE4.2 or ARMv8 CRC
+ * instructions for CRC-32C, SSE2 multiply-adds for Adler-32, and portable
+ * code everywhere else. Build with -march=native or the matching -m flags
+ * to get the vector paths.
+ */
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+/* Largest number of bytes whose Adler-32 sums fit in 32 bits before reduction */
+#define BYTE_SCAN_ADLER_NMAX 5552
+#define BYTE_SCAN_ADLER_BASE 65521U
+
+/**
+ * byte_scan_find - Find the first occurrence of a byte
+ * @data: pointer to the bytes to scan
+ * @length: number of bytes to scan
+ * @byte: value to look for
+ *
+ * Return: index of the first match, or @length if there is none
+ */
+static inline uint32_t byte_scan_find(const uint8_t *data, uint32_t length, uint8_t byte)
+{
+	uint32_t i = 0;
+
+#if defined(__AVX2__)
+	__m256i needle = _mm256_set1_epi8((char)byte);
+
+	for (; i + 32 <= length; i += 32) {
+		__m256i chunk = _mm256_loadu_si256((const __m256i *)(data + i));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+
+		if (mask)
+			return i + (uint32_t)__builtin_ctz(mask);
+	}
+#endif
+#if defined(__SSE2__)
+	__m128i needle16 = _mm_set1_epi8((char)byte);
+
+	for (; i + 16 <= length; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(data + i));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle16));
+
+		if (mask)
+			return i + (uint32_t)__builtin_ctz(mask);
+	}
+#elif defined(__ARM_NEON)
+	uint8x16_t needle16 = vdupq_n_u8(byte);
+
+	for (; i + 16 <= length; i += 16) {
+		uint8x16_t eq = vceqq_u8(vld1q_u8(data + i), needle16);
+		/* Narrow each byte of the compare result to a nibble of a 64-bit mask */
+		uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+
+		if (mask)
+			return i + (uint32_t)(__builtin_ctzll(mask) >> 2);
+	}
+#endif
+
+	const uint8_t *match = memchr(data + i, byte, length - i);
+
+	return match ? (uint32_t)(match - data) : length;
+}
+
+/**
+ * byte_scan_crc32c - Update a CRC-32C (Castagnoli) checksum
+ * @crc: checksum of the preceding bytes, 0 to start
+ * @data: pointer to the bytes to add
+ * @length: number of bytes to add
+ *
+ * Pre- and post-inversion are applied on each call, so a checksum can be
+ * computed piece by piece by passing the previous result as @crc.
+ *
+ * Return: updated checksum
+ */
+static inline uint32_t byte_scan_crc32c(uint32_t crc, const uint8_t *data, uint32_t length)
+{
+	uint32_t i = 0;
+
+	crc = ~crc;
+
+#if defined(__SSE4_2__) && defined(__x86_64__)
+	uint64_t crc64 = crc;
+
+	for (; i + 8 <= length; i += 8) {
+		uint64_t word;
+
+		memcpy(&word, data + i, sizeof(word));
+		crc64 = _mm_crc32_u64(crc64, word);
+	}
+	crc = (uint32_t)crc64;
+	for (; i < length; i++)
+		crc = _mm_crc32_u8(crc, data[i]);
+#elif defined(__SSE4_2__)
+	for (; i + 4 <= length; i += 4) {
+		uint32_t word;
+
+		memcpy(&word, data + i, sizeof(word));
+		crc = _mm_crc32_u32(crc, word);
+	}
+	for (; i < length; i++)
+		crc = _mm_crc32_u8(crc, data[i]);
+#elif defined(__ARM_FEATURE_CRC32) && defined(__aarch64__)
+	for (; i + 8 <= length; i += 8) {
+		uint64_t word;
+
+		memcpy(&word, data + i, sizeof(word));
+		crc = __crc32cd(crc, word);
+	}
+	for (; i < length; i++)
+		crc = __crc32cb(crc, data[i]);
+#else
+	/* Reflected polynomial 0x82f63b78, four bits at a time */
+	static const uint32_t table[16] = {
+		0x00000000, 0x105ec76f, 0x20bd8ede, 0x30e349b1, 0x417b1dbc, 0x5125dad3, 0x61c69362, 0x7198540d,
+		0x82f63b78, 0x92a8fc17, 0xa24bb5a6, 0xb21572c9, 0xc38d26c4, 0xd3d3e1ab, 0xe330a81a, 0xf36e6f75,
+	};
+
+	for (; i < length; i++) {
+		crc ^= data[i];
+		crc = (crc >> 4) ^ table[crc & 0xf];
+		crc = (crc >> 4) ^ table[crc & 0xf];
+	}
+#endif
+
+	return ~crc;
+}
+
+/**
+ * byte_scan_adler32 - Update an Adler-32 checksum
+ * @adler: checksum of the preceding bytes, 1 to start
+ * @data: pointer to the bytes to add
+ * @length: number of bytes to add
+ *
+ * Return: updated checksum, compatible with zlib's adler32()
+ */
+static inline uint32_t byte_scan_adler32(uint32_t adler, const uint8_t *data, uint32_t length)
+{
+	uint32_t s1 = adler & 0xffff;
+	uint32_t s2 = adler >> 16;
+
+	while (length) {
+		/* Reduce at least every NMAX bytes, before the sums can overflow */
+		uint32_t chunk = length < BYTE_SCAN_ADLER_NMAX ? length : BYTE_SCAN_ADLER_NMAX;
+		uint32_t i = 0;
+
+		length -= chunk;
+
+#if defined(__SSE2__)
+		uint32_t blocks = chunk / 16;
+
+		if (blocks) {
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i taps_lo = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+			const __m128i taps_hi = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+			__m128i vs1 = zero;
+			__m128i vs2 = zero;
+			__m128i prefix = zero;
+
+			for (; i < blocks * 16; i += 16) {
+				__m128i bytes = _mm_loadu_si128((const __m128i *)(data + i));
+
+				/* Every byte already summed is counted again by each later block */
+				prefix = _mm_add_epi32(prefix, vs1);
+				vs1 = _mm_add_epi32(vs1, _mm_sad_epu8(bytes, zero));
+				vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero), taps_lo));
+				vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero), taps_hi));
+			}
+
+			uint32_t lanes[4];
+			uint64_t sum1, sum2;
+
+			_mm_storeu_si128((__m128i *)lanes, vs1);
+			sum1 = (uint64_t)lanes[0] + lanes[2];
+			_mm_storeu_si128((__m128i *)lanes, prefix);
+			sum2 = 16 * ((uint64_t)lanes[0] + lanes[2]);
+			_mm_storeu_si128((__m128i *)lanes, vs2);
+			sum2 += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+			sum2 += (uint64_t)s1 * (blocks * 16);
+
+			s1 = (uint32_t)((s1 + sum1) % BYTE_SCAN_ADLER_BASE);
+			s2 = (uint32_t)((s2 + sum2) % BYTE_SCAN_ADLER_BASE);
+		}
+#endif
+
+		for (; i < chunk; i++) {
+			s1 += data[i];
+			s2 += s1;
+		}
+
+		s1 %= BYTE_SCAN_ADLER_BASE;
+		s2 %= BYTE_SCAN_ADLER_BASE;
+		data += chunk;
+	}
+
+	return (s2 << 16) | s1;
+}
+
+/*
+ * Contiguous piece of the ring starting at @index, at most @length bytes
+ * long. A range of buffered data takes one piece on a mirrored buffer and at
+ * most two otherwise.
+ */
+static inline uint32_t ring_buffer_span(struct ring_buffer *rb, uint32_t index, uint32_t length,
+					const uint8_t **ptr)
+{
+	uint32_t offset = ring_buffer_offset(rb, index);
+	uint32_t first = rb->size - offset;
+
+	if (first > length || ring_buffer_is_mirrored(rb))
+		first = length;
+
+	*ptr = &rb->buffer[offset];
+
+	return first;
+}
+
+/**
+ * ring_buffer_find_byte - Find a delimiter in the buffered data
+ * @rb: pointer to the ring buffer structure
+ * @start: number of buffered bytes to skip, e.g. those already scanned
+ * @byte: value to look for
+ *
+ * Must be called by the consumer. Nothing is removed from the buffer.
+ *
+ * Return: offset of the first match from the oldest buffered byte, or
+ * -ENOENT if no buffered byte from @start on matches
+ */
+static inline int ring_buffer_find_byte(struct ring_buffer *rb, uint32_t start, uint8_t byte)
+{
+	uint32_t tail = ring_buffer_tail_relaxed(rb);
+	uint32_t used = ring_buffer_used_space(rb, tail, rb->size);
+	uint32_t index = ring_buffer_advance(rb, tail, start);
+	uint32_t offset = start;
+
+	while (offset < used) {
+		const uint8_t *ptr;
+		uint32_t length = ring_buffer_span(rb, index, used - offset, &ptr);
+		uint32_t match = byte_scan_find(ptr, length, byte);
+
+		if (match < length)
+			return (int)(offset + match);
+
+		offset += length;
+		index = ring_buffer_advance(rb, index, length);
+	}
+
+	return -ENOENT;
+}
+
+/**
+ * ring_buffer_crc32c - Compute the CRC-32C of a range of buffered data
+ * @rb: pointer to the ring buffer structure
+ * @offset: offset of the range from the oldest buffered byte
+ * @length: number of bytes in the range
+ * @crc: pointer to the running checksum, 0 to start, updated on success
+ *
+ * Must be called by the consumer. Nothing is removed from the buffer.
+ *
+ * Return: 0 on success, or -EAGAIN if fewer than @offset + @length bytes are
+ * buffered
+ */
+static inline int ring_buffer_crc32c(struct ring_buffer *rb, uint32_t offset, uint32_t length, uint32_t *crc)
+{
+	uint32_t tail = ring_buffer_tail_relaxed(rb);
+	uint32_t index = ring_buffer_advance(rb, tail, offset);
+
+	if (offset > UINT32_MAX - length || offset + length > ring_buffer_used_space(rb, tail, offset + length)) {
+		return -EAGAIN;
+	}
+
+	while (length) {
+		const uint8_t *ptr;
+		uint32_t piece = ring_buffer_span(rb, index, length, &ptr);
+
+		*crc = byte_scan_crc32c(*crc, ptr, piece);
+		length -= piece;
+		index = ring_buffer_advance(rb, index, piece);
+	}
+
+	return 0;
+}
+
+/**
+ * ring_buffer_adler32 - Compute the Adler-32 of a range of buffered data
+ * @rb: pointer to the ring buffer structure
+ * @offset: offset of the range from the oldest buffered byte
+ * @length: number of bytes in the range
+ * @adler: pointer to the running checksum, 1 to start, updated on success
+ *
+ * Must be called by the consumer. Nothing is removed from the buffer.
+ *
+ * Return: 0 on success, or -EAGAIN if fewer than @offset + @length bytes are
+ * buffered
+ */
+static inline int ring_buffer_adler32(struct ring_buffer *rb, uint32_t offset, uint32_t length, uint32_t *adler)
+{
+	uint32_t tail = ring_buffer_tail_relaxed(rb);
+	uint32_t index = ring_buffer_advance(rb, tail, offset);
+
+	if (offset > UINT32_MAX - length || offset + length > ring_buffer_used_space(rb, tail, offset + length)) {
+		return -EAGAIN;
+	}
+
+	while (length) {
+		const uint8_t *ptr;
+		uint32_t piece = ring_buffer_span(rb, index, length, &ptr);
+
+		*adler = byte_scan_adler32(*adler, ptr, piece);
+		length -= piece;
+		index = ring_buffer_advance(rb, index, piece);
+	}
+
+	return 0;
+}
+
+#endif /* BYTE_SCAN_H */
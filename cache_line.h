@@ -0,0 +1,79 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CACHE_LINE_H
+#define CACHE_LINE_H
+
+/**
+ * CACHE_LINE_SIZE - Size in bytes of the data cache line of the target
+ *
+ * Override it on the compiler command line for targets with other line sizes.
+ */
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+/**
+ * CACHE_LINE_ALIGNED - Start a structure member on a cache line boundary
+ *
+ * Used to keep fields written by different cores on separate cache lines.
+ */
+#ifdef __cplusplus
+#define CACHE_LINE_ALIGNED alignas(CACHE_LINE_SIZE)
+#else
+#define CACHE_LINE_ALIGNED _Alignas(CACHE_LINE_SIZE)
+#endif
+
+/**
+ * CACHE_LINE_SEPARATE - Start a member on a cache line boundary if the
+ * cache line aware queue layout is enabled
+ *
+ * Define QUEUE_CACHE_LINE_LAYOUT to place the producer-owned and the
+ * consumer-owned fields of the queue structures on separate cache lines,
+ * avoiding false sharing when both sides run on different cores. It costs
+ * a few cache lines per queue, so it is off by default for small targets.
+ */
+#ifdef QUEUE_CACHE_LINE_LAYOUT
+#define CACHE_LINE_SEPARATE CACHE_LINE_ALIGNED
+#else
+#define CACHE_LINE_SEPARATE
+#endif
+
+/**
+ * CACHE_LINE_ROUND_UP - Round a size up to a whole number of cache lines
+ */
+#define CACHE_LINE_ROUND_UP(x) (((x) + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1))
+
+/**
+ * DECLARE_CACHE_LINE_BUFFER - Declare a byte buffer owning whole cache lines
+ * @name: Name of the buffer
+ * @size: Minimum size of the buffer in bytes
+ *
+ * The buffer starts on a cache line boundary and is padded to whole lines,
+ * so it never shares a line with neighbouring data.
+ */
+#define DECLARE_CACHE_LINE_BUFFER(name, size) \
+	CACHE_LINE_ALIGNED uint8_t name[CACHE_LINE_ROUND_UP(size)]
+
+#endif /* CACHE_LINE_H */
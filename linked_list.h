@@ -25,6 +25,7 @@
 #ifndef INTRUSIVE_LIST_H
 #define INTRUSIVE_LIST_H
 
+#include <stddef.h>
 #include <stdbool.h>
 
 /**
@@ -150,6 +151,9 @@ static inline void list_insert_before(struct list_node *node, struct list_node *
 /**
  * list_remove - Remove a node from the list
  * @node: pointer to the node to remove
+ *
+ * The list head is not known here and is left untouched, so use
+ * list_remove_from() when @node may be the first or last node.
  */
 static inline void list_remove(struct list_node *node)
 {
@@ -163,6 +167,30 @@ static inline void list_remove(struct list_node *node)
 	node->next = NULL;
 }
 
+/**
+ * list_remove_from - Remove a node from a given list
+ * @list: pointer to the list head the node belongs to
+ * @node: pointer to the node to remove
+ *
+ * Unlike list_remove(), this keeps @list's head and tail pointers valid
+ * when @node is the first or last node.
+ */
+static inline void list_remove_from(struct list_head *list, struct list_node *node)
+{
+	if (node->prev)
+		node->prev->next = node->next;
+	else
+		list->head = node->next;
+
+	if (node->next)
+		node->next->prev = node->prev;
+	else
+		list->tail = node->prev;
+
+	node->prev = NULL;
+	node->next = NULL;
+}
+
 /**
  * list_for_each_safe - Safely traverse all nodes in a list
  * @list: pointer to the list head
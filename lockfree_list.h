@@ -0,0 +1,242 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOCKFREE_LIST_H
+#define LOCKFREE_LIST_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "linked_list.h"
+#include "cache_line.h"
+
+/*
+ * Lock-free containers over the intrusive struct list_node, for work shared
+ * between threads:
+ *
+ * struct mpsc_list is an unbounded multi-producer, single-consumer FIFO
+ * (Vyukov style). Producers enqueue with a single atomic exchange and never
+ * wait for each other; the consumer dequeues without atomic read-modify-write
+ * operations. Only the next pointers of the nodes are used.
+ *
+ * struct lockfree_stack collects nodes from any number of producers; the
+ * consumer detaches the whole backlog with a single exchange and can get it
+ * back in arrival order as a regular struct list_head.
+ *
+ * struct list_node has plain pointer members, so the GCC/Clang __atomic
+ * builtins are used on them instead of C11 _Atomic types.
+ */
+
+/**
+ * struct mpsc_list - Lock-free intrusive MPSC queue
+ * @head: last node enqueued, exchanged by the producers
+ * @tail: next node to dequeue, owned by the consumer
+ * @stub: placeholder node keeping the queue non-empty internally
+ */
+struct mpsc_list {
+	CACHE_LINE_ALIGNED struct list_node *head;
+	CACHE_LINE_ALIGNED struct list_node *tail;
+	struct list_node stub;
+};
+
+/**
+ * mpsc_list_init - Initialize an empty MPSC queue
+ * @q: pointer to the queue
+ */
+static inline void mpsc_list_init(struct mpsc_list *q)
+{
+	q->stub.prev = NULL;
+	q->stub.next = NULL;
+	q->head = &q->stub;
+	q->tail = &q->stub;
+}
+
+/**
+ * mpsc_list_push - Enqueue a node
+ * @q: pointer to the queue
+ * @node: pointer to the node to enqueue, not queued anywhere else
+ *
+ * Safe to call from any number of threads concurrently.
+ */
+static inline void mpsc_list_push(struct mpsc_list *q, struct list_node *node)
+{
+	struct list_node *prev;
+
+	__atomic_store_n(&node->next, NULL, __ATOMIC_RELAXED);
+	prev = __atomic_exchange_n(&q->head, node, __ATOMIC_ACQ_REL);
+
+	/* Until this store the node is not reachable by the consumer */
+	__atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+}
+
+/**
+ * mpsc_list_pop - Dequeue the oldest node
+ * @q: pointer to the queue
+ *
+ * Must only be called by the single consumer. May return NULL while a
+ * producer is between its exchange and the link of its node; the node then
+ * shows up on a later call.
+ *
+ * Return: pointer to the dequeued node, or NULL if none is available
+ */
+static inline struct list_node *mpsc_list_pop(struct mpsc_list *q)
+{
+	struct list_node *tail = q->tail;
+	struct list_node *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+	if (tail == &q->stub) {
+		if (!next)
+			return NULL;
+
+		q->tail = next;
+		tail = next;
+		next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+	}
+
+	if (next) {
+		q->tail = next;
+		return tail;
+	}
+
+	/* A producer is linking a node behind the tail */
+	if (tail != __atomic_load_n(&q->head, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	/* Re-enqueue the stub, so that the last node can be detached */
+	mpsc_list_push(q, &q->stub);
+
+	next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+	if (next) {
+		q->tail = next;
+		return tail;
+	}
+
+	return NULL;
+}
+
+/**
+ * mpsc_list_is_empty - Check if the queue holds no node
+ * @q: pointer to the queue
+ *
+ * Must only be called by the consumer.
+ *
+ * Return: true if the queue is empty, false otherwise
+ */
+static inline bool mpsc_list_is_empty(struct mpsc_list *q)
+{
+	return q->tail == &q->stub && !__atomic_load_n(&q->stub.next, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * struct lockfree_stack - Lock-free push-all/take-all stack
+ * @top: last node pushed
+ */
+struct lockfree_stack {
+	struct list_node *top;
+};
+
+/**
+ * lockfree_stack_init - Initialize an empty stack
+ * @stack: pointer to the stack
+ */
+static inline void lockfree_stack_init(struct lockfree_stack *stack)
+{
+	stack->top = NULL;
+}
+
+/**
+ * lockfree_stack_push - Push a node on the stack
+ * @stack: pointer to the stack
+ * @node: pointer to the node to push, not queued anywhere else
+ *
+ * Safe to call from any number of threads concurrently. The nodes are only
+ * ever detached all at once, so there is no ABA hazard.
+ */
+static inline void lockfree_stack_push(struct lockfree_stack *stack, struct list_node *node)
+{
+	struct list_node *top = __atomic_load_n(&stack->top, __ATOMIC_RELAXED);
+
+	do {
+		node->next = top;
+	} while (!__atomic_compare_exchange_n(&stack->top, &top, node, true, __ATOMIC_RELEASE,
+					      __ATOMIC_RELAXED));
+}
+
+/**
+ * lockfree_stack_take_all - Detach every node pushed so far
+ * @stack: pointer to the stack
+ *
+ * Return: the most recently pushed node, linked through next to the older
+ *         ones, or NULL if the stack is empty
+ */
+static inline struct list_node *lockfree_stack_take_all(struct lockfree_stack *stack)
+{
+	if (!__atomic_load_n(&stack->top, __ATOMIC_RELAXED))
+		return NULL;
+
+	return __atomic_exchange_n(&stack->top, NULL, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * lockfree_stack_take_all_fifo - Detach every node pushed so far in arrival order
+ * @stack: pointer to the stack
+ * @list: list head to append the nodes to, oldest first
+ *
+ * The detached nodes become a regular doubly linked list owned by the
+ * caller.
+ *
+ * Return: number of nodes appended to @list
+ */
+static inline size_t lockfree_stack_take_all_fifo(struct lockfree_stack *stack, struct list_head *list)
+{
+	struct list_node *node = lockfree_stack_take_all(stack);
+	struct list_node *first = NULL;
+	struct list_node *last = node;
+	size_t count = 0;
+
+	/* Reverse the chain, filling in the prev pointers on the way */
+	while (node) {
+		struct list_node *next = node->next;
+
+		node->next = first;
+		if (first)
+			first->prev = node;
+		first = node;
+		node = next;
+		count++;
+	}
+
+	if (!first)
+		return 0;
+
+	first->prev = list->tail;
+	if (list->tail)
+		list->tail->next = first;
+	else
+		list->head = first;
+	list->tail = last;
+
+	return count;
+}
+
+#endif /* LOCKFREE_LIST_H */
@@ -28,11 +28,41 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <string.h>
+#include "cache_line.h"
+
+/*
+ * Define MESSAGE_QUEUE_SPSC to make struct message_queue safe for one
+ * producer and one consumer running concurrently without locks. The indices
+ * then become C11 atomics with acquire/release ordering, each on its own
+ * cache line, and each side caches the index of the other side to avoid
+ * cross-core traffic. Typed queues are not affected.
+ */
+#ifdef MESSAGE_QUEUE_SPSC
+#include "atomic_compat.h"
+#endif
+
+/*
+ * Define MESSAGE_QUEUE_STATS to count, per queue, the highest number of
+ * queued messages seen by the producer and the calls that found the queue
+ * full or empty. Each counter is written only by the side that owns it;
+ * read them from any thread with message_queue_get_stats().
+ */
+#ifdef MESSAGE_QUEUE_STATS
+#include "stats.h"
+#endif
+
+/* Set every bit below the most significant set bit of a 32-bit value */
+#define MQ_FILL_BITS_1(x) ((x) | ((x) >> 1))
+#define MQ_FILL_BITS_2(x) (MQ_FILL_BITS_1(x) | (MQ_FILL_BITS_1(x) >> 2))
+#define MQ_FILL_BITS_4(x) (MQ_FILL_BITS_2(x) | (MQ_FILL_BITS_2(x) >> 4))
+#define MQ_FILL_BITS_8(x) (MQ_FILL_BITS_4(x) | (MQ_FILL_BITS_4(x) >> 8))
+#define MQ_FILL_BITS_16(x) (MQ_FILL_BITS_8(x) | (MQ_FILL_BITS_8(x) >> 16))
 
 /**
  * Macro to round down a number to the nearest power of two at compile time.
  */
-#define ROUND_DOWN_POWER_OF_TWO(x) ((x) & ~((x) - 1))
+#define ROUND_DOWN_POWER_OF_TWO(x) ((MQ_FILL_BITS_16((uint64_t)(x)) + 1) >> 1)
 
 /**
  * Macro to declare a buffer suitable for the message queue.
@@ -42,22 +72,204 @@
 #define DECLARE_MESSAGE_QUEUE_BUFFER(slots, message_size) \
     uint8_t buffer[(ROUND_DOWN_POWER_OF_TWO(slots)) * (message_size)]
 
+/**
+ * Macro to compute the slot stride that keeps messages within cache lines.
+ * @message_size: Size of each message.
+ *
+ * Messages smaller than a cache line get a power-of-two stride, so that a
+ * whole number of them fits in a line; larger ones are padded to whole lines.
+ */
+#define MESSAGE_QUEUE_ALIGNED_STRIDE(message_size)                          \
+    (((message_size) >= CACHE_LINE_SIZE) ? CACHE_LINE_ROUND_UP(message_size) \
+                                         : (MQ_FILL_BITS_16((message_size) - 1) + 1))
+
+/**
+ * Macro to declare a cache line aligned buffer whose slots never straddle
+ * cache lines, for use with message_queue_init_aligned().
+ * @slots: Number of slots in the queue.
+ * @message_size: Size of each message.
+ */
+#define DECLARE_ALIGNED_MESSAGE_QUEUE_BUFFER(slots, message_size) \
+    CACHE_LINE_ALIGNED uint8_t buffer[(ROUND_DOWN_POWER_OF_TWO(slots)) * MESSAGE_QUEUE_ALIGNED_STRIDE(message_size)]
+
 /**
  * struct message_queue - Fixed-size message queue structure
  * @buffer: Pointer to the data buffer.
  * @slot_size: Size of each message in bytes.
  * @slot_count: Number of slots in the queue (power of two).
+ * @stride: Distance in bytes between two slots.
  * @head: Head index (producer).
+ * @tail_cache: Producer copy of @tail (MESSAGE_QUEUE_SPSC only).
+ * @high_water: Most messages queued as seen by the producer (MESSAGE_QUEUE_STATS only).
+ * @full_count: Producer calls that found the queue full (MESSAGE_QUEUE_STATS only).
  * @tail: Tail index (consumer).
+ * @head_cache: Consumer copy of @head (MESSAGE_QUEUE_SPSC only).
+ * @empty_count: Consumer calls that found the queue empty (MESSAGE_QUEUE_STATS only).
+ *
+ * With MESSAGE_QUEUE_SPSC or QUEUE_CACHE_LINE_LAYOUT, the producer and the
+ * consumer fields each start on their own cache line.
  */
 struct message_queue {
     uint8_t *buffer;
     uint32_t slot_size;
     uint32_t slot_count;
-    uint32_t head;
-    uint32_t tail;
+    uint32_t stride;
+#ifdef MESSAGE_QUEUE_SPSC
+    CACHE_LINE_ALIGNED atomic_uint head;
+    uint32_t tail_cache;
+#else
+    CACHE_LINE_SEPARATE uint32_t head;
+#endif
+#ifdef MESSAGE_QUEUE_STATS
+    struct stat_counter high_water;
+    struct stat_counter full_count;
+#endif
+#ifdef MESSAGE_QUEUE_SPSC
+    CACHE_LINE_ALIGNED atomic_uint tail;
+    uint32_t head_cache;
+#else
+    CACHE_LINE_SEPARATE uint32_t tail;
+#endif
+#ifdef MESSAGE_QUEUE_STATS
+    struct stat_counter empty_count;
+#endif
 };
 
+/*
+ * Index accessors. With MESSAGE_QUEUE_SPSC, an index is published with
+ * release ordering by its owner and read with acquire ordering by the other
+ * side; owners read their own index relaxed. Without it they are plain
+ * accesses.
+ */
+#ifdef MESSAGE_QUEUE_SPSC
+
+static inline uint32_t message_queue_head_relaxed(struct message_queue *mq)
+{
+    return atomic_load_explicit(&mq->head, memory_order_relaxed);
+}
+
+static inline void message_queue_head_release(struct message_queue *mq, uint32_t head)
+{
+    atomic_store_explicit(&mq->head, head, memory_order_release);
+}
+
+static inline uint32_t message_queue_tail_relaxed(struct message_queue *mq)
+{
+    return atomic_load_explicit(&mq->tail, memory_order_relaxed);
+}
+
+static inline void message_queue_tail_release(struct message_queue *mq, uint32_t tail)
+{
+    atomic_store_explicit(&mq->tail, tail, memory_order_release);
+}
+
+/* Producer view of the tail index, reloaded from the consumer on @refresh */
+static inline uint32_t message_queue_cached_tail(struct message_queue *mq, bool refresh)
+{
+    if (refresh) {
+        mq->tail_cache = atomic_load_explicit(&mq->tail, memory_order_acquire);
+    }
+
+    return mq->tail_cache;
+}
+
+/* Consumer view of the head index, reloaded from the producer on @refresh */
+static inline uint32_t message_queue_cached_head(struct message_queue *mq, bool refresh)
+{
+    if (refresh) {
+        mq->head_cache = atomic_load_explicit(&mq->head, memory_order_acquire);
+    }
+
+    return mq->head_cache;
+}
+
+#else
+
+static inline uint32_t message_queue_head_relaxed(struct message_queue *mq)
+{
+    return mq->head;
+}
+
+static inline void message_queue_head_release(struct message_queue *mq, uint32_t head)
+{
+    mq->head = head;
+}
+
+static inline uint32_t message_queue_tail_relaxed(struct message_queue *mq)
+{
+    return mq->tail;
+}
+
+static inline void message_queue_tail_release(struct message_queue *mq, uint32_t tail)
+{
+    mq->tail = tail;
+}
+
+static inline uint32_t message_queue_cached_tail(struct message_queue *mq, bool refresh)
+{
+    (void)refresh;
+    return mq->tail;
+}
+
+static inline uint32_t message_queue_cached_head(struct message_queue *mq, bool refresh)
+{
+    (void)refresh;
+    return mq->head;
+}
+
+#endif /* MESSAGE_QUEUE_SPSC */
+
+/* Producer side: true if no slot is free after @head, refreshing the cache once */
+static inline bool message_queue_full_at(struct message_queue *mq, uint32_t head)
+{
+    uint32_t next = (head + 1) & (mq->slot_count - 1);
+
+    return next == message_queue_cached_tail(mq, false) && next == message_queue_cached_tail(mq, true);
+}
+
+/* Consumer side: true if no message is queued at @tail, refreshing the cache once */
+static inline bool message_queue_empty_at(struct message_queue *mq, uint32_t tail)
+{
+    return tail == message_queue_cached_head(mq, false) && tail == message_queue_cached_head(mq, true);
+}
+
+/*
+ * Statistics hooks, called by the producer after moving the head or on a
+ * full queue and by the consumer on an empty one. They compile to nothing
+ * without MESSAGE_QUEUE_STATS. The fill level reloads the tail, since the
+ * cached copy may trail the consumer and overstate the high-water mark.
+ */
+static inline void message_queue_stat_fill(struct message_queue *mq)
+{
+#ifdef MESSAGE_QUEUE_STATS
+    stat_max(&mq->high_water, (message_queue_head_relaxed(mq) - message_queue_cached_tail(mq, true)) &
+                              (mq->slot_count - 1));
+#else
+    (void)mq;
+#endif
+}
+
+static inline void message_queue_stat_full(struct message_queue *mq)
+{
+#ifdef MESSAGE_QUEUE_STATS
+    stat_inc(&mq->full_count);
+#else
+    (void)mq;
+#endif
+}
+
+static inline void message_queue_stat_empty(struct message_queue *mq)
+{
+#ifdef MESSAGE_QUEUE_STATS
+    stat_inc(&mq->empty_count);
+#else
+    (void)mq;
+#endif
+}
+
+/* Shared with the other queue headers, define it only once */
+#ifndef ROUND_DOWN_TO_POWER_OF_TWO_DEFINED
+#define ROUND_DOWN_TO_POWER_OF_TWO_DEFINED
 /**
  * round_down_to_power_of_two - Round down a number to the nearest power of two
  * @value: The number to round down.
@@ -74,6 +286,7 @@ static inline uint32_t round_down_to_power_of_two(uint32_t value)
 
     return value;
 }
+#endif
 
 /**
  * message_queue_init - Initialize the message queue.
@@ -89,9 +302,40 @@ static inline void message_queue_init(struct message_queue *mq, uint8_t *buffer,
 {
     mq->slot_count = round_down_to_power_of_two(slot_count);
     mq->slot_size = slot_size;
+    mq->stride = slot_size;
     mq->buffer = buffer;
+#ifdef MESSAGE_QUEUE_SPSC
+    atomic_init(&mq->head, 0);
+    atomic_init(&mq->tail, 0);
+    mq->tail_cache = 0;
+    mq->head_cache = 0;
+#else
     mq->head = 0;
     mq->tail = 0;
+#endif
+#ifdef MESSAGE_QUEUE_STATS
+    stat_init(&mq->high_water);
+    stat_init(&mq->full_count);
+    stat_init(&mq->empty_count);
+#endif
+}
+
+/**
+ * message_queue_init_aligned - Initialize a message queue with cache line friendly slots.
+ * @mq: Pointer to the message queue structure.
+ * @buffer: Slot storage, declared with DECLARE_ALIGNED_MESSAGE_QUEUE_BUFFER().
+ * @slot_size: Size of each message.
+ * @slot_count: Number of slots in the buffer.
+ *
+ * Slots are spaced by MESSAGE_QUEUE_ALIGNED_STRIDE(@slot_size), so no
+ * message straddles two cache lines. The number of slots is rounded down
+ * to the nearest power of two.
+ */
+static inline void message_queue_init_aligned(struct message_queue *mq, uint8_t *buffer,
+                                              uint32_t slot_size, uint32_t slot_count)
+{
+    message_queue_init(mq, buffer, slot_size, slot_count);
+    mq->stride = MESSAGE_QUEUE_ALIGNED_STRIDE(slot_size);
 }
 
 /**
@@ -103,16 +347,17 @@ static inline void message_queue_init(struct message_queue *mq, uint8_t *buffer,
  */
 static inline int message_queue_push(struct message_queue *mq, const void *data)
 {
-    if (((mq->head + 1) & (mq->slot_count - 1)) == mq->tail) {
+    uint32_t head = message_queue_head_relaxed(mq);
+
+    if (message_queue_full_at(mq, head)) {
+        message_queue_stat_full(mq);
         return -ENOBUFS; // Queue is full
     }
 
-    uint8_t *slot = &mq->buffer[mq->head * mq->slot_size];
-    for (uint32_t i = 0; i < mq->slot_size; i++) {
-        slot[i] = ((const uint8_t *)data)[i];
-    }
+    memcpy(&mq->buffer[head * mq->stride], data, mq->slot_size);
 
-    mq->head = (mq->head + 1) & (mq->slot_count - 1);
+    message_queue_head_release(mq, (head + 1) & (mq->slot_count - 1));
+    message_queue_stat_fill(mq);
     return 0;
 }
 
@@ -125,14 +370,14 @@ static inline int message_queue_push(struct message_queue *mq, const void *data)
  */
 static inline int message_queue_peek(struct message_queue *mq, void *data)
 {
-    if (mq->head == mq->tail) {
+    uint32_t tail = message_queue_tail_relaxed(mq);
+
+    if (message_queue_empty_at(mq, tail)) {
+        message_queue_stat_empty(mq);
         return -EAGAIN; // Queue is empty
     }
 
-    uint8_t *slot = &mq->buffer[mq->tail * mq->slot_size];
-    for (uint32_t i = 0; i < mq->slot_size; i++) {
-        ((uint8_t *)data)[i] = slot[i];
-    }
+    memcpy(data, &mq->buffer[tail * mq->stride], mq->slot_size);
 
     return 0;
 }
@@ -148,19 +393,295 @@ static inline int message_queue_pop(struct message_queue *mq, void *data)
 {
     int ret = message_queue_peek(mq, data);
     if (ret == 0) {
-        mq->tail = (mq->tail + 1) & (mq->slot_count - 1);
+        message_queue_tail_release(mq, (message_queue_tail_relaxed(mq) + 1) & (mq->slot_count - 1));
     }
     return ret;
 }
 
+/**
+ * message_queue_claim - Get the next free slot to build a message in place.
+ * @mq: Pointer to the message queue structure.
+ *
+ * The message becomes visible to the consumer once message_queue_publish()
+ * is called. Claiming again before publishing returns the same slot.
+ *
+ * Return: Pointer to a slot of slot_size bytes, or NULL if the queue is full.
+ */
+static inline void *message_queue_claim(struct message_queue *mq)
+{
+    uint32_t head = message_queue_head_relaxed(mq);
+
+    if (message_queue_full_at(mq, head)) {
+        message_queue_stat_full(mq);
+        return NULL; // Queue is full
+    }
+
+    return &mq->buffer[head * mq->stride];
+}
+
+/**
+ * message_queue_publish - Publish the message built in the claimed slot.
+ * @mq: Pointer to the message queue structure.
+ *
+ * Return: 0 on success, -ENOBUFS if the queue is full.
+ */
+static inline int message_queue_publish(struct message_queue *mq)
+{
+    uint32_t head = message_queue_head_relaxed(mq);
+
+    if (message_queue_full_at(mq, head)) {
+        message_queue_stat_full(mq);
+        return -ENOBUFS; // Queue is full
+    }
+
+    message_queue_head_release(mq, (head + 1) & (mq->slot_count - 1));
+    message_queue_stat_fill(mq);
+    return 0;
+}
+
+/**
+ * message_queue_front - Get the message at the front of the queue in place.
+ * @mq: Pointer to the message queue structure.
+ *
+ * The slot stays owned by the consumer until message_queue_release().
+ *
+ * Return: Pointer to the message, or NULL if the queue is empty.
+ */
+static inline void *message_queue_front(struct message_queue *mq)
+{
+    uint32_t tail = message_queue_tail_relaxed(mq);
+
+    if (message_queue_empty_at(mq, tail)) {
+        message_queue_stat_empty(mq);
+        return NULL; // Queue is empty
+    }
+
+    return &mq->buffer[tail * mq->stride];
+}
+
+/**
+ * message_queue_release - Release the message returned by message_queue_front().
+ * @mq: Pointer to the message queue structure.
+ *
+ * Return: 0 on success, -EAGAIN if the queue is empty.
+ */
+static inline int message_queue_release(struct message_queue *mq)
+{
+    uint32_t tail = message_queue_tail_relaxed(mq);
+
+    if (message_queue_empty_at(mq, tail)) {
+        return -EAGAIN; // Queue is empty
+    }
+
+    message_queue_tail_release(mq, (tail + 1) & (mq->slot_count - 1));
+    return 0;
+}
+
+/**
+ * message_queue_push_n - Push several messages into the queue at once.
+ * @mq: Pointer to the message queue structure.
+ * @data: Pointer to @count messages stored back to back.
+ * @count: Number of messages to push.
+ *
+ * Pushes as many messages as fit, copying them with at most two memcpy calls
+ * (one per message for padded slots) and publishing them with a single head
+ * update.
+ *
+ * Return: number of messages pushed, or -ENOBUFS if the queue is full.
+ */
+static inline int message_queue_push_n(struct message_queue *mq, const void *data, uint32_t count)
+{
+    uint32_t mask = mq->slot_count - 1;
+    uint32_t head = message_queue_head_relaxed(mq);
+    uint32_t free_slots = (message_queue_cached_tail(mq, false) - head - 1) & mask;
+
+    if (free_slots < count) {
+        free_slots = (message_queue_cached_tail(mq, true) - head - 1) & mask;
+    }
+
+    if (!free_slots && count) {
+        message_queue_stat_full(mq);
+        return -ENOBUFS; // Queue is full
+    }
+
+    if (count > free_slots) {
+        count = free_slots;
+        message_queue_stat_full(mq);
+    }
+
+    uint32_t first = mq->slot_count - head;
+    if (first > count) {
+        first = count;
+    }
+
+    if (mq->stride == mq->slot_size) {
+        memcpy(&mq->buffer[head * mq->slot_size], data, first * mq->slot_size);
+        memcpy(mq->buffer, (const uint8_t *)data + first * mq->slot_size, (count - first) * mq->slot_size);
+    } else {
+        for (uint32_t i = 0; i < count; i++) {
+            memcpy(&mq->buffer[((head + i) & mask) * mq->stride],
+                   (const uint8_t *)data + i * mq->slot_size, mq->slot_size);
+        }
+    }
+
+    message_queue_head_release(mq, (head + count) & mask);
+    message_queue_stat_fill(mq);
+    return count;
+}
+
+/**
+ * message_queue_pop_n - Remove and retrieve several messages at once.
+ * @mq: Pointer to the message queue structure.
+ * @data: Pointer to room for @count messages stored back to back.
+ * @count: Maximum number of messages to pop.
+ *
+ * Pops as many messages as are queued, up to @count, copying them with at
+ * most two memcpy calls (one per message for padded slots) and releasing them
+ * with a single tail update.
+ *
+ * Return: number of messages popped, or -EAGAIN if the queue is empty.
+ */
+static inline int message_queue_pop_n(struct message_queue *mq, void *data, uint32_t count)
+{
+    uint32_t mask = mq->slot_count - 1;
+    uint32_t tail = message_queue_tail_relaxed(mq);
+    uint32_t used_slots = (message_queue_cached_head(mq, false) - tail) & mask;
+
+    if (used_slots < count) {
+        used_slots = (message_queue_cached_head(mq, true) - tail) & mask;
+    }
+
+    if (!used_slots && count) {
+        message_queue_stat_empty(mq);
+        return -EAGAIN; // Queue is empty
+    }
+
+    if (count > used_slots) {
+        count = used_slots;
+        message_queue_stat_empty(mq);
+    }
+
+    uint32_t first = mq->slot_count - tail;
+    if (first > count) {
+        first = count;
+    }
+
+    if (mq->stride == mq->slot_size) {
+        memcpy(data, &mq->buffer[tail * mq->slot_size], first * mq->slot_size);
+        memcpy((uint8_t *)data + first * mq->slot_size, mq->buffer, (count - first) * mq->slot_size);
+    } else {
+        for (uint32_t i = 0; i < count; i++) {
+            memcpy((uint8_t *)data + i * mq->slot_size,
+                   &mq->buffer[((tail + i) & mask) * mq->stride], mq->slot_size);
+        }
+    }
+
+    message_queue_tail_release(mq, (tail + count) & mask);
+    return count;
+}
+
 /**
  * message_queue_flush - Flush all messages in the queue.
  * @mq: Pointer to the message queue structure.
+ *
+ * Resets both indices, so with MESSAGE_QUEUE_SPSC it must not race with the
+ * producer or the consumer.
  */
 static inline void message_queue_flush(struct message_queue *mq)
 {
+#ifdef MESSAGE_QUEUE_SPSC
+    atomic_store_explicit(&mq->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&mq->tail, 0, memory_order_relaxed);
+    mq->tail_cache = 0;
+    mq->head_cache = 0;
+#else
     mq->head = 0;
     mq->tail = 0;
+#endif
 }
 
+#ifdef MESSAGE_QUEUE_STATS
+/**
+ * message_queue_get_stats - Read the statistics counters of the queue.
+ * @mq: Pointer to the message queue structure.
+ * @stats: Pointer to store the counters.
+ *
+ * The counters are read one by one, so a snapshot taken while the queue is
+ * in use may mix values from slightly different moments.
+ */
+static inline void message_queue_get_stats(struct message_queue *mq, struct queue_stats *stats)
+{
+    stats->high_water = stat_read(&mq->high_water);
+    stats->full = stat_read(&mq->full_count);
+    stats->empty = stat_read(&mq->empty_count);
+}
+#endif
+
+/**
+ * DEFINE_TYPED_MESSAGE_QUEUE - Define a message queue specialized for one message type.
+ * @name: Name of the queue structure and prefix of its functions.
+ * @type: Message type stored in each slot.
+ * @slots: Number of slots, rounded down to the nearest power of two.
+ *
+ * Defines struct @name with embedded slot storage and the inline functions
+ * @name_init(), @name_push(), @name_peek(), @name_pop() and @name_flush(), with
+ * the same semantics and return codes as the message_queue_* functions. The
+ * slot size and count are compile-time constants, so messages are moved by
+ * struct assignment with constant strides and masks.
+ */
+#define DEFINE_TYPED_MESSAGE_QUEUE(name, type, slots)                                  \
+    _Static_assert(ROUND_DOWN_POWER_OF_TWO(slots) >= 2, "typed message queue needs at least 2 slots"); \
+                                                                                        \
+    struct name {                                                                       \
+        type buffer[ROUND_DOWN_POWER_OF_TWO(slots)];                                    \
+        CACHE_LINE_SEPARATE uint32_t head;                                              \
+        CACHE_LINE_SEPARATE uint32_t tail;                                              \
+    };                                                                                  \
+                                                                                        \
+    static inline void name##_init(struct name *mq)                                     \
+    {                                                                                   \
+        mq->head = 0;                                                                   \
+        mq->tail = 0;                                                                   \
+    }                                                                                   \
+                                                                                        \
+    static inline int name##_push(struct name *mq, const type *data)                    \
+    {                                                                                   \
+        const uint32_t mask = (uint32_t)ROUND_DOWN_POWER_OF_TWO(slots) - 1;             \
+                                                                                        \
+        if (((mq->head + 1) & mask) == mq->tail) {                                      \
+            return -ENOBUFS;                                                            \
+        }                                                                               \
+                                                                                        \
+        mq->buffer[mq->head] = *data;                                                   \
+        mq->head = (mq->head + 1) & mask;                                               \
+        return 0;                                                                       \
+    }                                                                                   \
+                                                                                        \
+    static inline int name##_peek(struct name *mq, type *data)                          \
+    {                                                                                   \
+        if (mq->head == mq->tail) {                                                     \
+            return -EAGAIN;                                                             \
+        }                                                                               \
+                                                                                        \
+        *data = mq->buffer[mq->tail];                                                   \
+        return 0;                                                                       \
+    }                                                                                   \
+                                                                                        \
+    static inline int name##_pop(struct name *mq, type *data)                           \
+    {                                                                                   \
+        const uint32_t mask = (uint32_t)ROUND_DOWN_POWER_OF_TWO(slots) - 1;             \
+        int ret = name##_peek(mq, data);                                                \
+                                                                                        \
+        if (ret == 0) {                                                                 \
+            mq->tail = (mq->tail + 1) & mask;                                           \
+        }                                                                               \
+        return ret;                                                                     \
+    }                                                                                   \
+                                                                                        \
+    static inline void name##_flush(struct name *mq)                                    \
+    {                                                                                   \
+        mq->head = 0;                                                                   \
+        mq->tail = 0;                                                                   \
+    }
+
 #endif /* FIXED_MESSAGE_QUEUE_H */
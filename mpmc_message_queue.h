@@ -0,0 +1,199 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MPMC_MESSAGE_QUEUE_H
+#define MPMC_MESSAGE_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "atomic_compat.h"
+#include <string.h>
+#include <errno.h>
+#include "cache_line.h"
+#include "message_queue_core.h"
+
+/*
+ * Bounded multi-producer, multi-consumer message queue. Every slot carries a
+ * sequence counter telling whether it is free for the producer that claimed
+ * its position or holds a message for the consumer that claimed it, so
+ * producers and consumers only contend on a CAS of the head or tail index.
+ */
+
+/**
+ * Bytes reserved in front of each message for the slot sequence counter.
+ */
+#define MPMC_MESSAGE_QUEUE_SLOT_HEADER 8
+
+/**
+ * Macro to compute the size of one slot, padded to whole cache lines.
+ * @message_size: Size of each message.
+ */
+#define MPMC_MESSAGE_QUEUE_STRIDE(message_size) \
+    ((((message_size) + MPMC_MESSAGE_QUEUE_SLOT_HEADER) + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1))
+
+/**
+ * Macro to declare a buffer suitable for the MPMC message queue.
+ * @slots: Number of slots in the queue.
+ * @message_size: Size of each message.
+ */
+#define DECLARE_MPMC_MESSAGE_QUEUE_BUFFER(slots, message_size) \
+    CACHE_LINE_ALIGNED uint8_t buffer[(ROUND_DOWN_POWER_OF_TWO(slots)) * MPMC_MESSAGE_QUEUE_STRIDE(message_size)]
+
+/**
+ * struct mpmc_message_queue - Lock-free bounded MPMC message queue
+ * @buffer: Pointer to the slot storage, aligned to a cache line.
+ * @slot_size: Size of each message in bytes.
+ * @slot_count: Number of slots in the queue (power of two).
+ * @stride: Distance in bytes between two slots.
+ * @head: Next position to be claimed by a producer.
+ * @tail: Next position to be claimed by a consumer.
+ */
+struct mpmc_message_queue {
+    uint8_t *buffer;
+    uint32_t slot_size;
+    uint32_t slot_count;
+    uint32_t stride;
+    CACHE_LINE_ALIGNED atomic_uint head;
+    CACHE_LINE_ALIGNED atomic_uint tail;
+};
+
+static inline atomic_uint *mpmc_message_queue_sequence(struct mpmc_message_queue *mq, uint32_t position)
+{
+    return (atomic_uint *)&mq->buffer[(position & (mq->slot_count - 1)) * mq->stride];
+}
+
+static inline uint8_t *mpmc_message_queue_slot(struct mpmc_message_queue *mq, uint32_t position)
+{
+    return &mq->buffer[(position & (mq->slot_count - 1)) * mq->stride + MPMC_MESSAGE_QUEUE_SLOT_HEADER];
+}
+
+/**
+ * mpmc_message_queue_init - Initialize the MPMC message queue.
+ * @mq: Pointer to the message queue structure.
+ * @buffer: Slot storage, declared with DECLARE_MPMC_MESSAGE_QUEUE_BUFFER().
+ * @slot_size: Size of each message.
+ * @slot_count: Number of slots in the buffer.
+ *
+ * The number of slots is rounded down to the nearest power of two. Must not
+ * race with any other operation on the queue.
+ *
+ * Return: 0 on success, -EINVAL if fewer than 2 slots remain after rounding,
+ * since a single slot cannot tell a pending message from a free slot.
+ */
+static inline int mpmc_message_queue_init(struct mpmc_message_queue *mq, uint8_t *buffer,
+                                          uint32_t slot_size, uint32_t slot_count)
+{
+    slot_count = round_down_to_power_of_two(slot_count);
+
+    if (!mq || !buffer || slot_count < 2) {
+        return -EINVAL;
+    }
+
+    mq->slot_count = slot_count;
+    mq->slot_size = slot_size;
+    mq->stride = MPMC_MESSAGE_QUEUE_STRIDE(slot_size);
+    mq->buffer = buffer;
+    atomic_init(&mq->head, 0);
+    atomic_init(&mq->tail, 0);
+
+    for (uint32_t i = 0; i < mq->slot_count; i++) {
+        atomic_init(mpmc_message_queue_sequence(mq, i), i);
+    }
+
+    return 0;
+}
+
+/**
+ * mpmc_message_queue_push - Push a message into the queue.
+ * @mq: Pointer to the message queue structure.
+ * @data: Pointer to the message to push.
+ *
+ * Safe to call from any number of producers concurrently.
+ *
+ * Return: 0 on success, -ENOBUFS if the queue is full.
+ */
+static inline int mpmc_message_queue_push(struct mpmc_message_queue *mq, const void *data)
+{
+    uint32_t position = atomic_load_explicit(&mq->head, memory_order_relaxed);
+    atomic_uint *sequence;
+
+    while (1) {
+        sequence = mpmc_message_queue_sequence(mq, position);
+        int32_t diff = (int32_t)(atomic_load_explicit(sequence, memory_order_acquire) - position);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&mq->head, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return -ENOBUFS; // Queue is full
+        } else {
+            position = atomic_load_explicit(&mq->head, memory_order_relaxed);
+        }
+    }
+
+    memcpy(mpmc_message_queue_slot(mq, position), data, mq->slot_size);
+    atomic_store_explicit(sequence, position + 1, memory_order_release);
+
+    return 0;
+}
+
+/**
+ * mpmc_message_queue_pop - Remove and retrieve the message at the front of the queue.
+ * @mq: Pointer to the message queue structure.
+ * @data: Pointer to store the popped message.
+ *
+ * Safe to call from any number of consumers concurrently.
+ *
+ * Return: 0 on success, -EAGAIN if the queue is empty.
+ */
+static inline int mpmc_message_queue_pop(struct mpmc_message_queue *mq, void *data)
+{
+    uint32_t position = atomic_load_explicit(&mq->tail, memory_order_relaxed);
+    atomic_uint *sequence;
+
+    while (1) {
+        sequence = mpmc_message_queue_sequence(mq, position);
+        int32_t diff = (int32_t)(atomic_load_explicit(sequence, memory_order_acquire) - (position + 1));
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&mq->tail, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return -EAGAIN; // Queue is empty
+        } else {
+            position = atomic_load_explicit(&mq->tail, memory_order_relaxed);
+        }
+    }
+
+    memcpy(data, mpmc_message_queue_slot(mq, position), mq->slot_size);
+    atomic_store_explicit(sequence, position + mq->slot_count, memory_order_release);
+
+    return 0;
+}
+
+#endif /* MPMC_MESSAGE_QUEUE_H */
@@ -0,0 +1,359 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <errno.h>
+#include "atomic_compat.h"
+#include "cache_line.h"
+
+/*
+ * Fixed-size block pool for the objects embedding the intrusive nodes
+ * (timers, messages, heap and list nodes). The free list is a lock-free
+ * Treiber stack linked through the first word of each free block; its head
+ * packs the block index with a tag bumped on every update, so a block that
+ * is popped and pushed back between another thread's read and CAS (ABA)
+ * does not corrupt the list. Allocation and release are O(1) and never
+ * touch the system allocator.
+ *
+ * The 64-bit head needs lock-free 64-bit atomics to keep the pool lock-free
+ * (e.g. LDREXD/STREXD on ARMv7-A, not available on ARMv6-M).
+ */
+
+/* Index terminating the free list */
+#define OBJECT_POOL_NONE UINT32_MAX
+
+/* Fundamental alignment, spelled for both C and C++ */
+#ifdef __cplusplus
+#define OBJECT_POOL_ALIGN alignof(max_align_t)
+#else
+#define OBJECT_POOL_ALIGN _Alignof(max_align_t)
+#endif
+
+/**
+ * Macro to compute the size of one block, a multiple of the fundamental
+ * alignment large enough to hold the free list link.
+ * @block_size: Size of each object.
+ */
+#define OBJECT_POOL_STRIDE(block_size)                                                   \
+    ((((block_size) < sizeof(atomic_uint) ? sizeof(atomic_uint) : (block_size)) +        \
+      OBJECT_POOL_ALIGN - 1) & ~(OBJECT_POOL_ALIGN - 1))
+
+/**
+ * Macro to declare the storage of an object pool, starting on a cache line.
+ * @name: Name of the buffer.
+ * @blocks: Number of blocks in the pool.
+ * @block_size: Size of each object.
+ */
+#define DECLARE_OBJECT_POOL_BUFFER(name, blocks, block_size) \
+    CACHE_LINE_ALIGNED uint8_t name[(blocks) * OBJECT_POOL_STRIDE(block_size)]
+
+/**
+ * struct object_pool - Lock-free fixed-size block pool
+ * @buffer: Pointer to the block storage.
+ * @block_size: Size of each object in bytes.
+ * @block_count: Number of blocks in the pool.
+ * @stride: Distance in bytes between two blocks.
+ * @free_head: Top of the free list, tag in the upper 32 bits and block index
+ *             in the lower 32 bits.
+ */
+struct object_pool {
+    uint8_t *buffer;
+    uint32_t block_size;
+    uint32_t block_count;
+    uint32_t stride;
+    _Atomic(uint64_t) free_head;
+};
+
+static inline atomic_uint *object_pool_link(struct object_pool *pool, uint32_t block)
+{
+    return (atomic_uint *)&pool->buffer[(size_t)block * pool->stride];
+}
+
+static inline uint64_t object_pool_pack(uint64_t tag, uint32_t block)
+{
+    return (tag << 32) | block;
+}
+
+/**
+ * object_pool_init - Initialize the object pool with every block free.
+ * @pool: Pointer to the object pool structure.
+ * @buffer: Block storage, declared with DECLARE_OBJECT_POOL_BUFFER().
+ * @block_size: Size of each object.
+ * @block_count: Number of blocks in the buffer.
+ *
+ * Must not race with any other operation on the pool.
+ *
+ * Return: 0 on success, -EINVAL if @block_count is 0 or too large.
+ */
+static inline int object_pool_init(struct object_pool *pool, uint8_t *buffer,
+                                   uint32_t block_size, uint32_t block_count)
+{
+    if (!buffer || !block_count || block_count == OBJECT_POOL_NONE) {
+        return -EINVAL;
+    }
+
+    pool->buffer = buffer;
+    pool->block_size = block_size;
+    pool->block_count = block_count;
+    pool->stride = OBJECT_POOL_STRIDE(block_size);
+
+    for (uint32_t i = 0; i < block_count; i++) {
+        atomic_init(object_pool_link(pool, i), (i + 1 < block_count) ? i + 1 : OBJECT_POOL_NONE);
+    }
+
+    atomic_init(&pool->free_head, object_pool_pack(0, 0));
+
+    return 0;
+}
+
+/**
+ * object_pool_index - Get the block index of an object of the pool.
+ * @pool: Pointer to the object pool structure.
+ * @object: Pointer returned by object_pool_alloc().
+ *
+ * Return: index of the block, or OBJECT_POOL_NONE if @object is not the
+ * start of a block of @pool.
+ */
+static inline uint32_t object_pool_index(struct object_pool *pool, const void *object)
+{
+    uintptr_t offset = (uintptr_t)object - (uintptr_t)pool->buffer;
+
+    if ((uintptr_t)object < (uintptr_t)pool->buffer || offset % pool->stride ||
+        offset / pool->stride >= pool->block_count) {
+        return OBJECT_POOL_NONE;
+    }
+
+    return (uint32_t)(offset / pool->stride);
+}
+
+/**
+ * object_pool_push_chain - Give a chain of blocks back to the pool at once.
+ * @pool: Pointer to the object pool structure.
+ * @first: First block of the chain.
+ * @last: Last block of the chain, its link gets overwritten.
+ *
+ * The blocks from @first to @last must already be linked to each other.
+ */
+static inline void object_pool_push_chain(struct object_pool *pool, uint32_t first, uint32_t last)
+{
+    uint64_t head = atomic_load_explicit(&pool->free_head, memory_order_relaxed);
+
+    do {
+        atomic_store_explicit(object_pool_link(pool, last), (uint32_t)head, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->free_head, &head,
+                                                    object_pool_pack((head >> 32) + 1, first),
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+/**
+ * object_pool_alloc - Take a block from the pool.
+ * @pool: Pointer to the object pool structure.
+ *
+ * Safe to call from any number of threads, and from interrupt handlers on
+ * targets with lock-free 64-bit atomics. The block content is undefined.
+ *
+ * Return: pointer to a block of at least block_size bytes, or NULL if the
+ * pool is exhausted.
+ */
+static inline void *object_pool_alloc(struct object_pool *pool)
+{
+    uint64_t head = atomic_load_explicit(&pool->free_head, memory_order_acquire);
+    uint32_t block;
+
+    do {
+        block = (uint32_t)head;
+        if (block == OBJECT_POOL_NONE) {
+            return NULL; // Pool is exhausted
+        }
+    } while (!atomic_compare_exchange_weak_explicit(
+        &pool->free_head, &head,
+        object_pool_pack((head >> 32) + 1,
+                         atomic_load_explicit(object_pool_link(pool, block), memory_order_relaxed)),
+        memory_order_acquire, memory_order_acquire));
+
+    return &pool->buffer[(size_t)block * pool->stride];
+}
+
+/**
+ * object_pool_free - Give a block back to the pool.
+ * @pool: Pointer to the object pool structure.
+ * @object: Pointer returned by object_pool_alloc() on the same pool.
+ *
+ * Return: 0 on success, -EINVAL if @object does not belong to @pool.
+ */
+static inline int object_pool_free(struct object_pool *pool, void *object)
+{
+    uint32_t block = object_pool_index(pool, object);
+
+    if (block == OBJECT_POOL_NONE) {
+        return -EINVAL;
+    }
+
+    object_pool_push_chain(pool, block, block);
+
+    return 0;
+}
+
+/*
+ * Per-thread caches. Each thread (or core) keeps a short private list of
+ * blocks, so most allocations and releases do not touch the shared free
+ * list at all. The cache refills and spills OBJECT_POOL_CACHE_BATCH blocks
+ * at a time, the latter with a single CAS.
+ */
+
+#ifndef OBJECT_POOL_CACHE_SIZE
+#define OBJECT_POOL_CACHE_SIZE 16
+#endif
+
+#define OBJECT_POOL_CACHE_BATCH (OBJECT_POOL_CACHE_SIZE / 2)
+
+#if OBJECT_POOL_CACHE_SIZE < 2
+#error "OBJECT_POOL_CACHE_SIZE must be at least 2"
+#endif
+
+/**
+ * struct object_pool_cache - Private block cache of one thread
+ * @pool: Pool the cached blocks belong to.
+ * @head: First cached block, linked like the free list.
+ * @count: Number of cached blocks.
+ */
+struct object_pool_cache {
+    struct object_pool *pool;
+    uint32_t head;
+    uint32_t count;
+};
+
+/**
+ * object_pool_cache_init - Initialize an empty per-thread cache.
+ * @cache: Pointer to the cache, owned by a single thread.
+ * @pool: Pool to allocate from.
+ */
+static inline void object_pool_cache_init(struct object_pool_cache *cache, struct object_pool *pool)
+{
+    cache->pool = pool;
+    cache->head = OBJECT_POOL_NONE;
+    cache->count = 0;
+}
+
+/**
+ * object_pool_cache_alloc - Take a block, refilling the cache from the pool if empty.
+ * @cache: Pointer to the cache of the calling thread.
+ *
+ * Return: pointer to a block, or NULL if the cache and the pool are empty.
+ */
+static inline void *object_pool_cache_alloc(struct object_pool_cache *cache)
+{
+    struct object_pool *pool = cache->pool;
+
+    if (!cache->count) {
+        while (cache->count < OBJECT_POOL_CACHE_BATCH) {
+            void *object = object_pool_alloc(pool);
+
+            if (!object) {
+                break;
+            }
+
+            atomic_store_explicit((atomic_uint *)object, cache->head, memory_order_relaxed);
+            cache->head = object_pool_index(pool, object);
+            cache->count++;
+        }
+
+        if (!cache->count) {
+            return NULL; // Pool is exhausted
+        }
+    }
+
+    uint32_t block = cache->head;
+    cache->head = atomic_load_explicit(object_pool_link(pool, block), memory_order_relaxed);
+    cache->count--;
+
+    return &pool->buffer[(size_t)block * pool->stride];
+}
+
+/**
+ * object_pool_cache_free - Give a block back to the cache, spilling to the pool if full.
+ * @cache: Pointer to the cache of the calling thread.
+ * @object: Pointer returned by an allocation from the same pool.
+ *
+ * Return: 0 on success, -EINVAL if @object does not belong to the pool.
+ */
+static inline int object_pool_cache_free(struct object_pool_cache *cache, void *object)
+{
+    struct object_pool *pool = cache->pool;
+    uint32_t block = object_pool_index(pool, object);
+
+    if (block == OBJECT_POOL_NONE) {
+        return -EINVAL;
+    }
+
+    if (cache->count == OBJECT_POOL_CACHE_SIZE) {
+        uint32_t first = cache->head;
+        uint32_t last = first;
+
+        for (uint32_t i = 1; i < OBJECT_POOL_CACHE_BATCH; i++) {
+            last = atomic_load_explicit(object_pool_link(pool, last), memory_order_relaxed);
+        }
+
+        cache->head = atomic_load_explicit(object_pool_link(pool, last), memory_order_relaxed);
+        cache->count -= OBJECT_POOL_CACHE_BATCH;
+        object_pool_push_chain(pool, first, last);
+    }
+
+    atomic_store_explicit(object_pool_link(pool, block), cache->head, memory_order_relaxed);
+    cache->head = block;
+    cache->count++;
+
+    return 0;
+}
+
+/**
+ * object_pool_cache_drain - Give every cached block back to the pool.
+ * @cache: Pointer to the cache of the calling thread.
+ *
+ * Call before the owning thread exits.
+ */
+static inline void object_pool_cache_drain(struct object_pool_cache *cache)
+{
+    struct object_pool *pool = cache->pool;
+
+    if (!cache->count) {
+        return;
+    }
+
+    uint32_t last = cache->head;
+    for (uint32_t i = 1; i < cache->count; i++) {
+        last = atomic_load_explicit(object_pool_link(pool, last), memory_order_relaxed);
+    }
+
+    object_pool_push_chain(pool, cache->head, last);
+    cache->head = OBJECT_POOL_NONE;
+    cache->count = 0;
+}
+
+#endif /* OBJECT_POOL_H */
@@ -27,22 +27,99 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <errno.h>
+#include "atomic_compat.h"
+#include "cache_line.h"
+
+#ifndef PING_PONG_BUFFER_MAX
+#define PING_PONG_BUFFER_MAX 8
+#endif
+
+/*
+ * Buffer modes:
+ *
+ * PING_PONG_MODE_QUEUE: frames are handed over in order through N buffers;
+ * the writer gets -EAGAIN only once all of them hold unread frames. With two
+ * buffers this is classic double buffering.
+ *
+ * PING_PONG_MODE_LATEST: triple buffering, the latest frame wins. The writer
+ * never blocks and publishes each frame by exchanging its back buffer with
+ * the middle one; the reader swaps its front buffer with the middle one only
+ * when a fresh frame is there, so it always gets the newest complete frame.
+ */
+#define PING_PONG_MODE_QUEUE  0
+#define PING_PONG_MODE_LATEST 1
+
+/**
+ * DECLARE_PING_PONG_BUFFER - Declare one frame buffer on its own cache lines
+ * @name: Name of the buffer
+ * @size: Size of the frame in bytes
+ */
+#define DECLARE_PING_PONG_BUFFER(name, size) DECLARE_CACHE_LINE_BUFFER(name, size)
+
+/* Marks the middle buffer of the triple buffer as not yet read */
+#define PING_PONG_FRESH 0x80000000u
 
 /**
  * struct ping_pong_buffer - Lock-free ping-pong buffer structure
- * @buffers: Two buffers for double buffering
- * @size: Size of each buffer (must be identical for both)
- * @write_index: Index of the buffer currently writable by the producer
- * @read_index: Index of the buffer currently readable by the consumer
+ * @buffers: Buffers frames are written to and read from
+ * @size: Size of each buffer (must be identical for all)
+ * @count: Number of buffers in use
+ * @mode: PING_PONG_MODE_QUEUE or PING_PONG_MODE_LATEST
+ * @write_index: Queue mode: producer position, wrapping at 2 * @count;
+ *               latest mode: back buffer owned by the producer
+ * @lengths: Number of valid bytes written to each buffer
+ * @read_index: Queue mode: consumer position, wrapping at 2 * @count;
+ *              latest mode: front buffer owned by the consumer
+ * @latest: Latest mode only: middle buffer, tagged with PING_PONG_FRESH
+ *
+ * The read-mostly configuration comes first, followed by the producer-owned
+ * fields, the consumer-owned index and the exchanged middle buffer. With
+ * QUEUE_CACHE_LINE_LAYOUT each of the latter groups gets its own cache line.
  */
 struct ping_pong_buffer {
-	uint8_t *buffers[2];
+	uint8_t *buffers[PING_PONG_BUFFER_MAX];
 	uint32_t size;
-	volatile uint32_t write_index;
-	volatile uint32_t read_index;
+	uint32_t count;
+	uint32_t mode;
+	CACHE_LINE_SEPARATE atomic_uint write_index;
+	uint32_t lengths[PING_PONG_BUFFER_MAX];
+	CACHE_LINE_SEPARATE atomic_uint read_index;
+	CACHE_LINE_SEPARATE atomic_uint latest;
 };
 
+/**
+ * ping_pong_buffer_init_n - Initialize an N-buffer queue
+ * @ppb: Pointer to the ping-pong buffer structure
+ * @buffers: Array of @count buffers
+ * @count: Number of buffers, between 2 and PING_PONG_BUFFER_MAX
+ * @size: Size of each buffer
+ *
+ * Return: 0 on success, or -EINVAL if @count is out of range
+ */
+static inline int ping_pong_buffer_init_n(struct ping_pong_buffer *ppb, uint8_t *const buffers[], uint32_t count,
+					  uint32_t size)
+{
+	if (count < 2 || count > PING_PONG_BUFFER_MAX) {
+		return -EINVAL;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		ppb->buffers[i] = buffers[i];
+		ppb->lengths[i] = 0;
+	}
+
+	ppb->size = size;
+	ppb->count = count;
+	ppb->mode = PING_PONG_MODE_QUEUE;
+	atomic_init(&ppb->write_index, 0);
+	atomic_init(&ppb->read_index, 0);
+	atomic_init(&ppb->latest, 0);
+
+	return 0;
+}
+
 /**
  * ping_pong_buffer_init - Initialize the ping-pong buffer
  * @ppb: Pointer to the ping-pong buffer structure
@@ -52,11 +129,158 @@ struct ping_pong_buffer {
  */
 static inline void ping_pong_buffer_init(struct ping_pong_buffer *ppb, uint8_t *buffer1, uint8_t *buffer2, uint32_t size)
 {
-	ppb->buffers[0] = buffer1;
-	ppb->buffers[1] = buffer2;
-	ppb->size = size;
-	ppb->write_index = 0;
-	ppb->read_index = 1;
+	uint8_t *const buffers[2] = { buffer1, buffer2 };
+
+	ping_pong_buffer_init_n(ppb, buffers, 2, size);
+}
+
+/**
+ * ping_pong_buffer_init_triple - Initialize a latest-value-wins triple buffer
+ * @ppb: Pointer to the ping-pong buffer structure
+ * @buffer1: Pointer to the first buffer
+ * @buffer2: Pointer to the second buffer
+ * @buffer3: Pointer to the third buffer
+ * @size: Size of each buffer
+ */
+static inline void ping_pong_buffer_init_triple(struct ping_pong_buffer *ppb, uint8_t *buffer1, uint8_t *buffer2,
+						uint8_t *buffer3, uint32_t size)
+{
+	uint8_t *const buffers[3] = { buffer1, buffer2, buffer3 };
+
+	ping_pong_buffer_init_n(ppb, buffers, 3, size);
+	ppb->mode = PING_PONG_MODE_LATEST;
+	atomic_init(&ppb->write_index, 0);
+	atomic_init(&ppb->latest, 1);
+	atomic_init(&ppb->read_index, 2);
+}
+
+/* Queue mode positions run over [0, 2 * count) to tell full from empty */
+static inline uint32_t ping_pong_buffer_next(const struct ping_pong_buffer *ppb, uint32_t index)
+{
+	return (index + 1 == 2 * ppb->count) ? 0 : index + 1;
+}
+
+static inline uint32_t ping_pong_buffer_slot(const struct ping_pong_buffer *ppb, uint32_t index)
+{
+	return (index < ppb->count) ? index : index - ppb->count;
+}
+
+static inline uint32_t ping_pong_buffer_pending(const struct ping_pong_buffer *ppb, uint32_t write, uint32_t read)
+{
+	return (write >= read) ? write - read : write + 2 * ppb->count - read;
+}
+
+/**
+ * ping_pong_acquire_write - Get the buffer the next frame can be written to in place
+ * @ppb: Pointer to the ping-pong buffer structure
+ *
+ * The buffer stays owned by the writer until ping_pong_commit_write() hands
+ * it over, so DMA can fill it while the reader works on another one. In
+ * latest mode a buffer is always available.
+ *
+ * Return: pointer to a buffer of @ppb->size bytes, or NULL if every buffer
+ *         holds an unread frame
+ */
+static inline uint8_t *ping_pong_acquire_write(struct ping_pong_buffer *ppb)
+{
+	uint32_t write = atomic_load_explicit(&ppb->write_index, memory_order_relaxed);
+
+	if (ppb->mode == PING_PONG_MODE_LATEST) {
+		return ppb->buffers[write];
+	}
+
+	/* Check if there is a buffer the reader is not holding */
+	if (ping_pong_buffer_pending(ppb, write, atomic_load_explicit(&ppb->read_index, memory_order_acquire)) ==
+	    ppb->count) {
+		return NULL;
+	}
+
+	return ppb->buffers[ping_pong_buffer_slot(ppb, write)];
+}
+
+/**
+ * ping_pong_commit_write - Hand the acquired write buffer over to the reader
+ * @ppb: Pointer to the ping-pong buffer structure
+ * @length: Number of valid bytes written to the buffer
+ *
+ * Must follow a successful ping_pong_acquire_write(). In latest mode any
+ * frame not read yet is replaced.
+ *
+ * Return: 0 on success, or -EINVAL if @length exceeds the buffer size
+ */
+static inline int ping_pong_commit_write(struct ping_pong_buffer *ppb, uint32_t length)
+{
+	uint32_t write = atomic_load_explicit(&ppb->write_index, memory_order_relaxed);
+
+	if (length > ppb->size) {
+		return -EINVAL;
+	}
+
+	if (ppb->mode == PING_PONG_MODE_LATEST) {
+		ppb->lengths[write] = length;
+		write = atomic_exchange_explicit(&ppb->latest, write | PING_PONG_FRESH, memory_order_acq_rel);
+		atomic_store_explicit(&ppb->write_index, write & ~PING_PONG_FRESH, memory_order_relaxed);
+	} else {
+		ppb->lengths[ping_pong_buffer_slot(ppb, write)] = length;
+		atomic_store_explicit(&ppb->write_index, ping_pong_buffer_next(ppb, write), memory_order_release);
+	}
+
+	return 0;
+}
+
+/**
+ * ping_pong_acquire_read - Get the next complete frame to process in place
+ * @ppb: Pointer to the ping-pong buffer structure
+ * @length: Optional pointer to store the number of valid bytes in the frame
+ *
+ * The buffer stays owned by the reader until ping_pong_release_read(). In
+ * latest mode the newest frame is taken and older unread frames are dropped.
+ *
+ * Return: pointer to the frame, or NULL if no unread frame is available
+ */
+static inline uint8_t *ping_pong_acquire_read(struct ping_pong_buffer *ppb, uint32_t *length)
+{
+	uint32_t read = atomic_load_explicit(&ppb->read_index, memory_order_relaxed);
+
+	if (ppb->mode == PING_PONG_MODE_LATEST) {
+		/* Take the middle buffer only if a frame was published since */
+		if (!(atomic_load_explicit(&ppb->latest, memory_order_relaxed) & PING_PONG_FRESH)) {
+			return NULL;
+		}
+
+		read = atomic_exchange_explicit(&ppb->latest, read, memory_order_acq_rel) & ~PING_PONG_FRESH;
+		atomic_store_explicit(&ppb->read_index, read, memory_order_relaxed);
+	} else {
+		/* Check if the writer has handed over a buffer */
+		if (atomic_load_explicit(&ppb->write_index, memory_order_acquire) == read) {
+			return NULL;
+		}
+
+		read = ping_pong_buffer_slot(ppb, read);
+	}
+
+	if (length) {
+		*length = ppb->lengths[read];
+	}
+
+	return ppb->buffers[read];
+}
+
+/**
+ * ping_pong_release_read - Give the acquired read buffer back to the writer
+ * @ppb: Pointer to the ping-pong buffer structure
+ *
+ * Must follow a successful ping_pong_acquire_read(). In latest mode the front
+ * buffer stays with the reader until it acquires a newer frame, so this is a
+ * no-op.
+ */
+static inline void ping_pong_release_read(struct ping_pong_buffer *ppb)
+{
+	if (ppb->mode == PING_PONG_MODE_QUEUE) {
+		uint32_t read = atomic_load_explicit(&ppb->read_index, memory_order_relaxed);
+
+		atomic_store_explicit(&ppb->read_index, ping_pong_buffer_next(ppb, read), memory_order_release);
+	}
 }
 
 /**
@@ -65,60 +289,83 @@ static inline void ping_pong_buffer_init(struct ping_pong_buffer *ppb, uint8_t *
  * @data: Pointer to the data to write
  * @length: Length of the data to write
  *
- * Return: 0 on success, or -EAGAIN if the writable buffer is being read
+ * In latest mode the write always succeeds, replacing any unread frame.
+ *
+ * Return: 0 on success, or -EAGAIN if every buffer holds an unread frame
  */
 static inline int ping_pong_buffer_write(struct ping_pong_buffer *ppb, const uint8_t *data, uint32_t length)
 {
+	uint8_t *write_buffer;
+
 	if (length > ppb->size) {
 		return -EINVAL;
 	}
 
-	/* Check if the writable buffer is not being read */
-	if (ppb->write_index == ppb->read_index) {
+	write_buffer = ping_pong_acquire_write(ppb);
+	if (!write_buffer) {
 		return -EAGAIN;
 	}
 
-	/* Copy data into the writable buffer */
-	uint8_t *write_buffer = ppb->buffers[ppb->write_index];
-	for (uint32_t i = 0; i < length; i++) {
-		write_buffer[i] = data[i];
-	}
-
-	/* Swap the buffers */
-	ppb->write_index ^= 1;
+	memcpy(write_buffer, data, length);
 
-	return 0;
+	return ping_pong_commit_write(ppb, length);
 }
 
 /**
- * ping_pong_buffer_read - Read data from the readable buffer
+ * ping_pong_buffer_read_len - Read data and report how many bytes were copied
  * @ppb: Pointer to the ping-pong buffer structure
  * @data: Pointer to store the read data
- * @length: Length of the data to read
+ * @length: Maximum length of the data to read
+ * @copied: Set to the number of bytes copied on success, may be NULL
  *
- * Return: 0 on success, or -EAGAIN if the readable buffer is being written to
+ * Copies at most the valid length recorded for the frame. In latest mode the
+ * newest complete frame is returned and older unread frames are dropped.
+ *
+ * Return: 0 on success, -EINVAL if @length exceeds the buffer size, or
+ * -EAGAIN if no unread frame is available
  */
-static inline int ping_pong_buffer_read(struct ping_pong_buffer *ppb, uint8_t *data, uint32_t length)
+static inline int ping_pong_buffer_read_len(struct ping_pong_buffer *ppb, uint8_t *data, uint32_t length,
+					    uint32_t *copied)
 {
+	uint32_t valid;
+	uint8_t *read_buffer;
+
 	if (length > ppb->size) {
 		return -EINVAL;
 	}
 
-	/* Check if the readable buffer is not being written */
-	if (ppb->write_index != ppb->read_index) {
+	read_buffer = ping_pong_acquire_read(ppb, &valid);
+	if (!read_buffer) {
 		return -EAGAIN;
 	}
 
-	/* Copy data from the readable buffer */
-	uint8_t *read_buffer = ppb->buffers[ppb->read_index];
-	for (uint32_t i = 0; i < length; i++) {
-		data[i] = read_buffer[i];
+	if (length > valid) {
+		length = valid;
 	}
 
-	/* Swap the buffers */
-	ppb->read_index ^= 1;
+	memcpy(data, read_buffer, length);
+	ping_pong_release_read(ppb);
+
+	if (copied) {
+		*copied = length;
+	}
 
 	return 0;
 }
 
+/**
+ * ping_pong_buffer_read - Read data from the readable buffer
+ * @ppb: Pointer to the ping-pong buffer structure
+ * @data: Pointer to store the read data
+ * @length: Maximum length of the data to read
+ *
+ * Use ping_pong_buffer_read_len() when the frame length is needed.
+ *
+ * Return: 0 on success, or -EAGAIN if the readable buffer is being written to
+ */
+static inline int ping_pong_buffer_read(struct ping_pong_buffer *ppb, uint8_t *data, uint32_t length)
+{
+	return ping_pong_buffer_read_len(ppb, data, length, NULL);
+}
+
 #endif /* PING_PONG_BUFFER_H */
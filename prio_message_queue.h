@@ -0,0 +1,284 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PRIO_MESSAGE_QUEUE_H
+#define PRIO_MESSAGE_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include "cache_line.h"
+
+/*
+ * Bounded message queue with a small number of FIFO priority bands. Slots
+ * come from one shared pool and are chained per band through a link word in
+ * front of each message, so urgent messages overtake bulk data without any
+ * allocation or per-message heap node. A bitmap of non-empty bands makes push
+ * and pop O(1). Band 0 is the most urgent one.
+ */
+
+#ifndef PRIO_MESSAGE_QUEUE_BANDS
+#define PRIO_MESSAGE_QUEUE_BANDS 8
+#endif
+
+#if PRIO_MESSAGE_QUEUE_BANDS < 1 || PRIO_MESSAGE_QUEUE_BANDS > 32
+#error "PRIO_MESSAGE_QUEUE_BANDS must be between 1 and 32"
+#endif
+
+/* Link value terminating a band or the free list */
+#define PRIO_MESSAGE_QUEUE_NONE UINT32_MAX
+
+/**
+ * Bytes reserved in front of each message for the slot link.
+ */
+#define PRIO_MESSAGE_QUEUE_SLOT_HEADER 4
+
+/**
+ * Macro to compute the size of one slot, keeping the links 4-byte aligned.
+ * @message_size: Size of each message.
+ */
+#define PRIO_MESSAGE_QUEUE_STRIDE(message_size) \
+    ((((message_size) + PRIO_MESSAGE_QUEUE_SLOT_HEADER) + 3) & ~3u)
+
+/**
+ * Macro to declare a buffer suitable for the priority message queue, starting
+ * on a cache line.
+ * @slots: Number of slots in the queue, need not be a power of two.
+ * @message_size: Size of each message.
+ */
+#define DECLARE_PRIO_MESSAGE_QUEUE_BUFFER(slots, message_size) \
+    CACHE_LINE_ALIGNED uint8_t buffer[(slots) * PRIO_MESSAGE_QUEUE_STRIDE(message_size)]
+
+/**
+ * struct prio_message_queue - Fixed-size message queue with priority bands
+ * @buffer: Pointer to the slot storage.
+ * @slot_size: Size of each message in bytes.
+ * @slot_count: Number of slots in the queue.
+ * @stride: Distance in bytes between two slots.
+ * @count: Number of queued messages.
+ * @free_head: First slot of the free list.
+ * @bitmap: Bit n is set when band n holds messages.
+ * @band_head: Oldest message of each band.
+ * @band_tail: Newest message of each band.
+ */
+struct prio_message_queue {
+    uint8_t *buffer;
+    uint32_t slot_size;
+    uint32_t slot_count;
+    uint32_t stride;
+    uint32_t count;
+    uint32_t free_head;
+    uint32_t bitmap;
+    uint32_t band_head[PRIO_MESSAGE_QUEUE_BANDS];
+    uint32_t band_tail[PRIO_MESSAGE_QUEUE_BANDS];
+};
+
+static inline uint32_t *prio_message_queue_link(struct prio_message_queue *mq, uint32_t slot)
+{
+    return (uint32_t *)&mq->buffer[(size_t)slot * mq->stride];
+}
+
+static inline uint8_t *prio_message_queue_slot(struct prio_message_queue *mq, uint32_t slot)
+{
+    return &mq->buffer[(size_t)slot * mq->stride + PRIO_MESSAGE_QUEUE_SLOT_HEADER];
+}
+
+/* Most urgent non-empty band, the bitmap must not be zero */
+static inline uint32_t prio_message_queue_first_band(uint32_t bitmap)
+{
+#ifdef __GNUC__
+    return (uint32_t)__builtin_ctz(bitmap);
+#else
+    uint32_t band = 0;
+
+    while (!(bitmap & 1)) {
+        bitmap >>= 1;
+        band++;
+    }
+
+    return band;
+#endif
+}
+
+/**
+ * prio_message_queue_flush - Flush all messages in the queue.
+ * @mq: Pointer to the message queue structure.
+ */
+static inline void prio_message_queue_flush(struct prio_message_queue *mq)
+{
+    for (uint32_t i = 0; i < mq->slot_count; i++) {
+        *prio_message_queue_link(mq, i) = (i + 1 < mq->slot_count) ? i + 1 : PRIO_MESSAGE_QUEUE_NONE;
+    }
+
+    for (uint32_t band = 0; band < PRIO_MESSAGE_QUEUE_BANDS; band++) {
+        mq->band_head[band] = PRIO_MESSAGE_QUEUE_NONE;
+        mq->band_tail[band] = PRIO_MESSAGE_QUEUE_NONE;
+    }
+
+    mq->free_head = mq->slot_count ? 0 : PRIO_MESSAGE_QUEUE_NONE;
+    mq->bitmap = 0;
+    mq->count = 0;
+}
+
+/**
+ * prio_message_queue_init - Initialize the priority message queue.
+ * @mq: Pointer to the message queue structure.
+ * @buffer: Slot storage, declared with DECLARE_PRIO_MESSAGE_QUEUE_BUFFER().
+ * @slot_size: Size of each message.
+ * @slot_count: Number of slots in the buffer.
+ *
+ * Return: 0 on success, -EINVAL if @slot_count is 0 or too large.
+ */
+static inline int prio_message_queue_init(struct prio_message_queue *mq, uint8_t *buffer,
+                                          uint32_t slot_size, uint32_t slot_count)
+{
+    if (!slot_count || slot_count == PRIO_MESSAGE_QUEUE_NONE) {
+        return -EINVAL;
+    }
+
+    mq->buffer = buffer;
+    mq->slot_size = slot_size;
+    mq->slot_count = slot_count;
+    mq->stride = PRIO_MESSAGE_QUEUE_STRIDE(slot_size);
+    prio_message_queue_flush(mq);
+
+    return 0;
+}
+
+/**
+ * prio_message_queue_push - Push a message into one priority band.
+ * @mq: Pointer to the message queue structure.
+ * @data: Pointer to the message to push.
+ * @priority: Band of the message, 0 being the most urgent.
+ *
+ * Messages of the same band come out in the order they were pushed.
+ *
+ * Return: 0 on success, -EINVAL if @priority is out of range, -ENOBUFS if
+ * the queue is full.
+ */
+static inline int prio_message_queue_push(struct prio_message_queue *mq, const void *data, uint32_t priority)
+{
+    if (priority >= PRIO_MESSAGE_QUEUE_BANDS) {
+        return -EINVAL;
+    }
+
+    uint32_t slot = mq->free_head;
+    if (slot == PRIO_MESSAGE_QUEUE_NONE) {
+        return -ENOBUFS; // Queue is full
+    }
+
+    uint32_t *link = prio_message_queue_link(mq, slot);
+    mq->free_head = *link;
+    *link = PRIO_MESSAGE_QUEUE_NONE;
+
+    memcpy(prio_message_queue_slot(mq, slot), data, mq->slot_size);
+
+    if (mq->band_tail[priority] == PRIO_MESSAGE_QUEUE_NONE) {
+        mq->band_head[priority] = slot;
+        mq->bitmap |= 1u << priority;
+    } else {
+        *prio_message_queue_link(mq, mq->band_tail[priority]) = slot;
+    }
+
+    mq->band_tail[priority] = slot;
+    mq->count++;
+
+    return 0;
+}
+
+/**
+ * prio_message_queue_peek - Peek at the most urgent message.
+ * @mq: Pointer to the message queue structure.
+ * @data: Pointer to store the peeked message.
+ * @priority: Optional pointer to store the band of the message.
+ *
+ * Return: 0 on success, -EAGAIN if the queue is empty.
+ */
+static inline int prio_message_queue_peek(struct prio_message_queue *mq, void *data, uint32_t *priority)
+{
+    if (!mq->bitmap) {
+        return -EAGAIN; // Queue is empty
+    }
+
+    uint32_t band = prio_message_queue_first_band(mq->bitmap);
+
+    memcpy(data, prio_message_queue_slot(mq, mq->band_head[band]), mq->slot_size);
+
+    if (priority) {
+        *priority = band;
+    }
+
+    return 0;
+}
+
+/**
+ * prio_message_queue_pop - Remove and retrieve the most urgent message.
+ * @mq: Pointer to the message queue structure.
+ * @data: Pointer to store the popped message.
+ * @priority: Optional pointer to store the band of the message.
+ *
+ * Return: 0 on success, -EAGAIN if the queue is empty.
+ */
+static inline int prio_message_queue_pop(struct prio_message_queue *mq, void *data, uint32_t *priority)
+{
+    if (!mq->bitmap) {
+        return -EAGAIN; // Queue is empty
+    }
+
+    uint32_t band = prio_message_queue_first_band(mq->bitmap);
+    uint32_t slot = mq->band_head[band];
+    uint32_t *link = prio_message_queue_link(mq, slot);
+
+    memcpy(data, prio_message_queue_slot(mq, slot), mq->slot_size);
+
+    mq->band_head[band] = *link;
+    if (*link == PRIO_MESSAGE_QUEUE_NONE) {
+        mq->band_tail[band] = PRIO_MESSAGE_QUEUE_NONE;
+        mq->bitmap &= ~(1u << band);
+    }
+
+    *link = mq->free_head;
+    mq->free_head = slot;
+    mq->count--;
+
+    if (priority) {
+        *priority = band;
+    }
+
+    return 0;
+}
+
+/**
+ * prio_message_queue_count - Get the number of queued messages.
+ * @mq: Pointer to the message queue structure.
+ *
+ * Return: number of messages in all bands.
+ */
+static inline uint32_t prio_message_queue_count(const struct prio_message_queue *mq)
+{
+    return mq->count;
+}
+
+#endif /* PRIO_MESSAGE_QUEUE_H */
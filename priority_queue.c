@@ -24,6 +24,7 @@
 
 #include "priority_queue.h"
 #include <errno.h>
+#include <stdlib.h>
 
 #ifdef __GNUC__
 #define likely(x) __builtin_expect(!!(x), 1)
@@ -33,83 +34,637 @@
 #define unlikely(x) (x)
 #endif
 
-static inline void swap_nodes(struct heap_node *a, struct heap_node *b)
+#ifdef PQ_USE_ARRAY_HEAP
+
+/*
+ * Heap slot accessors. With PQ_INLINE_KEY a slot caches the key of its node,
+ * so comparisons are integer compares on the heap array itself; otherwise a
+ * slot is the node pointer and comparisons go through the callback.
+ */
+#ifdef PQ_INLINE_KEY
+
+#define PQ_SLOT_NODE(slot) ((slot).node)
+
+/* Keys order the heap, the comparison callback is optional */
+#define PQ_KEY_ONLY 1
+
+static inline PQ_SLOT pq_make_slot(struct heap_node *node)
+{
+    return (PQ_SLOT){ .key = node->key, .node = node };
+}
+
+static inline bool pq_before(struct priority_queue *pq, PQ_SLOT a, PQ_SLOT b)
+{
+#ifdef PQ_STATS
+    stat_inc(&pq->compares);
+#else
+    (void)pq;
+#endif
+    return a.key < b.key;
+}
+
+#else
+
+#define PQ_SLOT_NODE(slot) (slot)
+#define PQ_KEY_ONLY 0
+
+static inline PQ_SLOT pq_make_slot(struct heap_node *node)
+{
+    return node;
+}
+
+static inline bool pq_before(struct priority_queue *pq, PQ_SLOT a, PQ_SLOT b)
+{
+#ifdef PQ_STATS
+    stat_inc(&pq->compares);
+#endif
+    return pq->compare(a, b) > 0;
+}
+
+#endif /* PQ_INLINE_KEY */
+
+/* Record the current size as a new maximum, no-op without PQ_STATS */
+static inline void pq_stat_size(struct priority_queue *pq)
+{
+#ifdef PQ_STATS
+    stat_max(&pq->max_size, pq->size);
+#else
+    (void)pq;
+#endif
+}
+
+static inline void pq_stat_init(struct priority_queue *pq)
+{
+#ifdef PQ_STATS
+    stat_init(&pq->compares);
+    stat_init(&pq->max_size);
+#else
+    (void)pq;
+#endif
+}
+
+static inline void pq_place(struct priority_queue *pq, uint32_t index, PQ_SLOT slot)
+{
+    pq->nodes[index] = slot;
+    PQ_SLOT_NODE(slot)->index = index;
+}
+
+static uint32_t pq_sift_up(struct priority_queue *pq, uint32_t index)
+{
+    PQ_SLOT slot = pq->nodes[index];
+
+    while (index > 0) {
+        uint32_t parent = (index - 1) / PQ_HEAP_ARITY;
+
+        if (!pq_before(pq, slot, pq->nodes[parent])) {
+            break;
+        }
+
+        pq_place(pq, index, pq->nodes[parent]);
+        index = parent;
+    }
+
+    pq_place(pq, index, slot);
+    return index;
+}
+
+static uint32_t pq_sift_down(struct priority_queue *pq, uint32_t index)
+{
+    PQ_SLOT slot = pq->nodes[index];
+    uint32_t size = pq->size;
+
+    while (1) {
+        size_t first = (size_t)index * PQ_HEAP_ARITY + 1;
+
+        if (first >= size) {
+            break;
+        }
+
+        size_t last = first + PQ_HEAP_ARITY;
+        if (last > size) {
+            last = size;
+        }
+
+        size_t best = first;
+        for (size_t child = first + 1; child < last; child++) {
+            if (pq_before(pq, pq->nodes[child], pq->nodes[best])) {
+                best = child;
+            }
+        }
+
+        if (!pq_before(pq, pq->nodes[best], slot)) {
+            break;
+        }
+
+        pq_place(pq, index, pq->nodes[best]);
+        index = (uint32_t)best;
+    }
+
+    pq_place(pq, index, slot);
+    return index;
+}
+
+static inline bool pq_queued(struct priority_queue *pq, struct heap_node *node)
+{
+    return node->index < pq->size && PQ_SLOT_NODE(pq->nodes[node->index]) == node;
+}
+
+static void pq_heapify(struct priority_queue *pq)
+{
+    if (pq->size < 2) {
+        return;
+    }
+
+    for (uint32_t index = (pq->size - 2) / PQ_HEAP_ARITY + 1; index-- > 0;) {
+        pq_sift_down(pq, index);
+    }
+}
+
+/* Fix up the nodes appended in lazy mode or by a batch insert */
+static void pq_settle(struct priority_queue *pq)
 {
-    struct heap_node temp = *a;
-    *a = *b;
-    *b = temp;
+    uint32_t pending = pq->size - pq->settled;
+
+    if (likely(!pending)) {
+        return;
+    }
 
-    if (a->parent == b) {
-        a->parent = b->parent;
-        b->parent = a;
-    } else if (b->parent == a) {
-        b->parent = a->parent;
-        a->parent = b;
+    /* Heapify is O(n), sifting each node up O(pending * log n) */
+    if ((uint64_t)pending * 4 >= pq->size) {
+        pq_heapify(pq);
     } else {
-        struct heap_node *temp_parent = a->parent;
-        a->parent = b->parent;
-        b->parent = temp_parent;
+        for (uint32_t index = pq->settled; index < pq->size; index++) {
+            pq_sift_up(pq, index);
+        }
     }
+
+    pq->settled = pq->size;
+}
+
+static int pq_grow(struct priority_queue *pq, uint32_t needed)
+{
+    if (!pq->owns_storage) {
+        return -ENOBUFS;
+    }
+
+    uint32_t capacity = pq->capacity ? pq->capacity : PQ_INITIAL_CAPACITY;
+    while (capacity < needed && capacity <= UINT32_MAX / 2) {
+        capacity *= 2;
+    }
+
+    if (unlikely(capacity < needed || capacity <= pq->capacity)) {
+        return -ENOMEM;
+    }
+
+    PQ_SLOT *nodes = realloc(pq->nodes, (size_t)capacity * sizeof(*nodes));
+    if (unlikely(!nodes)) {
+        return -ENOMEM;
+    }
+
+    pq->nodes = nodes;
+    pq->capacity = capacity;
+
+    return 0;
 }
 
 int pq_init(struct priority_queue *pq, int (*compare)(struct heap_node *, struct heap_node *))
 {
-    if (unlikely(!pq || !compare)) {
+    if (unlikely(!pq || (!compare && !PQ_KEY_ONLY))) {
         return -EINVAL;
     }
 
-    pq->head = NULL;
-    pq->tail = NULL;
-    pq->root = NULL;
+    pq->nodes = NULL;
+    pq->size = 0;
+    pq->capacity = 0;
+    pq->settled = 0;
+    pq->owns_storage = true;
+    pq->lazy = false;
     pq->compare = compare;
+    pq_stat_init(pq);
 
     return 0;
 }
 
+int pq_init_storage(struct priority_queue *pq, int (*compare)(struct heap_node *, struct heap_node *),
+                    PQ_SLOT *storage, uint32_t capacity)
+{
+    if (unlikely(!pq || (!compare && !PQ_KEY_ONLY) || !storage || !capacity)) {
+        return -EINVAL;
+    }
+
+    pq->nodes = storage;
+    pq->size = 0;
+    pq->capacity = capacity;
+    pq->settled = 0;
+    pq->owns_storage = false;
+    pq->lazy = false;
+    pq->compare = compare;
+    pq_stat_init(pq);
+
+    return 0;
+}
+
+void pq_deinit(struct priority_queue *pq)
+{
+    if (unlikely(!pq)) {
+        return;
+    }
+
+    if (pq->owns_storage) {
+        free(pq->nodes);
+        pq->nodes = NULL;
+        pq->capacity = 0;
+    }
+
+    pq->size = 0;
+    pq->settled = 0;
+}
+
 int pq_insert(struct priority_queue *pq, struct heap_node *node)
 {
     if (unlikely(!pq || !node)) {
         return -EINVAL;
     }
 
-    if (!pq->head) {
-        pq->head = pq->tail = pq->root = node;
-        node->parent = node->next = node->prev = NULL;
-    } else {
-        pq->tail->next = node;
-        node->prev = pq->tail;
-        pq->tail = node;
-        node->next = NULL;
+    if (unlikely(pq_queued(pq, node))) {
+        return -EEXIST;
+    }
+
+    if (unlikely(pq->size == pq->capacity)) {
+        int ret = pq_grow(pq, pq->size + 1);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    pq_place(pq, pq->size++, pq_make_slot(node));
+    pq_stat_size(pq);
+
+    if (!pq->lazy && pq->settled == pq->size - 1) {
+        pq_sift_up(pq, node->index);
+        pq->settled = pq->size;
+    }
+
+    return 0;
+}
+
+static int pq_append_batch(struct priority_queue *pq, struct heap_node **nodes, uint32_t n)
+{
+    uint32_t start = pq->size;
+
+    if (unlikely(n > UINT32_MAX - 1 - start)) {
+        return -ENOMEM;
+    }
+
+    if (start + n > pq->capacity) {
+        int ret = pq_grow(pq, start + n);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (unlikely(!nodes[i] || pq_queued(pq, nodes[i]))) {
+            /* Roll back, so that a failed batch leaves the queue untouched */
+            while (pq->size > start) {
+                PQ_SLOT_NODE(pq->nodes[--pq->size])->index = PQ_INDEX_NONE;
+            }
+            return nodes[i] ? -EEXIST : -EINVAL;
+        }
+
+        pq_place(pq, pq->size++, pq_make_slot(nodes[i]));
     }
 
+    pq_stat_size(pq);
     return 0;
 }
 
+int pq_insert_batch(struct priority_queue *pq, struct heap_node **nodes, uint32_t n)
+{
+    if (unlikely(!pq || (!nodes && n))) {
+        return -EINVAL;
+    }
+
+    int ret = pq_append_batch(pq, nodes, n);
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (!pq->lazy) {
+        pq_settle(pq);
+    }
+
+    return 0;
+}
+
+/* Index of a node listed for pq_build(), while the list is being validated */
+#define PQ_INDEX_BUILD (UINT32_MAX - 1)
+
+/*
+ * Check the nodes of a pq_build() before the queue is modified: each is
+ * marked with PQ_INDEX_BUILD to catch duplicates. On failure the marks are
+ * undone and the queued nodes get their slot back, so the queue is intact.
+ */
+static int pq_build_check(struct priority_queue *pq, struct heap_node **nodes, uint32_t n)
+{
+    int ret = 0;
+    uint32_t i;
+
+    if (unlikely(n > UINT32_MAX - 2)) {
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (unlikely(!nodes[i])) {
+            ret = -EINVAL;
+            break;
+        }
+
+        if (unlikely(nodes[i]->index == PQ_INDEX_BUILD)) {
+            ret = -EEXIST;
+            break;
+        }
+
+        nodes[i]->index = PQ_INDEX_BUILD;
+    }
+
+    if (!ret && n > pq->capacity) {
+        ret = pq_grow(pq, n);
+    }
+
+    if (unlikely(ret < 0)) {
+        while (i-- > 0) {
+            nodes[i]->index = PQ_INDEX_NONE;
+        }
+        for (i = 0; i < pq->size; i++) {
+            PQ_SLOT_NODE(pq->nodes[i])->index = i;
+        }
+    }
+
+    return ret;
+}
+
+int pq_build(struct priority_queue *pq, struct heap_node **nodes, uint32_t n)
+{
+    if (unlikely(!pq || (!nodes && n))) {
+        return -EINVAL;
+    }
+
+    int ret = pq_build_check(pq, nodes, n);
+    if (ret < 0) {
+        return ret;
+    }
+
+    /* Drop the nodes not listed again, the listed ones are all placed below */
+    for (uint32_t i = 0; i < pq->size; i++) {
+        struct heap_node *node = PQ_SLOT_NODE(pq->nodes[i]);
+
+        if (node->index != PQ_INDEX_BUILD) {
+            node->index = PQ_INDEX_NONE;
+        }
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        pq_place(pq, i, pq_make_slot(nodes[i]));
+    }
+    pq->size = n;
+    pq_stat_size(pq);
+
+    pq_heapify(pq);
+    pq->settled = pq->size;
+
+    return 0;
+}
+
+void pq_set_lazy(struct priority_queue *pq, bool lazy)
+{
+    if (unlikely(!pq)) {
+        return;
+    }
+
+    pq->lazy = lazy;
+
+    if (!lazy) {
+        pq_settle(pq);
+    }
+}
+
 struct heap_node *pq_pop(struct priority_queue *pq)
 {
     if (unlikely(!pq)) {
         return NULL;
     }
 
-    if (!pq->head) {
+    if (!pq->size) {
         return NULL;
     }
 
-    struct heap_node *root = pq->root;
+    pq_settle(pq);
+
+    struct heap_node *root = PQ_SLOT_NODE(pq->nodes[0]);
 
-    if (pq->head == pq->tail) {
-        pq->head = pq->tail = pq->root = NULL;
-        return root;
+    if (--pq->size) {
+        pq_place(pq, 0, pq->nodes[pq->size]);
+        pq_sift_down(pq, 0);
     }
+    pq->settled = pq->size;
 
-    pq->root = pq->tail;
+    root->index = PQ_INDEX_NONE;
+    return root;
+}
+
+struct heap_node *pq_peek(struct priority_queue *pq)
+{
+    if (unlikely(!pq || !pq->size)) {
+        return NULL;
+    }
+
+    pq_settle(pq);
+
+    return PQ_SLOT_NODE(pq->nodes[0]);
+}
+
+int pq_remove(struct priority_queue *pq, struct heap_node *node)
+{
+    if (unlikely(!pq || !node)) {
+        return -EINVAL;
+    }
+
+    if (!pq_queued(pq, node)) {
+        return -ENOENT;
+    }
+
+    pq_settle(pq);
+
+    uint32_t index = node->index;
+    PQ_SLOT last = pq->nodes[--pq->size];
+
+    if (PQ_SLOT_NODE(last) != node) {
+        pq_place(pq, index, last);
+        if (pq_sift_up(pq, index) == index) {
+            pq_sift_down(pq, index);
+        }
+    }
+    pq->settled = pq->size;
+
+    node->index = PQ_INDEX_NONE;
+    return 0;
+}
+
+int pq_update_key(struct priority_queue *pq, struct heap_node *node)
+{
+    if (unlikely(!pq || !node)) {
+        return -EINVAL;
+    }
+
+    if (!pq_queued(pq, node)) {
+        return -ENOENT;
+    }
+
+    pq_settle(pq);
+
+    uint32_t index = node->index;
+    pq->nodes[index] = pq_make_slot(node);
+    if (pq_sift_up(pq, index) == index) {
+        pq_sift_down(pq, index);
+    }
+
+    return 0;
+}
+
+#ifdef PQ_STATS
+void pq_get_stats(struct priority_queue *pq, struct pq_stats *stats)
+{
+    if (unlikely(!pq || !stats)) {
+        return;
+    }
+
+    stats->compares = stat_read(&pq->compares);
+    stats->size = pq->size;
+    stats->max_size = (uint32_t)stat_read(&pq->max_size);
+}
+#endif
+
+void pq_reorder(struct priority_queue *pq)
+{
+    if (unlikely(!pq)) {
+        return;
+    }
+
+    pq_settle(pq);
+}
+
+#else
+
+/*
+ * List engine: queued nodes sit on an unordered doubly linked list and @root
+ * caches the highest-priority one. Insertion is O(1); pop, removal of the
+ * root and pq_reorder() rescan the list in O(n), which suits small queues.
+ * A node is queued exactly when it has a predecessor or is the head, as
+ * unlinking always clears both links.
+ */
+
+static inline bool pq_queued(struct priority_queue *pq, struct heap_node *node)
+{
+    return node->prev || node == pq->head;
+}
+
+static void pq_find_root(struct priority_queue *pq)
+{
+    struct heap_node *root = pq->head;
+
+    for (struct heap_node *node = root ? root->next : NULL; node; node = node->next) {
+        if (pq->compare(node, root) > 0) {
+            root = node;
+        }
+    }
+
+    pq->root = root;
+}
+
+static void pq_unlink(struct priority_queue *pq, struct heap_node *node)
+{
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        pq->head = node->next;
+    }
+
+    if (node->next) {
+        node->next->prev = node->prev;
+    } else {
+        pq->tail = node->prev;
+    }
+
+    node->next = node->prev = NULL;
+}
+
+int pq_init(struct priority_queue *pq, int (*compare)(struct heap_node *, struct heap_node *))
+{
+    if (unlikely(!pq || !compare)) {
+        return -EINVAL;
+    }
+
+    pq->head = NULL;
+    pq->tail = NULL;
+    pq->root = NULL;
+    pq->compare = compare;
+
+    return 0;
+}
+
+void pq_deinit(struct priority_queue *pq)
+{
+    if (unlikely(!pq)) {
+        return;
+    }
+
+    while (pq->head) {
+        pq_unlink(pq, pq->head);
+    }
+    pq->root = NULL;
+}
+
+int pq_insert(struct priority_queue *pq, struct heap_node *node)
+{
+    if (unlikely(!pq || !node)) {
+        return -EINVAL;
+    }
+
+    if (unlikely(pq_queued(pq, node))) {
+        return -EEXIST;
+    }
+
+    node->next = NULL;
+    node->prev = pq->tail;
+    if (pq->tail) {
+        pq->tail->next = node;
+    } else {
+        pq->head = node;
+    }
+    pq->tail = node;
+
+    if (!pq->root || pq->compare(node, pq->root) > 0) {
+        pq->root = node;
+    }
+
+    return 0;
+}
+
+struct heap_node *pq_pop(struct priority_queue *pq)
+{
+    if (unlikely(!pq)) {
+        return NULL;
+    }
+
+    struct heap_node *root = pq->root;
 
-    if (pq->tail->prev) {
-        pq->tail->prev->next = NULL;
+    if (!root) {
+        return NULL;
     }
 
-    pq->tail = pq->tail->prev;
-    pq->root->next = pq->root->prev = NULL;
+    pq_unlink(pq, root);
+    pq_find_root(pq);
 
     return root;
 }
@@ -123,29 +678,151 @@ struct heap_node *pq_peek(struct priority_queue *pq)
     return pq->root;
 }
 
-void pq_reorder(struct priority_queue *pq)
+int pq_insert_batch(struct priority_queue *pq, struct heap_node **nodes, uint32_t n)
 {
-    if (unlikely(!pq || !pq->head)) {
-        return;
+    if (unlikely(!pq || (!nodes && n))) {
+        return -EINVAL;
     }
 
-    struct heap_node *current = pq->root;
-    while (1) {
-        struct heap_node *largest = current;
+    for (uint32_t i = 0; i < n; i++) {
+        int ret = pq_insert(pq, nodes[i]);
 
-        if (current->next && pq->compare(current->next, largest) > 0) {
-            largest = current->next;
+        if (unlikely(ret < 0)) {
+            /* Roll back, so that a failed batch leaves the queue untouched */
+            while (i-- > 0) {
+                pq_unlink(pq, nodes[i]);
+            }
+            pq_find_root(pq);
+            return ret;
         }
+    }
+
+    return 0;
+}
+
+/* Markers stored in heap_node::prev while pq_build() validates its nodes */
+static struct heap_node pq_mark_queued;
+static struct heap_node pq_mark_listed;
+
+/* Put back the prev links overwritten by the markers, from the next links */
+static void pq_relink(struct priority_queue *pq)
+{
+    struct heap_node *prev = NULL;
 
-        if (current->prev && pq->compare(current->prev, largest) > 0) {
-            largest = current->prev;
+    for (struct heap_node *node = pq->head; node; node = node->next) {
+        node->prev = prev;
+        prev = node;
+    }
+}
+
+/*
+ * Check the nodes of a pq_build() before the queue is modified. Queued nodes
+ * are marked first, so that a listed node can be told apart as queued here,
+ * fresh, listed twice or queued elsewhere. On failure the queue is intact.
+ */
+static int pq_build_check(struct priority_queue *pq, struct heap_node **nodes, uint32_t n)
+{
+    int ret = 0;
+    uint32_t i;
+
+    for (struct heap_node *node = pq->head; node; node = node->next) {
+        node->prev = &pq_mark_queued;
+    }
+
+    for (i = 0; i < n; i++) {
+        struct heap_node *node = nodes[i];
+
+        if (unlikely(!node)) {
+            ret = -EINVAL;
+            break;
         }
 
-        if (largest == current) {
+        if (unlikely(node->prev && node->prev != &pq_mark_queued)) {
+            ret = -EEXIST;
             break;
         }
 
-        swap_nodes(current, largest);
+        node->prev = &pq_mark_listed;
     }
+
+    if (unlikely(ret < 0)) {
+        while (i-- > 0) {
+            nodes[i]->prev = NULL;
+        }
+    }
+
+    /* Listed nodes that were queued are relinked too, then unlinked below */
+    pq_relink(pq);
+
+    return ret;
+}
+
+int pq_build(struct priority_queue *pq, struct heap_node **nodes, uint32_t n)
+{
+    if (unlikely(!pq || (!nodes && n))) {
+        return -EINVAL;
+    }
+
+    int ret = pq_build_check(pq, nodes, n);
+    if (ret < 0) {
+        return ret;
+    }
+
+    pq_deinit(pq);
+
+    for (uint32_t i = 0; i < n; i++) {
+        nodes[i]->prev = NULL;
+    }
+
+    return pq_insert_batch(pq, nodes, n);
+}
+
+void pq_set_lazy(struct priority_queue *pq, bool lazy)
+{
+    (void)pq;
+    (void)lazy;
+}
+
+int pq_remove(struct priority_queue *pq, struct heap_node *node)
+{
+    if (unlikely(!pq || !node)) {
+        return -EINVAL;
+    }
+
+    if (!pq_queued(pq, node)) {
+        return -ENOENT;
+    }
+
+    pq_unlink(pq, node);
+    if (node == pq->root) {
+        pq_find_root(pq);
+    }
+
+    return 0;
+}
+
+int pq_update_key(struct priority_queue *pq, struct heap_node *node)
+{
+    if (unlikely(!pq || !node)) {
+        return -EINVAL;
+    }
+
+    if (!pq_queued(pq, node)) {
+        return -ENOENT;
+    }
+
+    pq_find_root(pq);
+
+    return 0;
+}
+
+void pq_reorder(struct priority_queue *pq)
+{
+    if (unlikely(!pq)) {
+        return;
+    }
+
+    pq_find_root(pq);
 }
 
+#endif /* PQ_USE_ARRAY_HEAP */
@@ -26,24 +26,170 @@
 #define PRIORITY_QUEUE_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+/*
+ * Engine selection: by default the queue is an implicit d-ary heap stored in
+ * a contiguous array of node pointers (PQ_USE_ARRAY_HEAP), with O(log n)
+ * insert, pop, removal and key updates. Define PQ_USE_LIST_HEAP to keep the
+ * nodes on an intrusive list instead, which needs no allocation but costs
+ * O(n) per pop. PQ_HEAP_ARITY selects d for the array engine and the typed
+ * heaps (default 4).
+ */
+#if defined(PQ_USE_LIST_HEAP) && defined(PQ_USE_ARRAY_HEAP)
+#error "PQ_USE_LIST_HEAP and PQ_USE_ARRAY_HEAP are mutually exclusive"
+#endif
+
+#ifndef PQ_USE_LIST_HEAP
+#define PQ_USE_ARRAY_HEAP
+#endif
+
+#ifndef PQ_HEAP_ARITY
+#define PQ_HEAP_ARITY 4
+#endif
+
+#if PQ_HEAP_ARITY < 2
+#error "PQ_HEAP_ARITY must be at least 2"
+#endif
+
+/*
+ * Define PQ_STATS to count the comparisons made by the array engine and the
+ * largest size each queue reached, read back with pq_get_stats(). Counters
+ * are written only by the thread that owns the queue.
+ */
+#ifdef PQ_STATS
+#ifndef PQ_USE_ARRAY_HEAP
+#error "PQ_STATS is not supported with PQ_USE_LIST_HEAP"
+#endif
+#include "stats.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef PQ_USE_ARRAY_HEAP
+
+/* Initial number of slots allocated by pq_init() on the first insert */
+#ifndef PQ_INITIAL_CAPACITY
+#define PQ_INITIAL_CAPACITY 16
+#endif
+
+/* Value of heap_node::index for a node that is not queued */
+#define PQ_INDEX_NONE UINT32_MAX
+
+/*
+ * Define PQ_INLINE_KEY to order the array engine by a uint64_t key kept in
+ * each node, smallest key first, instead of calling the comparison function.
+ * The key is cached next to the node pointer in the heap array, so sifting
+ * compares integers on contiguous memory without touching the nodes. Set
+ * heap_node::key before pq_insert() and call pq_update_key() after changing
+ * it; the comparison function passed to pq_init() may then be NULL.
+ */
+#ifdef PQ_INLINE_KEY
+
+/**
+ * struct heap_node - Intrusive heap node structure
+ * @index: Slot of the node in the heap array, PQ_INDEX_NONE once dequeued
+ * @key: Priority of the node, smallest first
+ */
+struct heap_node {
+    uint32_t index;
+    uint64_t key;
+};
+
+/**
+ * struct pq_entry - Heap array slot
+ * @key: Copy of the key of @node
+ * @node: Queued node
+ */
+struct pq_entry {
+    uint64_t key;
+    struct heap_node *node;
+};
+
+/* Type of one heap array slot, for use with pq_init_storage() */
+#define PQ_SLOT struct pq_entry
+
+#else
+
+/**
+ * struct heap_node - Intrusive heap node structure
+ * @index: Slot of the node in the heap array, PQ_INDEX_NONE once dequeued
+ */
+struct heap_node {
+    uint32_t index;
+};
+
+/* Type of one heap array slot, for use with pq_init_storage() */
+#define PQ_SLOT struct heap_node *
+
+#endif /* PQ_INLINE_KEY */
+
+/**
+ * struct priority_queue - Priority queue structure
+ * @nodes: Heap array of slots, root at index 0
+ * @size: Number of nodes in the heap
+ * @capacity: Number of slots available in @nodes
+ * @settled: Number of leading slots satisfying the heap property, the rest
+ *           were appended in lazy mode and are fixed up on the next access
+ * @owns_storage: True if @nodes was allocated by the queue itself
+ * @lazy: True if pq_insert() only appends, see pq_set_lazy()
+ * @compare: Function pointer to the comparison function
+ * @compares: Number of node comparisons made (PQ_STATS only)
+ * @max_size: Largest value @size has reached (PQ_STATS only)
+ */
+struct priority_queue {
+    PQ_SLOT *nodes;
+    uint32_t size;
+    uint32_t capacity;
+    uint32_t settled;
+    bool owns_storage;
+    bool lazy;
+    int (*compare)(struct heap_node *, struct heap_node *);
+#ifdef PQ_STATS
+    struct stat_counter compares;
+    struct stat_counter max_size;
+#endif
+};
+
+#ifdef PQ_STATS
+/**
+ * struct pq_stats - Snapshot of the statistics of a priority queue
+ * @compares: Number of node comparisons made
+ * @size: Number of nodes currently queued
+ * @max_size: Largest number of nodes queued at once
+ */
+struct pq_stats {
+    uintptr_t compares;
+    uint32_t size;
+    uint32_t max_size;
+};
+#endif
+
+#else
+
+#ifdef PQ_INLINE_KEY
+#error "PQ_INLINE_KEY is not supported with PQ_USE_LIST_HEAP"
+#endif
 
 /**
  * struct heap_node - Intrusive heap node structure
- * @next: Pointer to the next node
- * @prev: Pointer to the previous node
- * @parent: Pointer to the parent node
+ * @next: Pointer to the next node, NULL once dequeued
+ * @prev: Pointer to the previous node, NULL once dequeued
  */
 struct heap_node {
     struct heap_node *next;
     struct heap_node *prev;
-    struct heap_node *parent;
 };
 
 /**
  * struct priority_queue - Priority queue structure
  * @head: Pointer to the head of the queue
  * @tail: Pointer to the tail of the queue
- * @root: Pointer to the root of the heap
+ * @root: Pointer to the highest-priority node
  * @compare: Function pointer to the comparison function
  */
 struct priority_queue {
@@ -53,6 +199,8 @@ struct priority_queue {
     int (*compare)(struct heap_node *, struct heap_node *);
 };
 
+#endif /* PQ_USE_ARRAY_HEAP */
+
 /**
  * pq_init - Initialize the priority queue
  * @pq: Pointer to the priority queue
@@ -62,15 +210,86 @@ struct priority_queue {
  */
 int pq_init(struct priority_queue *pq, int (*compare)(struct heap_node *, struct heap_node *));
 
+#ifdef PQ_USE_ARRAY_HEAP
+/**
+ * pq_init_storage - Initialize the priority queue over caller-provided storage
+ * @pq: Pointer to the priority queue
+ * @compare: Comparison function for heap nodes
+ * @storage: Array of PQ_SLOT used to hold the heap, never reallocated
+ * @capacity: Number of entries in @storage
+ *
+ * Return: 0 on success, -EINVAL on invalid parameters
+ */
+int pq_init_storage(struct priority_queue *pq, int (*compare)(struct heap_node *, struct heap_node *),
+                    PQ_SLOT *storage, uint32_t capacity);
+#endif
+
+/**
+ * pq_deinit - Release the resources held by the priority queue
+ * @pq: Pointer to the priority queue
+ *
+ * The queue is left empty. Nodes still queued are simply dropped.
+ */
+void pq_deinit(struct priority_queue *pq);
+
 /**
  * pq_insert - Insert a node into the priority queue without reordering
  * @pq: Pointer to the priority queue
  * @node: Pointer to the node to be inserted
  *
- * Return: 0 on success, -EINVAL on invalid parameters
+ * The array engine sifts the node into place on insertion, so no later
+ * pq_reorder() is needed there, unless lazy mode is enabled.
+ *
+ * Return: 0 on success, -EINVAL on invalid parameters, -EEXIST if @node is
+ * already queued, -ENOMEM if the heap array could not grow,
+ * -ENOBUFS if fixed storage is full
  */
 int pq_insert(struct priority_queue *pq, struct heap_node *node);
 
+/**
+ * pq_insert_batch - Insert several nodes into the priority queue at once
+ * @pq: Pointer to the priority queue
+ * @nodes: Array of @n nodes to be inserted
+ * @n: Number of nodes in @nodes
+ *
+ * The array engine grows its storage once and restores the heap property
+ * with a single bottom-up heapify when the batch is large compared to the
+ * queue. Either all nodes are inserted or none is.
+ *
+ * Return: 0 on success, or the same errors as pq_insert()
+ */
+int pq_insert_batch(struct priority_queue *pq, struct heap_node **nodes, uint32_t n);
+
+/**
+ * pq_build - Replace the contents of the priority queue with an array of nodes
+ * @pq: Pointer to the priority queue
+ * @nodes: Array of @n nodes forming the new contents
+ * @n: Number of nodes in @nodes
+ *
+ * Nodes previously queued are dropped, unless listed in @nodes. The heap is
+ * built bottom-up in O(n), rather than in O(n log n) through repeated
+ * insertion. All of @nodes are checked before the queue is modified, so on
+ * failure it keeps its previous contents.
+ *
+ * Return: 0 on success, -EINVAL if an entry of @nodes is NULL, -EEXIST if a
+ * node is listed twice (or queued elsewhere, list engine), or the storage
+ * errors of pq_insert()
+ */
+int pq_build(struct priority_queue *pq, struct heap_node **nodes, uint32_t n);
+
+/**
+ * pq_set_lazy - Select whether insertions defer restoring the heap property
+ * @pq: Pointer to the priority queue
+ * @lazy: True to make pq_insert() only append the node
+ *
+ * In lazy mode the array engine fixes the heap up on the next pq_peek(),
+ * pq_pop(), pq_remove(), pq_update_key() or pq_reorder(), so a burst of
+ * inserts followed by one pop costs a single heapify. Leaving lazy mode
+ * fixes the heap up immediately. The list engine has nothing to defer, so
+ * this is a no-op there.
+ */
+void pq_set_lazy(struct priority_queue *pq, bool lazy);
+
 /**
  * pq_pop - Remove and return the highest-priority node
  * @pq: Pointer to the priority queue
@@ -87,12 +306,158 @@ struct heap_node *pq_pop(struct priority_queue *pq);
  */
 struct heap_node *pq_peek(struct priority_queue *pq);
 
+/**
+ * pq_remove - Remove an arbitrary node from the priority queue
+ * @pq: Pointer to the priority queue
+ * @node: Pointer to the node to be removed
+ *
+ * O(log n) for the array engine, which finds the node through its stored
+ * heap slot.
+ *
+ * Return: 0 on success, -EINVAL on invalid parameters, -ENOENT if @node is
+ * not queued
+ */
+int pq_remove(struct priority_queue *pq, struct heap_node *node);
+
+/**
+ * pq_update_key - Restore the heap property after a node's key changed
+ * @pq: Pointer to the priority queue
+ * @node: Pointer to the queued node whose priority was modified
+ *
+ * Moves @node up or down from its current slot, in O(log n) for the array
+ * engine, instead of a remove followed by a reinsert.
+ *
+ * Return: 0 on success, -EINVAL on invalid parameters, -ENOENT if @node is
+ * not queued
+ */
+int pq_update_key(struct priority_queue *pq, struct heap_node *node);
+
+#ifdef PQ_STATS
+/**
+ * pq_get_stats - Read the statistics counters of the priority queue
+ * @pq: Pointer to the priority queue
+ * @stats: Pointer to store the counters
+ */
+void pq_get_stats(struct priority_queue *pq, struct pq_stats *stats);
+#endif
 
 /**
  * pq_reorder - Reorder the priority queue to maintain the heap property
  * @pq: Pointer to the priority queue
+ *
+ * For the array engine this only fixes up nodes appended in lazy mode, as
+ * the heap property is otherwise kept at all times.
  */
 void pq_reorder(struct priority_queue *pq);
 
+/**
+ * DEFINE_TYPED_PRIORITY_QUEUE - Define a d-ary heap specialized for one element type
+ * @name: Name of the heap structure and prefix of its functions.
+ * @type: Element type, stored by value in caller-provided storage.
+ * @before: Function or macro taking two const @type pointers, true if the
+ *          first element comes out before the second.
+ *
+ * Defines struct @name and the inline functions @name_init(), @name_push(),
+ * @name_peek(), @name_pop() and @name_size(). Unlike the intrusive queue,
+ * @before is known at compile time and inlined into the sift loops, so no
+ * indirect call is made per comparison. Return codes follow the message
+ * queues: -ENOBUFS when full, -EAGAIN when empty.
+ */
+#define DEFINE_TYPED_PRIORITY_QUEUE(name, type, before)                                    \
+    struct name {                                                                       \
+        type *items;                                                                    \
+        uint32_t size;                                                                  \
+        uint32_t capacity;                                                              \
+    };                                                                                  \
+                                                                                        \
+    static inline int name##_init(struct name *pq, type *storage, uint32_t capacity)    \
+    {                                                                                   \
+        if (!pq || !storage || !capacity) {                                             \
+            return -EINVAL;                                                             \
+        }                                                                               \
+                                                                                        \
+        pq->items = storage;                                                            \
+        pq->size = 0;                                                                   \
+        pq->capacity = capacity;                                                        \
+        return 0;                                                                       \
+    }                                                                                   \
+                                                                                        \
+    static inline uint32_t name##_size(const struct name *pq)                           \
+    {                                                                                   \
+        return pq->size;                                                                \
+    }                                                                                   \
+                                                                                        \
+    static inline int name##_push(struct name *pq, const type *item)                    \
+    {                                                                                   \
+        if (pq->size == pq->capacity) {                                                 \
+            return -ENOBUFS;                                                            \
+        }                                                                               \
+                                                                                        \
+        uint32_t index = pq->size++;                                                    \
+        while (index > 0) {                                                             \
+            uint32_t parent = (index - 1) / PQ_HEAP_ARITY;                              \
+            if (!before(item, &pq->items[parent])) {                                    \
+                break;                                                                  \
+            }                                                                           \
+            pq->items[index] = pq->items[parent];                                       \
+            index = parent;                                                             \
+        }                                                                               \
+                                                                                        \
+        pq->items[index] = *item;                                                       \
+        return 0;                                                                       \
+    }                                                                                   \
+                                                                                        \
+    static inline type *name##_peek(struct name *pq)                                    \
+    {                                                                                   \
+        return pq->size ? &pq->items[0] : NULL;                                         \
+    }                                                                                   \
+                                                                                        \
+    static inline int name##_pop(struct name *pq, type *item)                           \
+    {                                                                                   \
+        if (!pq->size) {                                                                \
+            return -EAGAIN;                                                             \
+        }                                                                               \
+                                                                                        \
+        *item = pq->items[0];                                                           \
+        if (!--pq->size) {                                                              \
+            return 0;                                                                   \
+        }                                                                               \
+                                                                                        \
+        type last = pq->items[pq->size];                                                \
+        uint32_t index = 0;                                                             \
+        while (1) {                                                                     \
+            size_t first = (size_t)index * PQ_HEAP_ARITY + 1;                           \
+            if (first >= pq->size) {                                                    \
+                break;                                                                  \
+            }                                                                           \
+                                                                                        \
+            size_t end = first + PQ_HEAP_ARITY;                                         \
+            if (end > pq->size) {                                                       \
+                end = pq->size;                                                         \
+            }                                                                           \
+                                                                                        \
+            size_t best = first;                                                        \
+            for (size_t child = first + 1; child < end; child++) {                      \
+                if (before(&pq->items[child], &pq->items[best])) {                      \
+                    best = child;                                                       \
+                }                                                                       \
+            }                                                                           \
+                                                                                        \
+            if (!before(&pq->items[best], &last)) {                                     \
+                break;                                                                  \
+            }                                                                           \
+                                                                                        \
+            pq->items[index] = pq->items[best];                                         \
+            index = (uint32_t)best;                                                     \
+        }                                                                               \
+                                                                                        \
+        pq->items[index] = last;                                                        \
+        return 0;                                                                       \
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* PRIORITY_QUEUE_H */
 
@@ -0,0 +1,329 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef QUEUE_CORO_HPP
+#define QUEUE_CORO_HPP
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include "timer.h"
+#include "message_queue_core.h"
+#include "ring_buffer.h"
+#include "linked_list.h"
+#include "container_of.h"
+
+/*
+ * C++20 awaitables over the C containers. A coroutine that awaits a timer or
+ * an empty queue is parked on an intrusive list and resumed directly by the
+ * code that makes progress possible: the timer callback run from
+ * timer_increment_tick() or timer_advance(), or the producer call that fills
+ * the queue. Waiting costs one list node in the coroutine frame, no thread
+ * and no polling.
+ *
+ * Like the containers underneath, a channel and its waiters belong to one
+ * thread, typically the event loop that ticks the timer base. With
+ * TIMER_USE_DISPATCH, sleeping coroutines are resumed on a worker thread.
+ */
+
+namespace coro {
+
+/**
+ * struct detached - Return type of a fire-and-forget coroutine
+ *
+ * The coroutine starts running immediately and frees its frame when it
+ * returns. An exception escaping it terminates the program.
+ */
+struct detached {
+    struct promise_type {
+        detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+/**
+ * class sleep_awaiter - Suspend the awaiting coroutine for a number of ticks
+ *
+ * The timer is embedded in the awaiter, so it lives in the coroutine frame
+ * while the coroutine sleeps. Destroying a sleeping coroutine stops it.
+ */
+class sleep_awaiter {
+public:
+    sleep_awaiter(struct timer_base *base, uint64_t ticks) noexcept : base_(base), ticks_(ticks) {}
+    sleep_awaiter(const sleep_awaiter &) = delete;
+    sleep_awaiter &operator=(const sleep_awaiter &) = delete;
+
+    ~sleep_awaiter()
+    {
+        if (armed_) {
+            timer_stop(&timer_);
+        }
+    }
+
+    bool await_ready() const noexcept { return ticks_ == 0; }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept
+    {
+        handle_ = handle;
+        timer_init(&timer_, &sleep_awaiter::expired, this);
+
+        error_ = base_ ? timer_start_on(base_, &timer_, ticks_, false) : timer_start(&timer_, ticks_, false);
+        armed_ = error_ == 0;
+
+        /* Resume at once if the timer could not be queued */
+        return armed_;
+    }
+
+    /* 0 once slept, or the error of timer_start() */
+    int await_resume() const noexcept { return error_; }
+
+private:
+    static void expired(struct timer *timer, void *data)
+    {
+        sleep_awaiter *self = static_cast<sleep_awaiter *>(data);
+
+        (void)timer;
+        self->armed_ = false;
+        self->handle_.resume();
+    }
+
+    struct timer_base *base_;
+    uint64_t ticks_;
+    bool armed_ = false;
+    int error_ = 0;
+    struct timer timer_;
+    std::coroutine_handle<> handle_;
+};
+
+/**
+ * timer_sleep - Sleep on a timer base
+ * @base: Timer base owned by the calling thread
+ * @ticks: Number of ticks to sleep, 0 does not suspend
+ */
+inline sleep_awaiter timer_sleep(struct timer_base *base, uint64_t ticks) noexcept
+{
+    return sleep_awaiter(base, ticks);
+}
+
+/**
+ * timer_sleep - Sleep on the global timer base
+ * @ticks: Number of ticks to sleep, 0 does not suspend
+ */
+inline sleep_awaiter timer_sleep(uint64_t ticks) noexcept
+{
+    return sleep_awaiter(nullptr, ticks);
+}
+
+/**
+ * struct waiter - Consumer parked on a channel
+ * @node: Link in the waiter list of the channel
+ * @handle: Coroutine to resume once the request is served
+ * @data: Destination of the data
+ * @length: Number of bytes requested (ring buffer channels only)
+ */
+struct waiter {
+    struct list_node node;
+    std::coroutine_handle<> handle;
+    void *data;
+    uint32_t length;
+};
+
+/**
+ * class take_awaiter - Take data from a channel, suspending while it is empty
+ *
+ * Waiters are served in arrival order, and a new consumer never overtakes a
+ * parked one. Destroying a parked coroutine unlinks it.
+ */
+template <typename Channel>
+class take_awaiter {
+public:
+    take_awaiter(Channel &channel, void *data, uint32_t length) noexcept : channel_(channel)
+    {
+        waiter_.data = data;
+        waiter_.length = length;
+    }
+    take_awaiter(const take_awaiter &) = delete;
+    take_awaiter &operator=(const take_awaiter &) = delete;
+
+    ~take_awaiter()
+    {
+        if (linked_) {
+            list_remove_from(&channel_.waiters_, &waiter_.node);
+        }
+    }
+
+    bool await_ready() noexcept
+    {
+        return list_is_empty(&channel_.waiters_) && channel_.try_take(waiter_.data, waiter_.length);
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) noexcept
+    {
+        waiter_.handle = handle;
+        list_append(&channel_.waiters_, &waiter_.node);
+        linked_ = true;
+    }
+
+    void await_resume() noexcept { linked_ = false; }
+
+private:
+    Channel &channel_;
+    struct waiter waiter_;
+    bool linked_ = false;
+};
+
+/*
+ * Serve parked waiters in order for as long as the channel can satisfy the
+ * oldest one. Each waiter is unlinked before it is resumed, so a resumed
+ * coroutine may push, pop or park again right away.
+ */
+template <typename Channel>
+inline void wake_waiters(Channel &channel)
+{
+    struct list_node *node;
+
+    while ((node = list_peek_head(&channel.waiters_))) {
+        struct waiter *w = CONTAINER_OF(node, struct waiter, node);
+
+        if (!channel.try_take(w->data, w->length)) {
+            break;
+        }
+
+        list_remove_from(&channel.waiters_, node);
+        w->handle.resume();
+    }
+}
+
+/**
+ * class message_channel - Awaitable view of a message queue
+ *
+ * Producers call push(); consumers co_await pop(), which completes with the
+ * next message copied out of the queue.
+ */
+class message_channel {
+public:
+    explicit message_channel(struct message_queue &mq) noexcept : mq_(mq) { list_init(&waiters_); }
+    message_channel(const message_channel &) = delete;
+    message_channel &operator=(const message_channel &) = delete;
+
+    /**
+     * push - Push a message and resume the consumers it lets run
+     * @data: Pointer to the message to push.
+     *
+     * Return: 0 on success, -ENOBUFS if the queue is full.
+     */
+    int push(const void *data) noexcept
+    {
+        int ret = message_queue_push(&mq_, data);
+
+        if (ret == 0) {
+            wake_waiters(*this);
+        }
+
+        return ret;
+    }
+
+    /**
+     * pop - Wait for a message
+     * @data: Pointer to room for one message, written before resuming.
+     */
+    take_awaiter<message_channel> pop(void *data) noexcept
+    {
+        return take_awaiter<message_channel>(*this, data, mq_.slot_size);
+    }
+
+private:
+    bool try_take(void *data, uint32_t length) noexcept
+    {
+        (void)length;
+        return message_queue_pop(&mq_, data) == 0;
+    }
+
+    friend class take_awaiter<message_channel>;
+    friend void wake_waiters<message_channel>(message_channel &);
+
+    struct message_queue &mq_;
+    struct list_head waiters_;
+};
+
+/**
+ * class ring_channel - Awaitable view of a ring buffer
+ *
+ * Producers call write(); consumers co_await read(), which completes once
+ * the requested number of bytes has been copied out of the buffer. A read
+ * larger than the capacity of the buffer never completes.
+ */
+class ring_channel {
+public:
+    explicit ring_channel(struct ring_buffer &rb) noexcept : rb_(rb) { list_init(&waiters_); }
+    ring_channel(const ring_channel &) = delete;
+    ring_channel &operator=(const ring_channel &) = delete;
+
+    /**
+     * write - Copy bytes into the ring buffer and resume the readers they satisfy
+     * @data: Pointer to the bytes to write.
+     * @length: Number of bytes to write.
+     *
+     * Return: number of bytes written, or -ENOBUFS if they do not fit.
+     */
+    int write(const void *data, uint32_t length) noexcept
+    {
+        int ret = ring_buffer_copy_from_stream(&rb_, static_cast<const uint8_t *>(data), length);
+
+        if (ret > 0) {
+            wake_waiters(*this);
+        }
+
+        return ret;
+    }
+
+    /**
+     * read - Wait for a number of bytes
+     * @data: Pointer to room for @length bytes, written before resuming.
+     * @length: Number of bytes to read.
+     */
+    take_awaiter<ring_channel> read(void *data, uint32_t length) noexcept
+    {
+        return take_awaiter<ring_channel>(*this, data, length);
+    }
+
+private:
+    bool try_take(void *data, uint32_t length) noexcept
+    {
+        return ring_buffer_copy_to_stream(&rb_, static_cast<uint8_t *>(data), length) >= 0;
+    }
+
+    friend class take_awaiter<ring_channel>;
+    friend void wake_waiters<ring_channel>(ring_channel &);
+
+    struct ring_buffer &rb_;
+    struct list_head waiters_;
+};
+
+} // namespace coro
+
+#endif /* QUEUE_CORO_HPP */
@@ -0,0 +1,306 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef QUEUE_WAIT_H
+#define QUEUE_WAIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include "atomic_compat.h"
+#include "message_queue_core.h"
+#include "ring_buffer.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Optional blocking layer for the queues. A consumer that finds its queue
+ * empty spins for a bounded number of attempts, then registers as a waiter
+ * and sleeps on an event counter: a futex on Linux, or the wait/wake hooks
+ * of the waiter elsewhere (for instance an RTOS semaphore). Producers only
+ * bump the counter and issue a wakeup when a waiter is registered, so the
+ * fast path stays free of system calls.
+ *
+ * The queues themselves are not made thread-safe by this layer, so the
+ * message queue helpers are only provided with MESSAGE_QUEUE_SPSC and the
+ * ring buffer helpers only with RING_BUFFER_SPSC.
+ */
+
+/**
+ * struct queue_waiter - Event counter consumers sleep on
+ * @sequence: event counter, bumped by each notification that finds waiters
+ * @waiters: number of consumers registered to sleep
+ * @wait: sleep while @sequence still equals the expected value (NULL: futex)
+ * @wake: wake one consumer sleeping on @sequence (NULL: futex)
+ * @ctx: user context passed to @wait and @wake
+ */
+struct queue_waiter {
+	atomic_uint sequence;
+	atomic_uint waiters;
+	void (*wait)(void *ctx, atomic_uint *sequence, uint32_t expected);
+	void (*wake)(void *ctx, atomic_uint *sequence);
+	void *ctx;
+};
+
+/**
+ * queue_waiter_init - Initialize a waiter
+ * @w: pointer to the waiter structure
+ * @wait: sleep hook, or NULL to use a futex on Linux
+ * @wake: wake hook, or NULL to use a futex on Linux
+ * @ctx: user context passed to the hooks
+ *
+ * The hooks are given together or not at all. Only Linux has the futex
+ * fallback, so elsewhere both hooks are required.
+ *
+ * Return: 0 on success, -EINVAL if only one hook is given or, other than on
+ * Linux, if the hooks are missing
+ */
+static inline int queue_waiter_init(struct queue_waiter *w,
+				    void (*wait)(void *ctx, atomic_uint *sequence, uint32_t expected),
+				    void (*wake)(void *ctx, atomic_uint *sequence), void *ctx)
+{
+	if (!wait != !wake)
+		return -EINVAL;
+
+#ifndef __linux__
+	if (!wait)
+		return -EINVAL;
+#endif
+
+	atomic_init(&w->sequence, 0);
+	atomic_init(&w->waiters, 0);
+	w->wait = wait;
+	w->wake = wake;
+	w->ctx = ctx;
+
+	return 0;
+}
+
+/* Hint to the CPU that the caller is busy waiting */
+static inline void queue_wait_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ volatile("yield");
+#endif
+}
+
+/**
+ * queue_wait_prepare - Register as a waiter before the last emptiness check
+ * @w: pointer to the waiter structure
+ *
+ * Return: event counter value to pass to queue_wait_park()
+ */
+static inline uint32_t queue_wait_prepare(struct queue_waiter *w)
+{
+	/*
+	 * Pairs with the read-modify-write in queue_wait_notify(): both are
+	 * ordered on @waiters, so either the producer sees this waiter or the
+	 * consumer sees the data published before the notification.
+	 */
+	atomic_fetch_add_explicit(&w->waiters, 1, memory_order_seq_cst);
+
+	/*
+	 * Acquire pairs with the release increment in queue_wait_notify(): a
+	 * consumer that reads the new value also sees the data published
+	 * before it, so it never parks on a value whose wakeup already went.
+	 */
+	return atomic_load_explicit(&w->sequence, memory_order_acquire);
+}
+
+/**
+ * queue_wait_park - Sleep until a notification after @sequence
+ * @w: pointer to the waiter structure
+ * @sequence: value returned by queue_wait_prepare()
+ *
+ * Returns immediately if a producer notified in between. Unregisters the
+ * waiter before returning.
+ */
+static inline void queue_wait_park(struct queue_waiter *w, uint32_t sequence)
+{
+	if (w->wait) {
+		w->wait(w->ctx, &w->sequence, sequence);
+	} else {
+#ifdef __linux__
+		syscall(SYS_futex, (uint32_t *)&w->sequence, FUTEX_WAIT_PRIVATE, sequence, NULL, NULL, 0);
+#endif
+	}
+
+	atomic_fetch_sub_explicit(&w->waiters, 1, memory_order_relaxed);
+}
+
+/**
+ * queue_wait_cancel - Unregister a waiter that found data after preparing
+ * @w: pointer to the waiter structure
+ */
+static inline void queue_wait_cancel(struct queue_waiter *w)
+{
+	atomic_fetch_sub_explicit(&w->waiters, 1, memory_order_relaxed);
+}
+
+/**
+ * queue_wait_notify - Wake a waiter, if any, after publishing new data
+ * @w: pointer to the waiter structure
+ */
+static inline void queue_wait_notify(struct queue_waiter *w)
+{
+	/* A read-modify-write rather than a load, see queue_wait_prepare() */
+	if (!atomic_fetch_add_explicit(&w->waiters, 0, memory_order_seq_cst))
+		return;
+
+	atomic_fetch_add_explicit(&w->sequence, 1, memory_order_release);
+
+	if (w->wake) {
+		w->wake(w->ctx, &w->sequence);
+	} else {
+#ifdef __linux__
+		syscall(SYS_futex, (uint32_t *)&w->sequence, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+	}
+}
+
+#ifdef MESSAGE_QUEUE_SPSC
+
+/**
+ * message_queue_push_notify - Push a message and wake a waiting consumer
+ * @mq: pointer to the message queue structure
+ * @data: pointer to the message to push
+ * @w: waiter the consumers of @mq sleep on
+ *
+ * Return: 0 on success, -ENOBUFS if the queue is full
+ */
+static inline int message_queue_push_notify(struct message_queue *mq, const void *data, struct queue_waiter *w)
+{
+	int ret = message_queue_push(mq, data);
+
+	if (ret == 0)
+		queue_wait_notify(w);
+
+	return ret;
+}
+
+/**
+ * message_queue_pop_wait - Pop a message, sleeping while the queue is empty
+ * @mq: pointer to the message queue structure
+ * @data: pointer to store the popped message
+ * @w: waiter the producer of @mq notifies
+ * @spins: number of attempts to busy poll before going to sleep
+ *
+ * Return: 0 once a message was popped
+ */
+static inline int message_queue_pop_wait(struct message_queue *mq, void *data, struct queue_waiter *w,
+					 uint32_t spins)
+{
+	for (uint32_t i = 0; i < spins; i++) {
+		if (message_queue_pop(mq, data) == 0)
+			return 0;
+		queue_wait_cpu_relax();
+	}
+
+	while (1) {
+		uint32_t sequence = queue_wait_prepare(w);
+
+		if (message_queue_pop(mq, data) == 0) {
+			queue_wait_cancel(w);
+			return 0;
+		}
+
+		queue_wait_park(w, sequence);
+
+		if (message_queue_pop(mq, data) == 0)
+			return 0;
+	}
+}
+
+#endif /* MESSAGE_QUEUE_SPSC */
+
+#ifdef RING_BUFFER_SPSC
+
+/**
+ * ring_buffer_write_notify - Copy as many bytes as fit and wake a waiting consumer
+ * @rb: pointer to the ring buffer structure
+ * @stream: pointer to the source stream
+ * @length: maximum number of bytes to copy
+ * @w: waiter the consumer of @rb sleeps on
+ *
+ * Return: number of bytes copied, 0 if the buffer is full
+ */
+static inline int ring_buffer_write_notify(struct ring_buffer *rb, const uint8_t *stream, uint32_t length,
+					   struct queue_waiter *w)
+{
+	int ret = ring_buffer_copy_from_stream_partial(rb, stream, length);
+
+	if (ret > 0)
+		queue_wait_notify(w);
+
+	return ret;
+}
+
+/**
+ * ring_buffer_read_wait - Read up to @length bytes, sleeping while the buffer is empty
+ * @rb: pointer to the ring buffer structure
+ * @stream: pointer to the destination stream
+ * @length: maximum number of bytes to read, at least one
+ * @w: waiter the producer of @rb notifies
+ * @spins: number of attempts to busy poll before going to sleep
+ *
+ * Return: number of bytes read, or -EINVAL if @length is 0
+ */
+static inline int ring_buffer_read_wait(struct ring_buffer *rb, uint8_t *stream, uint32_t length,
+					struct queue_waiter *w, uint32_t spins)
+{
+	int ret;
+
+	if (!length)
+		return -EINVAL;
+
+	for (uint32_t i = 0; i < spins; i++) {
+		if ((ret = ring_buffer_copy_to_stream_partial(rb, stream, length)) > 0)
+			return ret;
+		queue_wait_cpu_relax();
+	}
+
+	while (1) {
+		uint32_t sequence = queue_wait_prepare(w);
+
+		if ((ret = ring_buffer_copy_to_stream_partial(rb, stream, length)) > 0) {
+			queue_wait_cancel(w);
+			return ret;
+		}
+
+		queue_wait_park(w, sequence);
+
+		if ((ret = ring_buffer_copy_to_stream_partial(rb, stream, length)) > 0)
+			return ret;
+	}
+}
+
+#endif /* RING_BUFFER_SPSC */
+
+#endif /* QUEUE_WAIT_H */
@@ -28,21 +28,277 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <string.h>
+
+/*
+ * Define RING_BUFFER_SPSC to make the ring buffer safe for one producer and
+ * one consumer running concurrently without locks. The indices then become
+ * C11 atomics with acquire/release ordering, each on its own cache line, and
+ * each side caches the index of the other side to avoid cross-core traffic.
+ */
+#ifdef RING_BUFFER_SPSC
+#include "atomic_compat.h"
+#endif
+#include "cache_line.h"
+
+/*
+ * Define RING_BUFFER_STATS to count, per buffer, the highest fill level seen
+ * by the producer and the calls that found the buffer full or empty. Each
+ * counter is written only by the side that owns it; read them from any
+ * thread with ring_buffer_get_stats().
+ */
+#ifdef RING_BUFFER_STATS
+#include "stats.h"
+#endif
+
+/*
+ * Define RING_BUFFER_FREE_RUNNING to let head and tail count bytes freely
+ * and wrap them only when addressing the buffer. Full and empty are then
+ * told apart by the distance between the counters, so all size bytes of the
+ * buffer are usable instead of size - 1.
+ */
+
+/*
+ * Define RING_BUFFER_MIRRORED on Linux to enable ring_buffer_init_mirrored(),
+ * which maps the same pages twice back to back. Any access of up to size
+ * bytes starting inside the buffer is then contiguous and never has to be
+ * split at the wrap point. Needs memfd_create(2), so define _GNU_SOURCE
+ * before including this header.
+ */
+#ifdef RING_BUFFER_MIRRORED
+#ifndef __linux__
+#error "RING_BUFFER_MIRRORED is only supported on Linux"
+#endif
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 /**
  * struct ring_buffer - Fast ring buffer structure
  * @buffer: pointer to the data buffer
  * @size: size of the buffer (must be a power of two)
  * @head: head index (producer)
+ * @tail_cache: producer copy of @tail (RING_BUFFER_SPSC only)
  * @tail: tail index (consumer)
+ * @head_cache: consumer copy of @head (RING_BUFFER_SPSC only)
+ * @mirrored: true if @buffer is mapped twice back to back (RING_BUFFER_MIRRORED only)
+ * @high_water: highest fill level seen by the producer (RING_BUFFER_STATS only)
+ * @full_count: producer calls that found too little space (RING_BUFFER_STATS only)
+ * @empty_count: consumer calls that found too little data (RING_BUFFER_STATS only)
+ *
+ * With RING_BUFFER_SPSC or QUEUE_CACHE_LINE_LAYOUT, the producer and the
+ * consumer fields each start on their own cache line.
  */
 struct ring_buffer {
 	uint8_t *buffer;
 	uint32_t size;
-	uint32_t head;
-	uint32_t tail;
+#ifdef RING_BUFFER_MIRRORED
+	bool mirrored;
+#endif
+#ifdef RING_BUFFER_SPSC
+	CACHE_LINE_ALIGNED atomic_uint head;
+	uint32_t tail_cache;
+#ifdef RING_BUFFER_STATS
+	struct stat_counter high_water;
+	struct stat_counter full_count;
+#endif
+	CACHE_LINE_ALIGNED atomic_uint tail;
+	uint32_t head_cache;
+#ifdef RING_BUFFER_STATS
+	struct stat_counter empty_count;
+#endif
+#else
+	CACHE_LINE_SEPARATE uint32_t head;
+#ifdef RING_BUFFER_STATS
+	struct stat_counter high_water;
+	struct stat_counter full_count;
+#endif
+	CACHE_LINE_SEPARATE uint32_t tail;
+#ifdef RING_BUFFER_STATS
+	struct stat_counter empty_count;
+#endif
+#endif
 };
 
+/*
+ * Index accessors. With RING_BUFFER_SPSC, an index is published with release
+ * ordering by its owner and read with acquire ordering by the other side;
+ * owners read their own index relaxed. Without it they are plain accesses.
+ */
+#ifdef RING_BUFFER_SPSC
+
+static inline uint32_t ring_buffer_head_acquire(struct ring_buffer *rb)
+{
+	return atomic_load_explicit(&rb->head, memory_order_acquire);
+}
+
+static inline uint32_t ring_buffer_head_relaxed(struct ring_buffer *rb)
+{
+	return atomic_load_explicit(&rb->head, memory_order_relaxed);
+}
+
+static inline void ring_buffer_head_release(struct ring_buffer *rb, uint32_t head)
+{
+	atomic_store_explicit(&rb->head, head, memory_order_release);
+}
+
+static inline uint32_t ring_buffer_tail_acquire(struct ring_buffer *rb)
+{
+	return atomic_load_explicit(&rb->tail, memory_order_acquire);
+}
+
+static inline uint32_t ring_buffer_tail_relaxed(struct ring_buffer *rb)
+{
+	return atomic_load_explicit(&rb->tail, memory_order_relaxed);
+}
+
+static inline void ring_buffer_tail_release(struct ring_buffer *rb, uint32_t tail)
+{
+	atomic_store_explicit(&rb->tail, tail, memory_order_release);
+}
+
+/* Producer view of the tail index, reloaded from the consumer on @refresh */
+static inline uint32_t ring_buffer_cached_tail(struct ring_buffer *rb, bool refresh)
+{
+	if (refresh)
+		rb->tail_cache = ring_buffer_tail_acquire(rb);
+
+	return rb->tail_cache;
+}
+
+/* Consumer view of the head index, reloaded from the producer on @refresh */
+static inline uint32_t ring_buffer_cached_head(struct ring_buffer *rb, bool refresh)
+{
+	if (refresh)
+		rb->head_cache = ring_buffer_head_acquire(rb);
+
+	return rb->head_cache;
+}
+
+#else
+
+static inline uint32_t ring_buffer_head_acquire(struct ring_buffer *rb)
+{
+	return rb->head;
+}
+
+static inline uint32_t ring_buffer_head_relaxed(struct ring_buffer *rb)
+{
+	return rb->head;
+}
+
+static inline void ring_buffer_head_release(struct ring_buffer *rb, uint32_t head)
+{
+	rb->head = head;
+}
+
+static inline uint32_t ring_buffer_tail_acquire(struct ring_buffer *rb)
+{
+	return rb->tail;
+}
+
+static inline uint32_t ring_buffer_tail_relaxed(struct ring_buffer *rb)
+{
+	return rb->tail;
+}
+
+static inline void ring_buffer_tail_release(struct ring_buffer *rb, uint32_t tail)
+{
+	rb->tail = tail;
+}
+
+static inline uint32_t ring_buffer_cached_tail(struct ring_buffer *rb, bool refresh)
+{
+	(void)refresh;
+	return rb->tail;
+}
+
+static inline uint32_t ring_buffer_cached_head(struct ring_buffer *rb, bool refresh)
+{
+	(void)refresh;
+	return rb->head;
+}
+
+#endif /* RING_BUFFER_SPSC */
+
+/* Index arithmetic shared by both index schemes */
+static inline uint32_t ring_buffer_offset(struct ring_buffer *rb, uint32_t index)
+{
+#ifdef RING_BUFFER_FREE_RUNNING
+	return index & (rb->size - 1);
+#else
+	(void)rb;
+	return index;
+#endif
+}
+
+static inline uint32_t ring_buffer_advance(struct ring_buffer *rb, uint32_t index, uint32_t count)
+{
+#ifdef RING_BUFFER_FREE_RUNNING
+	(void)rb;
+	return index + count;
+#else
+	return (index + count) & (rb->size - 1);
+#endif
+}
+
+static inline uint32_t ring_buffer_distance(struct ring_buffer *rb, uint32_t head, uint32_t tail)
+{
+#ifdef RING_BUFFER_FREE_RUNNING
+	(void)rb;
+	return head - tail;
+#else
+	return (head - tail) & (rb->size - 1);
+#endif
+}
+
+static inline bool ring_buffer_is_mirrored(struct ring_buffer *rb)
+{
+#ifdef RING_BUFFER_MIRRORED
+	return rb->mirrored;
+#else
+	(void)rb;
+	return false;
+#endif
+}
+
+/*
+ * Statistics hooks, called by the producer after publishing @head or on a
+ * full buffer and by the consumer on an empty one. They compile to nothing
+ * without RING_BUFFER_STATS. The fill level reloads the tail, since the
+ * cached copy may trail the consumer and overstate the high-water mark.
+ */
+static inline void ring_buffer_stat_fill(struct ring_buffer *rb, uint32_t head)
+{
+#ifdef RING_BUFFER_STATS
+	stat_max(&rb->high_water, ring_buffer_distance(rb, head, ring_buffer_cached_tail(rb, true)));
+#else
+	(void)rb;
+	(void)head;
+#endif
+}
+
+static inline void ring_buffer_stat_full(struct ring_buffer *rb)
+{
+#ifdef RING_BUFFER_STATS
+	stat_inc(&rb->full_count);
+#else
+	(void)rb;
+#endif
+}
+
+static inline void ring_buffer_stat_empty(struct ring_buffer *rb)
+{
+#ifdef RING_BUFFER_STATS
+	stat_inc(&rb->empty_count);
+#else
+	(void)rb;
+#endif
+}
+
+/* Shared with the other queue headers, define it only once */
+#ifndef ROUND_DOWN_TO_POWER_OF_TWO_DEFINED
+#define ROUND_DOWN_TO_POWER_OF_TWO_DEFINED
 /**
  * round_down_to_power_of_two - Round down a number to the nearest power of two
  * @value: the number to round down
@@ -59,6 +315,7 @@ static inline uint32_t round_down_to_power_of_two(uint32_t value)
 
 	return value;
 }
+#endif
 
 /**
  * ring_buffer_init - Initialize the ring buffer
@@ -70,10 +327,148 @@ static inline void ring_buffer_init(struct ring_buffer *rb, uint8_t *buffer, uin
 {
 	rb->size = round_down_to_power_of_two(size);
 	rb->buffer = buffer;
+#ifdef RING_BUFFER_MIRRORED
+	rb->mirrored = false;
+#endif
+#ifdef RING_BUFFER_SPSC
+	atomic_init(&rb->head, 0);
+	atomic_init(&rb->tail, 0);
+	rb->tail_cache = 0;
+	rb->head_cache = 0;
+#else
 	rb->head = 0;
 	rb->tail = 0;
+#endif
+#ifdef RING_BUFFER_STATS
+	stat_init(&rb->high_water);
+	stat_init(&rb->full_count);
+	stat_init(&rb->empty_count);
+#endif
+}
+
+/**
+ * ring_buffer_capacity - Get the number of bytes the ring buffer can hold
+ * @rb: pointer to the ring buffer structure
+ *
+ * Return: size of the buffer, minus the slot kept free to tell a full buffer
+ * from an empty one unless RING_BUFFER_FREE_RUNNING is defined
+ */
+static inline uint32_t ring_buffer_capacity(struct ring_buffer *rb)
+{
+#ifdef RING_BUFFER_FREE_RUNNING
+	return rb->size;
+#else
+	return rb->size ? rb->size - 1 : 0;
+#endif
+}
+
+/**
+ * ring_buffer_init_checked - Initialize the ring buffer and report its capacity
+ * @rb: pointer to the ring buffer structure
+ * @buffer: pointer to the data buffer
+ * @size: size of the data buffer
+ *
+ * Like ring_buffer_init(), but lets the caller see how much of @buffer is
+ * actually used once @size is rounded down to a power of two.
+ *
+ * Return: usable capacity in bytes, or -EINVAL if @size leaves no usable
+ * byte or exceeds INT32_MAX
+ */
+static inline int ring_buffer_init_checked(struct ring_buffer *rb, uint8_t *buffer, uint32_t size)
+{
+	if (size > INT32_MAX) {
+		return -EINVAL;
+	}
+
+	ring_buffer_init(rb, buffer, size);
+
+	if (!ring_buffer_capacity(rb)) {
+		return -EINVAL;
+	}
+
+	return ring_buffer_capacity(rb);
+}
+
+#ifdef RING_BUFFER_MIRRORED
+/**
+ * ring_buffer_init_mirrored - Initialize a ring buffer over a mirrored mapping
+ * @rb: pointer to the ring buffer structure
+ * @size: minimum size of the buffer
+ *
+ * @size is rounded up to a power of two of at least one page. The buffer is
+ * allocated by the call and released with ring_buffer_deinit_mirrored().
+ *
+ * Return: usable capacity in bytes, capped at INT32_MAX, or a negative error
+ * code. With RING_BUFFER_FREE_RUNNING a @size above 2^30 gives a 2^31 byte
+ * buffer, whose capacity ring_buffer_capacity() reports in full.
+ */
+static inline int ring_buffer_init_mirrored(struct ring_buffer *rb, uint32_t size)
+{
+	long page = sysconf(_SC_PAGESIZE);
+	uint32_t length = page > 0 ? (uint32_t)page : 4096;
+
+	if (size > INT32_MAX) {
+		return -EINVAL;
+	}
+
+	while (length < size)
+		length <<= 1;
+
+	int fd = memfd_create("ring_buffer", MFD_CLOEXEC);
+	if (fd < 0) {
+		return -errno;
+	}
+
+	if (ftruncate(fd, length) < 0) {
+		int ret = -errno;
+		close(fd);
+		return ret;
+	}
+
+	/* Reserve twice the size, then map the file over both halves */
+	uint8_t *area = (uint8_t *)mmap(NULL, 2 * (size_t)length, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (area == MAP_FAILED) {
+		int ret = -errno;
+		close(fd);
+		return ret;
+	}
+
+	if (mmap(area, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+	    mmap(area + length, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		int ret = -errno;
+		munmap(area, 2 * (size_t)length);
+		close(fd);
+		return ret;
+	}
+
+	close(fd);
+
+	ring_buffer_init(rb, area, length);
+	rb->mirrored = true;
+
+	if (ring_buffer_capacity(rb) > INT32_MAX)
+		return INT32_MAX;
+
+	return ring_buffer_capacity(rb);
 }
 
+/**
+ * ring_buffer_deinit_mirrored - Release the mapping of a mirrored ring buffer
+ * @rb: pointer to the ring buffer structure
+ */
+static inline void ring_buffer_deinit_mirrored(struct ring_buffer *rb)
+{
+	if (!rb->mirrored) {
+		return;
+	}
+
+	munmap(rb->buffer, 2 * (size_t)rb->size);
+	rb->buffer = NULL;
+	rb->size = 0;
+	rb->mirrored = false;
+}
+#endif /* RING_BUFFER_MIRRORED */
+
 /**
  * ring_buffer_is_full - Check if the ring buffer is full
  * @rb: pointer to the ring buffer structure
@@ -82,7 +477,8 @@ static inline void ring_buffer_init(struct ring_buffer *rb, uint8_t *buffer, uin
  */
 static inline bool ring_buffer_is_full(struct ring_buffer *rb)
 {
-	return ((rb->head + 1) & (rb->size - 1)) == rb->tail;
+	return ring_buffer_distance(rb, ring_buffer_head_acquire(rb), ring_buffer_tail_acquire(rb)) ==
+	       ring_buffer_capacity(rb);
 }
 
 /**
@@ -93,7 +489,32 @@ static inline bool ring_buffer_is_full(struct ring_buffer *rb)
  */
 static inline bool ring_buffer_is_empty(struct ring_buffer *rb)
 {
-	return rb->head == rb->tail;
+	return ring_buffer_head_acquire(rb) == ring_buffer_tail_acquire(rb);
+}
+
+/*
+ * Free space seen by the producer at @head and data available to the consumer
+ * at @tail. The other side's index is only reloaded if the cached copy does
+ * not leave room for @want bytes.
+ */
+static inline uint32_t ring_buffer_free_space(struct ring_buffer *rb, uint32_t head, uint32_t want)
+{
+	uint32_t free_space = ring_buffer_capacity(rb) - ring_buffer_distance(rb, head, ring_buffer_cached_tail(rb, false));
+
+	if (free_space < want)
+		free_space = ring_buffer_capacity(rb) - ring_buffer_distance(rb, head, ring_buffer_cached_tail(rb, true));
+
+	return free_space;
+}
+
+static inline uint32_t ring_buffer_used_space(struct ring_buffer *rb, uint32_t tail, uint32_t want)
+{
+	uint32_t used = ring_buffer_distance(rb, ring_buffer_cached_head(rb, false), tail);
+
+	if (used < want)
+		used = ring_buffer_distance(rb, ring_buffer_cached_head(rb, true), tail);
+
+	return used;
 }
 
 /**
@@ -105,12 +526,17 @@ static inline bool ring_buffer_is_empty(struct ring_buffer *rb)
  */
 static inline int ring_buffer_push(struct ring_buffer *rb, uint8_t byte)
 {
-	if (ring_buffer_is_full(rb)) {
+	uint32_t head = ring_buffer_head_relaxed(rb);
+
+	if (!ring_buffer_free_space(rb, head, 1)) {
+		ring_buffer_stat_full(rb);
 		return -ENOBUFS;
 	}
 
-	rb->buffer[rb->head] = byte;
-	rb->head = (rb->head + 1) & (rb->size - 1);
+	rb->buffer[ring_buffer_offset(rb, head)] = byte;
+	head = ring_buffer_advance(rb, head, 1);
+	ring_buffer_head_release(rb, head);
+	ring_buffer_stat_fill(rb, head);
 
 	return 0;
 }
@@ -124,16 +550,44 @@ static inline int ring_buffer_push(struct ring_buffer *rb, uint8_t byte)
  */
 static inline int ring_buffer_pop(struct ring_buffer *rb, uint8_t *byte)
 {
-	if (ring_buffer_is_empty(rb)) {
+	uint32_t tail = ring_buffer_tail_relaxed(rb);
+
+	if (!ring_buffer_used_space(rb, tail, 1)) {
+		ring_buffer_stat_empty(rb);
 		return -EAGAIN;
 	}
 
-	*byte = rb->buffer[rb->tail];
-	rb->tail = (rb->tail + 1) & (rb->size - 1);
+	*byte = rb->buffer[ring_buffer_offset(rb, tail)];
+	ring_buffer_tail_release(rb, ring_buffer_advance(rb, tail, 1));
 
 	return 0;
 }
 
+/* Copy @length bytes in or out of the ring at @index, in at most two memcpy calls */
+static inline void ring_buffer_write_at(struct ring_buffer *rb, uint32_t index, const uint8_t *src, uint32_t length)
+{
+	uint32_t offset = ring_buffer_offset(rb, index);
+	uint32_t first = rb->size - offset;
+
+	if (first > length || ring_buffer_is_mirrored(rb))
+		first = length;
+
+	memcpy(&rb->buffer[offset], src, first);
+	memcpy(rb->buffer, src + first, length - first);
+}
+
+static inline void ring_buffer_read_at(struct ring_buffer *rb, uint32_t index, uint8_t *dst, uint32_t length)
+{
+	uint32_t offset = ring_buffer_offset(rb, index);
+	uint32_t first = rb->size - offset;
+
+	if (first > length || ring_buffer_is_mirrored(rb))
+		first = length;
+
+	memcpy(dst, &rb->buffer[offset], first);
+	memcpy(dst + first, rb->buffer, length - first);
+}
+
 /**
  * ring_buffer_copy_from_stream - Copy bytes from a stream into the ring buffer
  * @rb: pointer to the ring buffer structure
@@ -144,18 +598,212 @@ static inline int ring_buffer_pop(struct ring_buffer *rb, uint8_t *byte)
  */
 static inline int ring_buffer_copy_from_stream(struct ring_buffer *rb, const uint8_t *stream, uint32_t length)
 {
-	uint32_t free_space = (rb->size - ((rb->head - rb->tail) & (rb->size - 1))) - 1;
+	uint32_t head = ring_buffer_head_relaxed(rb);
 
-	if (length > free_space) {
+	if (length > ring_buffer_free_space(rb, head, length)) {
+		ring_buffer_stat_full(rb);
 		return -ENOBUFS;
 	}
 
-	for (uint32_t i = 0; i < length; i++) {
-		rb->buffer[rb->head] = stream[i];
-		rb->head = (rb->head + 1) & (rb->size - 1);
+	ring_buffer_write_at(rb, head, stream, length);
+	head = ring_buffer_advance(rb, head, length);
+	ring_buffer_head_release(rb, head);
+	ring_buffer_stat_fill(rb, head);
+
+	return length;
+}
+
+/**
+ * ring_buffer_copy_from_stream_partial - Copy as many bytes as fit into the ring buffer
+ * @rb: pointer to the ring buffer structure
+ * @stream: pointer to the source stream
+ * @length: maximum number of bytes to copy
+ *
+ * Return: number of bytes copied, 0 if the buffer is full
+ */
+static inline int ring_buffer_copy_from_stream_partial(struct ring_buffer *rb, const uint8_t *stream, uint32_t length)
+{
+	uint32_t head = ring_buffer_head_relaxed(rb);
+	uint32_t free_space = ring_buffer_free_space(rb, head, length);
+
+	if (length > free_space) {
+		length = free_space;
+		ring_buffer_stat_full(rb);
 	}
 
+	ring_buffer_write_at(rb, head, stream, length);
+	head = ring_buffer_advance(rb, head, length);
+	ring_buffer_head_release(rb, head);
+	ring_buffer_stat_fill(rb, head);
+
 	return length;
 }
 
+/**
+ * ring_buffer_copy_to_stream - Copy bytes out of the ring buffer into a stream
+ * @rb: pointer to the ring buffer structure
+ * @stream: pointer to the destination stream
+ * @length: number of bytes to copy
+ *
+ * Return: number of bytes copied on success, or -EAGAIN if fewer than @length
+ * bytes are buffered
+ */
+static inline int ring_buffer_copy_to_stream(struct ring_buffer *rb, uint8_t *stream, uint32_t length)
+{
+	uint32_t tail = ring_buffer_tail_relaxed(rb);
+
+	if (length > ring_buffer_used_space(rb, tail, length)) {
+		ring_buffer_stat_empty(rb);
+		return -EAGAIN;
+	}
+
+	ring_buffer_read_at(rb, tail, stream, length);
+	ring_buffer_tail_release(rb, ring_buffer_advance(rb, tail, length));
+
+	return length;
+}
+
+/**
+ * ring_buffer_copy_to_stream_partial - Copy up to @length buffered bytes into a stream
+ * @rb: pointer to the ring buffer structure
+ * @stream: pointer to the destination stream
+ * @length: maximum number of bytes to copy
+ *
+ * Return: number of bytes copied, 0 if the buffer is empty
+ */
+static inline int ring_buffer_copy_to_stream_partial(struct ring_buffer *rb, uint8_t *stream, uint32_t length)
+{
+	uint32_t tail = ring_buffer_tail_relaxed(rb);
+	uint32_t used = ring_buffer_used_space(rb, tail, length);
+
+	if (length > used) {
+		length = used;
+		ring_buffer_stat_empty(rb);
+	}
+
+	ring_buffer_read_at(rb, tail, stream, length);
+	ring_buffer_tail_release(rb, ring_buffer_advance(rb, tail, length));
+
+	return length;
+}
+
+/**
+ * ring_buffer_write_reserve - Get the largest contiguous free region of the ring buffer
+ * @rb: pointer to the ring buffer structure
+ * @ptr: pointer to store the start of the region
+ * @want: maximum number of bytes the caller intends to write
+ *
+ * The producer fills the region in place, for instance from DMA or read(2),
+ * and then publishes what it wrote with ring_buffer_write_commit(). On a
+ * mirrored buffer the region covers all free space.
+ *
+ * Return: size of the region in bytes, at most @want, 0 if the buffer is full
+ */
+static inline uint32_t ring_buffer_write_reserve(struct ring_buffer *rb, uint8_t **ptr, uint32_t want)
+{
+	uint32_t head = ring_buffer_head_relaxed(rb);
+	uint32_t offset = ring_buffer_offset(rb, head);
+	uint32_t length = ring_buffer_free_space(rb, head, want);
+
+	if (!length && want)
+		ring_buffer_stat_full(rb);
+
+	if (length > rb->size - offset && !ring_buffer_is_mirrored(rb))
+		length = rb->size - offset;
+
+	if (length > want)
+		length = want;
+
+	*ptr = &rb->buffer[offset];
+
+	return length;
+}
+
+/**
+ * ring_buffer_write_commit - Publish bytes written into a reserved region
+ * @rb: pointer to the ring buffer structure
+ * @length: number of bytes written at the pointer returned by the reserve
+ *
+ * Return: 0 on success, or -EINVAL if @length exceeds the free space
+ */
+static inline int ring_buffer_write_commit(struct ring_buffer *rb, uint32_t length)
+{
+	uint32_t head = ring_buffer_head_relaxed(rb);
+
+	if (length > ring_buffer_free_space(rb, head, length)) {
+		return -EINVAL;
+	}
+
+	head = ring_buffer_advance(rb, head, length);
+	ring_buffer_head_release(rb, head);
+	ring_buffer_stat_fill(rb, head);
+
+	return 0;
+}
+
+/**
+ * ring_buffer_read_peek - Get the largest contiguous region of buffered data
+ * @rb: pointer to the ring buffer structure
+ * @ptr: pointer to store the start of the region
+ *
+ * The consumer parses the region in place and then frees what it consumed
+ * with ring_buffer_read_release(). On a mirrored buffer the region covers all
+ * buffered data.
+ *
+ * Return: size of the region in bytes, 0 if the buffer is empty
+ */
+static inline uint32_t ring_buffer_read_peek(struct ring_buffer *rb, uint8_t **ptr)
+{
+	uint32_t tail = ring_buffer_tail_relaxed(rb);
+	uint32_t offset = ring_buffer_offset(rb, tail);
+	uint32_t length = ring_buffer_used_space(rb, tail, rb->size);
+
+	if (!length)
+		ring_buffer_stat_empty(rb);
+
+	if (length > rb->size - offset && !ring_buffer_is_mirrored(rb))
+		length = rb->size - offset;
+
+	*ptr = &rb->buffer[offset];
+
+	return length;
+}
+
+/**
+ * ring_buffer_read_release - Free bytes consumed from a peeked region
+ * @rb: pointer to the ring buffer structure
+ * @length: number of bytes consumed
+ *
+ * Return: 0 on success, or -EINVAL if @length exceeds the buffered data
+ */
+static inline int ring_buffer_read_release(struct ring_buffer *rb, uint32_t length)
+{
+	uint32_t tail = ring_buffer_tail_relaxed(rb);
+
+	if (length > ring_buffer_used_space(rb, tail, length)) {
+		return -EINVAL;
+	}
+
+	ring_buffer_tail_release(rb, ring_buffer_advance(rb, tail, length));
+
+	return 0;
+}
+
+#ifdef RING_BUFFER_STATS
+/**
+ * ring_buffer_get_stats - Read the statistics counters of the ring buffer
+ * @rb: pointer to the ring buffer structure
+ * @stats: pointer to store the counters
+ *
+ * The counters are read one by one, so a snapshot taken while the buffer is
+ * in use may mix values from slightly different moments.
+ */
+static inline void ring_buffer_get_stats(struct ring_buffer *rb, struct queue_stats *stats)
+{
+	stats->high_water = stat_read(&rb->high_water);
+	stats->full = stat_read(&rb->full_count);
+	stats->empty = stat_read(&rb->empty_count);
+}
+#endif
+
 #endif /* RING_BUFFER_H */
@@ -0,0 +1,598 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SHM_MESSAGE_QUEUE_H
+#define SHM_MESSAGE_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <errno.h>
+#include "cache_line.h"
+#include "message_queue_core.h"
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "shm_message_queue.h needs POSIX mmap(2)"
+#endif
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Single-producer, single-consumer message queue stored entirely in a shared
+ * file mapping, so that two processes attached to the same file exchange
+ * messages through their page cache with no system call on the fast path.
+ * The file starts with a header holding the geometry and the indices; the
+ * slots follow at an offset recorded in the header, so no pointer is ever
+ * stored in the file and each process maps it at any address.
+ *
+ * Use a file on tmpfs (/dev/shm) for pure IPC, or on a regular file system
+ * to keep the queue across restarts: published messages survive a crash of
+ * either side and are found again by shm_message_queue_attach(). A message
+ * obtained with shm_message_queue_front() but not yet released is delivered
+ * again after a consumer crash. Call shm_message_queue_sync() to push the
+ * state to disk when durability against a system crash is needed.
+ *
+ * A byte stream ring buffer is the same queue with 1-byte slots, moved in
+ * bulk with shm_message_queue_push_n() and shm_message_queue_pop_n().
+ */
+
+#if ATOMIC_INT_LOCK_FREE != 2
+#error "shm_message_queue.h needs lock-free atomic_uint to share indices between processes"
+#endif
+
+/* "SHMQ" in little-endian byte order */
+#define SHM_MESSAGE_QUEUE_MAGIC 0x514d4853U
+#define SHM_MESSAGE_QUEUE_VERSION 1
+
+/**
+ * struct shm_message_queue_header - Layout of the start of the queue file
+ * @magic: SHM_MESSAGE_QUEUE_MAGIC, stored last when the file is created
+ * @version: SHM_MESSAGE_QUEUE_VERSION
+ * @header_size: sizeof() this structure, to catch mismatched builds
+ * @slot_size: Size of each message in bytes
+ * @slot_count: Number of slots (power of two)
+ * @stride: Distance in bytes between two slots
+ * @data_offset: Offset of the first slot from the start of the file
+ * @file_size: Total size of the file in bytes
+ * @head: Free-running count of messages published (producer)
+ * @tail: Free-running count of messages released (consumer)
+ *
+ * The indices are masked with @slot_count - 1 only to address a slot, so
+ * every slot is usable and the queue is full when they are @slot_count apart.
+ */
+struct shm_message_queue_header {
+    atomic_uint magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t slot_size;
+    uint32_t slot_count;
+    uint32_t stride;
+    uint64_t data_offset;
+    uint64_t file_size;
+    CACHE_LINE_ALIGNED atomic_uint head;
+    CACHE_LINE_ALIGNED atomic_uint tail;
+};
+
+/**
+ * struct shm_message_queue - Process-local handle on a shared queue
+ * @header: Start of the mapping
+ * @slots: First slot in the mapping
+ * @length: Size of the mapping
+ * @slot_size: Copy of the header slot size
+ * @slot_count: Copy of the header slot count
+ * @stride: Copy of the header stride
+ * @head_cache: Consumer copy of the head index
+ * @tail_cache: Producer copy of the tail index
+ *
+ * Each side keeps its own handle; only the file contents are shared. The
+ * geometry is copied out of the header once it has been checked, and only
+ * these copies are used afterwards: the peer can write to the header at any
+ * time, so a value read from it later could send a copy out of the mapping.
+ */
+struct shm_message_queue {
+    struct shm_message_queue_header *header;
+    uint8_t *slots;
+    size_t length;
+    uint32_t slot_size;
+    uint32_t slot_count;
+    uint32_t stride;
+    uint32_t head_cache;
+    uint32_t tail_cache;
+};
+
+static inline int shm_message_queue_map(struct shm_message_queue *q, int fd, size_t length)
+{
+    void *area = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (area == MAP_FAILED) {
+        return -errno;
+    }
+
+    q->header = (struct shm_message_queue_header *)area;
+    q->length = length;
+    q->slots = NULL;
+    q->slot_size = 0;
+    q->slot_count = 0;
+    q->stride = 0;
+    q->head_cache = 0;
+    q->tail_cache = 0;
+
+    return 0;
+}
+
+static inline void shm_message_queue_bind(struct shm_message_queue *q, uint32_t slot_size, uint32_t slot_count,
+                                          uint32_t stride, uint64_t data_offset)
+{
+    q->slots = (uint8_t *)q->header + data_offset;
+    q->slot_size = slot_size;
+    q->slot_count = slot_count;
+    q->stride = stride;
+    q->head_cache = atomic_load_explicit(&q->header->head, memory_order_acquire);
+    q->tail_cache = atomic_load_explicit(&q->header->tail, memory_order_acquire);
+}
+
+/**
+ * shm_message_queue_create - Create a queue file and map it.
+ * @q: Pointer to the handle to set up.
+ * @path: Path of the file to create, which must not exist yet.
+ * @slot_size: Size of each message.
+ * @slot_count: Number of slots, rounded down to the nearest power of two.
+ *
+ * Slots are spaced by MESSAGE_QUEUE_ALIGNED_STRIDE(@slot_size) and start on
+ * a page boundary, so no message straddles two cache lines.
+ *
+ * Return: 0 on success, -EINVAL on invalid parameters, -EEXIST if @path
+ * already exists (attach to it instead), or another negative errno value.
+ */
+static inline int shm_message_queue_create(struct shm_message_queue *q, const char *path,
+                                           uint32_t slot_size, uint32_t slot_count)
+{
+    slot_count = round_down_to_power_of_two(slot_count);
+
+    if (!q || !path || !slot_size || slot_size > UINT32_MAX / 2 || slot_count < 2) {
+        return -EINVAL;
+    }
+
+    long page = sysconf(_SC_PAGESIZE);
+    uint64_t data_offset = (sizeof(struct shm_message_queue_header) + page - 1) & ~(uint64_t)(page - 1);
+    uint32_t stride = MESSAGE_QUEUE_ALIGNED_STRIDE(slot_size);
+    uint64_t file_size = data_offset + (uint64_t)stride * slot_count;
+
+    if (file_size > (uint64_t)SIZE_MAX || file_size > (uint64_t)INT64_MAX) {
+        return -EFBIG;
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    int ret = ftruncate(fd, (off_t)file_size) ? -errno : shm_message_queue_map(q, fd, (size_t)file_size);
+    close(fd);
+
+    if (ret < 0) {
+        unlink(path);
+        return ret;
+    }
+
+    struct shm_message_queue_header *header = q->header;
+
+    header->version = SHM_MESSAGE_QUEUE_VERSION;
+    header->header_size = sizeof(*header);
+    header->slot_size = slot_size;
+    header->slot_count = slot_count;
+    header->stride = stride;
+    header->data_offset = data_offset;
+    header->file_size = file_size;
+    atomic_init(&header->head, 0);
+    atomic_init(&header->tail, 0);
+
+    /* Publish the header: attachers that see the magic see the rest */
+    atomic_store_explicit(&header->magic, SHM_MESSAGE_QUEUE_MAGIC, memory_order_release);
+
+    shm_message_queue_bind(q, slot_size, slot_count, stride, data_offset);
+    return 0;
+}
+
+/**
+ * shm_message_queue_attach - Map an existing queue file.
+ * @q: Pointer to the handle to set up.
+ * @path: Path of a file made by shm_message_queue_create().
+ *
+ * The header is read once and checked before use, so a file truncated or
+ * corrupted by a crash is rejected rather than trusted. Messages still queued
+ * in the file are kept.
+ *
+ * Return: 0 on success, -EBADMSG if the file is not a valid queue of this
+ * build (or is still being created), or another negative errno value.
+ */
+static inline int shm_message_queue_attach(struct shm_message_queue *q, const char *path)
+{
+    if (!q || !path) {
+        return -EINVAL;
+    }
+
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    struct stat st;
+    int ret = fstat(fd, &st) ? -errno : 0;
+
+    if (!ret && (uint64_t)st.st_size < sizeof(struct shm_message_queue_header)) {
+        ret = -EBADMSG;
+    }
+    if (!ret) {
+        ret = shm_message_queue_map(q, fd, (size_t)st.st_size);
+    }
+    close(fd);
+
+    if (ret < 0) {
+        return ret;
+    }
+
+    struct shm_message_queue_header *header = q->header;
+    bool valid = atomic_load_explicit(&header->magic, memory_order_acquire) == SHM_MESSAGE_QUEUE_MAGIC;
+
+    /* Check local copies, so the values used are the values checked */
+    volatile struct shm_message_queue_header *shared = header;
+    uint32_t slot_size = shared->slot_size;
+    uint32_t slot_count = shared->slot_count;
+    uint32_t stride = shared->stride;
+    uint64_t data_offset = shared->data_offset;
+
+    valid = valid && shared->version == SHM_MESSAGE_QUEUE_VERSION && shared->header_size == sizeof(*header) &&
+            shared->file_size == (uint64_t)st.st_size && slot_count >= 2 && !(slot_count & (slot_count - 1)) &&
+            slot_size && stride >= slot_size && data_offset >= sizeof(*header) && data_offset <= q->length &&
+            (uint64_t)stride * slot_count <= q->length - data_offset;
+
+    if (valid) {
+        uint32_t used = atomic_load_explicit(&header->head, memory_order_acquire) -
+                        atomic_load_explicit(&header->tail, memory_order_acquire);
+        valid = used <= slot_count;
+    }
+
+    if (!valid) {
+        munmap(q->header, q->length);
+        q->header = NULL;
+        return -EBADMSG;
+    }
+
+    shm_message_queue_bind(q, slot_size, slot_count, stride, data_offset);
+    return 0;
+}
+
+/**
+ * shm_message_queue_detach - Unmap the queue.
+ * @q: Pointer to the handle.
+ *
+ * The file and the messages it holds are left in place; unlink it once
+ * neither side needs the queue any more.
+ */
+static inline void shm_message_queue_detach(struct shm_message_queue *q)
+{
+    if (q->header) {
+        munmap(q->header, q->length);
+        q->header = NULL;
+        q->slots = NULL;
+    }
+}
+
+/**
+ * shm_message_queue_sync - Write the queue state back to its file.
+ * @q: Pointer to the handle.
+ *
+ * Return: 0 on success, or a negative errno value.
+ */
+static inline int shm_message_queue_sync(struct shm_message_queue *q)
+{
+    return msync(q->header, q->length, MS_SYNC) ? -errno : 0;
+}
+
+static inline uint8_t *shm_message_queue_slot(struct shm_message_queue *q, uint32_t index)
+{
+    return &q->slots[(size_t)(index & (q->slot_count - 1)) * q->stride];
+}
+
+/*
+ * Free slots seen by the producer, reloading the tail only when needed. The
+ * result never exceeds slot_count: a tail further away than that was not
+ * written by a well-behaved consumer and is refused with -EBADMSG.
+ */
+static inline int shm_message_queue_free_slots(struct shm_message_queue *q, uint32_t head, uint32_t want,
+                                               uint32_t *free_slots)
+{
+    uint32_t used = head - q->tail_cache;
+
+    if (used > q->slot_count || q->slot_count - used < want) {
+        q->tail_cache = atomic_load_explicit(&q->header->tail, memory_order_acquire);
+        used = head - q->tail_cache;
+        if (used > q->slot_count) {
+            return -EBADMSG;
+        }
+    }
+
+    *free_slots = q->slot_count - used;
+    return 0;
+}
+
+/* Queued messages seen by the consumer, with the same checks as above */
+static inline int shm_message_queue_used_slots(struct shm_message_queue *q, uint32_t tail, uint32_t want,
+                                               uint32_t *used_slots)
+{
+    uint32_t used = q->head_cache - tail;
+
+    if (used > q->slot_count || used < want) {
+        q->head_cache = atomic_load_explicit(&q->header->head, memory_order_acquire);
+        used = q->head_cache - tail;
+        if (used > q->slot_count) {
+            return -EBADMSG;
+        }
+    }
+
+    *used_slots = used;
+    return 0;
+}
+
+/**
+ * shm_message_queue_claim - Get the next free slot to build a message in place.
+ * @q: Pointer to the handle.
+ *
+ * Return: Pointer to a slot of slot_size bytes, or NULL if the queue is full
+ * or its indices are corrupt.
+ */
+static inline void *shm_message_queue_claim(struct shm_message_queue *q)
+{
+    uint32_t head = atomic_load_explicit(&q->header->head, memory_order_relaxed);
+    uint32_t free_slots;
+
+    if (shm_message_queue_free_slots(q, head, 1, &free_slots) || !free_slots) {
+        return NULL; // Queue is full
+    }
+
+    return shm_message_queue_slot(q, head);
+}
+
+/**
+ * shm_message_queue_publish - Publish the message built in the claimed slot.
+ * @q: Pointer to the handle.
+ *
+ * Return: 0 on success, -ENOBUFS if the queue is full, or -EBADMSG if its
+ * indices are corrupt.
+ */
+static inline int shm_message_queue_publish(struct shm_message_queue *q)
+{
+    uint32_t head = atomic_load_explicit(&q->header->head, memory_order_relaxed);
+    uint32_t free_slots;
+    int ret = shm_message_queue_free_slots(q, head, 1, &free_slots);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (!free_slots) {
+        return -ENOBUFS; // Queue is full
+    }
+
+    atomic_store_explicit(&q->header->head, head + 1, memory_order_release);
+    return 0;
+}
+
+/**
+ * shm_message_queue_push - Copy a message into the queue.
+ * @q: Pointer to the handle.
+ * @data: Pointer to the message to push.
+ *
+ * Return: 0 on success, -ENOBUFS if the queue is full, or -EBADMSG if its
+ * indices are corrupt.
+ */
+static inline int shm_message_queue_push(struct shm_message_queue *q, const void *data)
+{
+    uint32_t head = atomic_load_explicit(&q->header->head, memory_order_relaxed);
+    uint32_t free_slots;
+    int ret = shm_message_queue_free_slots(q, head, 1, &free_slots);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (!free_slots) {
+        return -ENOBUFS; // Queue is full
+    }
+
+    memcpy(shm_message_queue_slot(q, head), data, q->slot_size);
+    atomic_store_explicit(&q->header->head, head + 1, memory_order_release);
+    return 0;
+}
+
+/**
+ * shm_message_queue_front - Get the message at the front of the queue in place.
+ * @q: Pointer to the handle.
+ *
+ * Return: Pointer to the message, or NULL if the queue is empty or its
+ * indices are corrupt.
+ */
+static inline void *shm_message_queue_front(struct shm_message_queue *q)
+{
+    uint32_t tail = atomic_load_explicit(&q->header->tail, memory_order_relaxed);
+    uint32_t used;
+
+    if (shm_message_queue_used_slots(q, tail, 1, &used) || !used) {
+        return NULL; // Queue is empty
+    }
+
+    return shm_message_queue_slot(q, tail);
+}
+
+/**
+ * shm_message_queue_release - Release the message returned by shm_message_queue_front().
+ * @q: Pointer to the handle.
+ *
+ * Return: 0 on success, -EAGAIN if the queue is empty, or -EBADMSG if its
+ * indices are corrupt.
+ */
+static inline int shm_message_queue_release(struct shm_message_queue *q)
+{
+    uint32_t tail = atomic_load_explicit(&q->header->tail, memory_order_relaxed);
+    uint32_t used;
+    int ret = shm_message_queue_used_slots(q, tail, 1, &used);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (!used) {
+        return -EAGAIN; // Queue is empty
+    }
+
+    atomic_store_explicit(&q->header->tail, tail + 1, memory_order_release);
+    return 0;
+}
+
+/**
+ * shm_message_queue_pop - Copy out and remove the message at the front of the queue.
+ * @q: Pointer to the handle.
+ * @data: Pointer to store the popped message.
+ *
+ * Return: 0 on success, -EAGAIN if the queue is empty, or -EBADMSG if its
+ * indices are corrupt.
+ */
+static inline int shm_message_queue_pop(struct shm_message_queue *q, void *data)
+{
+    uint32_t tail = atomic_load_explicit(&q->header->tail, memory_order_relaxed);
+    uint32_t used;
+    int ret = shm_message_queue_used_slots(q, tail, 1, &used);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (!used) {
+        return -EAGAIN; // Queue is empty
+    }
+
+    memcpy(data, shm_message_queue_slot(q, tail), q->slot_size);
+    atomic_store_explicit(&q->header->tail, tail + 1, memory_order_release);
+    return 0;
+}
+
+/**
+ * shm_message_queue_push_n - Push several messages into the queue at once.
+ * @q: Pointer to the handle.
+ * @data: Pointer to @count messages stored back to back.
+ * @count: Number of messages to push.
+ *
+ * Pushes as many messages as fit and publishes them with a single head
+ * update. Unpadded slots are copied with at most two memcpy calls.
+ *
+ * Return: number of messages pushed, -ENOBUFS if the queue is full, or
+ * -EBADMSG if its indices are corrupt.
+ */
+static inline int shm_message_queue_push_n(struct shm_message_queue *q, const void *data, uint32_t count)
+{
+    uint32_t head = atomic_load_explicit(&q->header->head, memory_order_relaxed);
+    uint32_t free_slots;
+    int ret = shm_message_queue_free_slots(q, head, count, &free_slots);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (!free_slots && count) {
+        return -ENOBUFS; // Queue is full
+    }
+
+    if (count > free_slots) {
+        count = free_slots;
+    }
+
+    if (q->stride == q->slot_size) {
+        uint32_t first = q->slot_count - (head & (q->slot_count - 1));
+        if (first > count) {
+            first = count;
+        }
+
+        memcpy(shm_message_queue_slot(q, head), data, (size_t)first * q->slot_size);
+        memcpy(q->slots, (const uint8_t *)data + (size_t)first * q->slot_size,
+               (size_t)(count - first) * q->slot_size);
+    } else {
+        for (uint32_t i = 0; i < count; i++) {
+            memcpy(shm_message_queue_slot(q, head + i), (const uint8_t *)data + (size_t)i * q->slot_size,
+                   q->slot_size);
+        }
+    }
+
+    atomic_store_explicit(&q->header->head, head + count, memory_order_release);
+    return count;
+}
+
+/**
+ * shm_message_queue_pop_n - Remove and retrieve several messages at once.
+ * @q: Pointer to the handle.
+ * @data: Pointer to room for @count messages stored back to back.
+ * @count: Maximum number of messages to pop.
+ *
+ * Pops as many messages as are queued, up to @count, and releases them with
+ * a single tail update. Unpadded slots are copied with at most two memcpy
+ * calls.
+ *
+ * Return: number of messages popped, -EAGAIN if the queue is empty, or
+ * -EBADMSG if its indices are corrupt.
+ */
+static inline int shm_message_queue_pop_n(struct shm_message_queue *q, void *data, uint32_t count)
+{
+    uint32_t tail = atomic_load_explicit(&q->header->tail, memory_order_relaxed);
+    uint32_t used;
+    int ret = shm_message_queue_used_slots(q, tail, count, &used);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (!used && count) {
+        return -EAGAIN; // Queue is empty
+    }
+
+    if (count > used) {
+        count = used;
+    }
+
+    if (q->stride == q->slot_size) {
+        uint32_t first = q->slot_count - (tail & (q->slot_count - 1));
+        if (first > count) {
+            first = count;
+        }
+
+        memcpy(data, shm_message_queue_slot(q, tail), (size_t)first * q->slot_size);
+        memcpy((uint8_t *)data + (size_t)first * q->slot_size, q->slots, (size_t)(count - first) * q->slot_size);
+    } else {
+        for (uint32_t i = 0; i < count; i++) {
+            memcpy((uint8_t *)data + (size_t)i * q->slot_size, shm_message_queue_slot(q, tail + i), q->slot_size);
+        }
+    }
+
+    atomic_store_explicit(&q->header->tail, tail + count, memory_order_release);
+    return count;
+}
+
+#endif /* SHM_MESSAGE_QUEUE_H */
@@ -0,0 +1,90 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include "atomic_compat.h"
+
+/*
+ * Hot-path statistics counters, compiled in per module with RING_BUFFER_STATS,
+ * MESSAGE_QUEUE_STATS, PQ_STATS and TIMER_STATS; without them the counters
+ * and every update vanish. Each counter has a single writer, the core that
+ * owns that side of the container, so updates are a relaxed load and store
+ * with no read-modify-write and no fence, while any other thread may still
+ * read a consistent value. Counters are native words and wrap around on
+ * overflow.
+ */
+
+/**
+ * struct stat_counter - Single-writer statistics counter
+ * @value: current value
+ */
+struct stat_counter {
+	_Atomic(uintptr_t) value;
+};
+
+/**
+ * struct queue_stats - Snapshot of the statistics of a bounded queue
+ * @high_water: largest fill level observed by the producer
+ * @full: number of producer calls that failed or stalled on a full queue
+ * @empty: number of consumer calls that failed on an empty queue
+ */
+struct queue_stats {
+	uintptr_t high_water;
+	uintptr_t full;
+	uintptr_t empty;
+};
+
+static inline void stat_init(struct stat_counter *counter)
+{
+	atomic_init(&counter->value, 0);
+}
+
+/* Must only be called by the writer of the counter */
+static inline void stat_add(struct stat_counter *counter, uintptr_t n)
+{
+	atomic_store_explicit(&counter->value, atomic_load_explicit(&counter->value, memory_order_relaxed) + n,
+			      memory_order_relaxed);
+}
+
+static inline void stat_inc(struct stat_counter *counter)
+{
+	stat_add(counter, 1);
+}
+
+/* Must only be called by the writer of the counter */
+static inline void stat_max(struct stat_counter *counter, uintptr_t value)
+{
+	if (value > atomic_load_explicit(&counter->value, memory_order_relaxed))
+		atomic_store_explicit(&counter->value, value, memory_order_relaxed);
+}
+
+static inline uintptr_t stat_read(struct stat_counter *counter)
+{
+	return atomic_load_explicit(&counter->value, memory_order_relaxed);
+}
+
+#endif /* STATS_H */
@@ -0,0 +1,227 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Byte search and checksum kernels of byte_scan.h against plain reference
+ * code and published check values, at every alignment, with short tails,
+ * and over ring buffer contents that wrap. The Makefile also builds this
+ * test without vector extensions and, where the host has them, with AVX2
+ * and SSE4.2, so each compiled path is covered.
+ */
+
+#include <stdlib.h>
+
+#include "byte_scan.h"
+#include "test.h"
+
+#define SPAN 20000
+
+static uint8_t data[SPAN + 64];
+
+/* Bitwise CRC-32C, reflected polynomial 0x82f63b78 */
+static uint32_t ref_crc32c(uint32_t crc, const uint8_t *p, uint32_t length)
+{
+    crc = ~crc;
+    while (length--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0x82f63b78U & (0U - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t ref_adler32(uint32_t adler, const uint8_t *p, uint32_t length)
+{
+    uint32_t s1 = adler & 0xffff;
+    uint32_t s2 = adler >> 16;
+
+    while (length--) {
+        s1 = (s1 + *p++) % 65521U;
+        s2 = (s2 + s1) % 65521U;
+    }
+    return (s2 << 16) | s1;
+}
+
+static uint32_t ref_find(const uint8_t *p, uint32_t length, uint8_t byte)
+{
+    uint32_t i = 0;
+
+    while (i < length && p[i] != byte) {
+        i++;
+    }
+    return i;
+}
+
+static void fill(uint32_t seed)
+{
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+        seed = seed * 1103515245U + 12345U;
+        data[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+static void test_check_values(void)
+{
+    const uint8_t *digits = (const uint8_t *)"123456789";
+    const uint8_t *wiki = (const uint8_t *)"Wikipedia";
+
+    CHECK_EQ(byte_scan_crc32c(0, digits, 9), 0xe3069283U);
+    CHECK_EQ(byte_scan_crc32c(0, NULL, 0), 0);
+    CHECK_EQ(byte_scan_adler32(1, digits, 9), 0x091e01deU);
+    CHECK_EQ(byte_scan_adler32(1, wiki, 9), 0x11e60398U);
+    CHECK_EQ(byte_scan_adler32(1, NULL, 0), 1);
+
+    /* 32 bytes of 0xff, a vector of the CRC-32C test set (RFC 3720) */
+    uint8_t ones[32];
+    memset(ones, 0xff, sizeof(ones));
+    CHECK_EQ(byte_scan_crc32c(0, ones, sizeof(ones)), 0x62a8ab43U);
+
+    /* Every byte 0xff, long enough for the Adler-32 sums to need reducing */
+    memset(data, 0xff, SPAN);
+    CHECK_EQ(byte_scan_adler32(1, data, SPAN), ref_adler32(1, data, SPAN));
+}
+
+/* Every alignment and every length up to a few vectors */
+static void test_alignment_and_tails(void)
+{
+    uint32_t bad = 0;
+
+    fill(1);
+    for (uint32_t offset = 0; offset < 64; offset++) {
+        for (uint32_t length = 0; length <= 200; length++) {
+            const uint8_t *p = data + offset;
+
+            bad += byte_scan_crc32c(0, p, length) != ref_crc32c(0, p, length);
+            bad += byte_scan_adler32(1, p, length) != ref_adler32(1, p, length);
+        }
+    }
+    CHECK_EQ(bad, 0);
+
+    /* Long runs cross the Adler-32 reduction interval */
+    for (uint32_t length = SPAN - 40; length <= SPAN; length++) {
+        bad += byte_scan_crc32c(0, data + 3, length) != ref_crc32c(0, data + 3, length);
+        bad += byte_scan_adler32(1, data + 3, length) != ref_adler32(1, data + 3, length);
+    }
+    CHECK_EQ(bad, 0);
+
+    /* Checksums computed piece by piece match the one-shot value */
+    uint32_t crc = 0;
+    uint32_t adler = 1;
+    for (uint32_t done = 0, piece = 1; done < SPAN; done += piece, piece = piece * 3 % 97 + 1) {
+        uint32_t length = piece < SPAN - done ? piece : SPAN - done;
+
+        crc = byte_scan_crc32c(crc, data + done, length);
+        adler = byte_scan_adler32(adler, data + done, length);
+    }
+    CHECK_EQ(crc, ref_crc32c(0, data, SPAN));
+    CHECK_EQ(adler, ref_adler32(1, data, SPAN));
+}
+
+static void test_find(void)
+{
+    uint32_t bad = 0;
+
+    memset(data, 'a', sizeof(data));
+    for (uint32_t offset = 0; offset < 64; offset++) {
+        for (uint32_t length = 0; length <= 130; length++) {
+            const uint8_t *p = data + offset;
+
+            /* No match, then a match at each position, then two matches */
+            bad += byte_scan_find(p, length, 'x') != length;
+            for (uint32_t at = 0; at < length; at++) {
+                data[offset + at] = 'x';
+                bad += byte_scan_find(p, length, 'x') != at;
+                if (at + 1 < length) {
+                    data[offset + length - 1] = 'x';
+                    bad += byte_scan_find(p, length, 'x') != at;
+                    data[offset + length - 1] = 'a';
+                }
+                data[offset + at] = 'a';
+            }
+        }
+    }
+    CHECK_EQ(bad, 0);
+
+    fill(2);
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        bad += byte_scan_find(data + 5, 1000, (uint8_t)byte) != ref_find(data + 5, 1000, (uint8_t)byte);
+    }
+    CHECK_EQ(bad, 0);
+}
+
+/* Ranges of ring buffer data that wrap are scanned in two pieces */
+static void test_ring_wrap(void)
+{
+    static uint8_t storage[256];
+    uint8_t linear[256];
+    uint8_t scratch[256];
+    struct ring_buffer rb;
+    uint32_t crc = 0;
+    uint32_t adler = 1;
+
+    fill(3);
+    ring_buffer_init(&rb, storage, sizeof(storage));
+
+    /* Move the tail near the end so the next data wraps */
+    CHECK_EQ(ring_buffer_copy_from_stream(&rb, data, 200), 200);
+    CHECK_EQ(ring_buffer_copy_to_stream(&rb, scratch, 200), 200);
+
+    /* The first 56 bytes fill the end of the storage, the rest wraps */
+    memcpy(linear, data + 200, 150);
+    for (uint32_t i = 0; i < 150; i++) {
+        if (linear[i] == '\n') {
+            linear[i] = ' ';
+        }
+    }
+    linear[30] = '\n';
+    linear[120] = '\n';
+    CHECK_EQ(ring_buffer_copy_from_stream(&rb, linear, 150), 150);
+
+    CHECK_EQ(ring_buffer_crc32c(&rb, 0, 150, &crc), 0);
+    CHECK_EQ(crc, ref_crc32c(0, linear, 150));
+    CHECK_EQ(ring_buffer_adler32(&rb, 0, 150, &adler), 0);
+    CHECK_EQ(adler, ref_adler32(1, linear, 150));
+
+    crc = 0;
+    CHECK_EQ(ring_buffer_crc32c(&rb, 40, 100, &crc), 0);
+    CHECK_EQ(crc, ref_crc32c(0, linear + 40, 100));
+    CHECK_EQ(ring_buffer_crc32c(&rb, 100, 51, &crc), -EAGAIN);
+    CHECK_EQ(ring_buffer_adler32(&rb, 150, 1, &adler), -EAGAIN);
+
+    CHECK_EQ(ring_buffer_find_byte(&rb, 0, '\n'), 30);
+    CHECK_EQ(ring_buffer_find_byte(&rb, 31, '\n'), 120);
+    CHECK_EQ(ring_buffer_find_byte(&rb, 121, '\n'), -ENOENT);
+    CHECK_EQ(ring_buffer_find_byte(&rb, 150, '\n'), -ENOENT);
+}
+
+int main(void)
+{
+    RUN_TEST(test_check_values);
+    RUN_TEST(test_alignment_and_tails);
+    RUN_TEST(test_find);
+    RUN_TEST(test_ring_wrap);
+
+    return TEST_EXIT_STATUS();
+}
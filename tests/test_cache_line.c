@@ -0,0 +1,100 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Cache line layout of the queue structures. Built with
+ * QUEUE_CACHE_LINE_LAYOUT, see the Makefile: the producer-owned and
+ * consumer-owned fields must start on separate cache lines, and aligned
+ * message queue slots must not straddle a line.
+ */
+
+#include <stddef.h>
+
+#include "message_queue_core.h"
+#include "ping_pong_buffer.h"
+#include "ring_buffer.h"
+#include "test.h"
+
+#ifndef QUEUE_CACHE_LINE_LAYOUT
+#error "build with -DQUEUE_CACHE_LINE_LAYOUT"
+#endif
+
+#define SAME_LINE(a, b) ((a) / CACHE_LINE_SIZE == (b) / CACHE_LINE_SIZE)
+
+DEFINE_TYPED_MESSAGE_QUEUE(sample_queue, uint32_t, 16)
+
+static void test_struct_layout(void)
+{
+    CHECK_EQ(offsetof(struct ring_buffer, head) % CACHE_LINE_SIZE, 0);
+    CHECK_EQ(offsetof(struct ring_buffer, tail) % CACHE_LINE_SIZE, 0);
+    CHECK(!SAME_LINE(offsetof(struct ring_buffer, head), offsetof(struct ring_buffer, tail)));
+
+    CHECK_EQ(offsetof(struct message_queue, head) % CACHE_LINE_SIZE, 0);
+    CHECK_EQ(offsetof(struct message_queue, tail) % CACHE_LINE_SIZE, 0);
+    CHECK(!SAME_LINE(offsetof(struct message_queue, head), offsetof(struct message_queue, tail)));
+
+    CHECK(!SAME_LINE(offsetof(struct sample_queue, buffer), offsetof(struct sample_queue, head)));
+    CHECK(!SAME_LINE(offsetof(struct sample_queue, head), offsetof(struct sample_queue, tail)));
+
+    CHECK(!SAME_LINE(offsetof(struct ping_pong_buffer, mode),
+                     offsetof(struct ping_pong_buffer, write_index)));
+    CHECK(SAME_LINE(offsetof(struct ping_pong_buffer, write_index),
+                    offsetof(struct ping_pong_buffer, lengths)));
+    CHECK(!SAME_LINE(offsetof(struct ping_pong_buffer, lengths[PING_PONG_BUFFER_MAX - 1]),
+                     offsetof(struct ping_pong_buffer, read_index)));
+    CHECK(!SAME_LINE(offsetof(struct ping_pong_buffer, read_index),
+                     offsetof(struct ping_pong_buffer, latest)));
+}
+
+static void test_aligned_slots(void)
+{
+    static DECLARE_ALIGNED_MESSAGE_QUEUE_BUFFER(8, 24);
+    static DECLARE_PING_PONG_BUFFER(frame, 100);
+    struct message_queue mq;
+
+    CHECK_EQ((uintptr_t)buffer % CACHE_LINE_SIZE, 0);
+    CHECK_EQ((uintptr_t)frame % CACHE_LINE_SIZE, 0);
+    CHECK_EQ(sizeof(frame), CACHE_LINE_ROUND_UP(100));
+    CHECK_EQ(MESSAGE_QUEUE_ALIGNED_STRIDE(24), 32);
+    CHECK_EQ(MESSAGE_QUEUE_ALIGNED_STRIDE(100), CACHE_LINE_ROUND_UP(100));
+
+    /* One slot stays free to tell a full queue from an empty one */
+    message_queue_init_aligned(&mq, buffer, 24, 8);
+    for (uint32_t i = 0; i < 7; i++) {
+        uintptr_t slot = (uintptr_t)message_queue_claim(&mq);
+
+        CHECK(slot != 0);
+        CHECK(SAME_LINE(slot, slot + 24 - 1));
+        message_queue_publish(&mq);
+    }
+    CHECK(message_queue_claim(&mq) == NULL);
+}
+
+int main(void)
+{
+    RUN_TEST(test_struct_layout);
+    RUN_TEST(test_aligned_slots);
+
+    return TEST_EXIT_STATUS();
+}
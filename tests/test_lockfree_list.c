@@ -0,0 +1,190 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Stress tests of the lock-free lists: several producers feed one consumer
+ * through an MPSC queue and through a take-all stack. Every node must come
+ * out exactly once, and each producer's nodes in the order it pushed them.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+
+#include "container_of.h"
+#include "lockfree_list.h"
+#include "test.h"
+
+#define PRODUCERS 4
+#define ITEMS 20000
+
+struct item {
+    struct list_node node;
+    uint32_t producer;
+    uint32_t sequence;
+};
+
+static struct item items[PRODUCERS][ITEMS];
+static struct mpsc_list queue;
+static struct lockfree_stack stack;
+
+/* Checks one received item against the last one seen from its producer */
+static bool receive(struct list_node *node, uint32_t next[PRODUCERS])
+{
+    struct item *item = CONTAINER_OF(node, struct item, node);
+
+    if (item->producer >= PRODUCERS || item->sequence >= ITEMS ||
+        item != &items[item->producer][item->sequence] || item->sequence != next[item->producer]) {
+        return false;
+    }
+
+    next[item->producer]++;
+    return true;
+}
+
+static void *queue_producer(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+
+    for (uint32_t i = 0; i < ITEMS; i++) {
+        items[id][i].producer = id;
+        items[id][i].sequence = i;
+        mpsc_list_push(&queue, &items[id][i].node);
+
+        if (!(i % 64)) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void *stack_producer(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+
+    for (uint32_t i = 0; i < ITEMS; i++) {
+        items[id][i].producer = id;
+        items[id][i].sequence = i;
+        lockfree_stack_push(&stack, &items[id][i].node);
+
+        if (!(i % 64)) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void start(pthread_t threads[PRODUCERS], void *(*fn)(void *))
+{
+    for (uint32_t i = 0; i < PRODUCERS; i++) {
+        CHECK_EQ(pthread_create(&threads[i], NULL, fn, (void *)(uintptr_t)i), 0);
+    }
+}
+
+static void join(pthread_t threads[PRODUCERS])
+{
+    for (uint32_t i = 0; i < PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+static void test_mpsc_list_stress(void)
+{
+    pthread_t threads[PRODUCERS];
+    uint32_t next[PRODUCERS] = { 0 };
+    uint32_t received = 0;
+    uint32_t bad = 0;
+
+    mpsc_list_init(&queue);
+    start(threads, queue_producer);
+
+    while (received < PRODUCERS * ITEMS) {
+        struct list_node *node = mpsc_list_pop(&queue);
+
+        if (!node) {
+            sched_yield();
+            continue;
+        }
+
+        if (!receive(node, next)) {
+            bad++;
+        }
+        received++;
+    }
+
+    join(threads);
+    CHECK_EQ(bad, 0);
+    CHECK(mpsc_list_pop(&queue) == NULL);
+    CHECK(mpsc_list_is_empty(&queue));
+}
+
+static void test_lockfree_stack_stress(void)
+{
+    pthread_t threads[PRODUCERS];
+    uint32_t next[PRODUCERS] = { 0 };
+    uint32_t received = 0;
+    uint32_t bad = 0;
+
+    lockfree_stack_init(&stack);
+    start(threads, stack_producer);
+
+    while (received < PRODUCERS * ITEMS) {
+        struct list_head list;
+        struct list_node *node;
+        struct list_node *tmp;
+        size_t count;
+
+        list_init(&list);
+        count = lockfree_stack_take_all_fifo(&stack, &list);
+        if (!count) {
+            sched_yield();
+            continue;
+        }
+
+        list_for_each_safe(&list, node, tmp) {
+            if (!receive(node, next)) {
+                bad++;
+            }
+            received++;
+            count--;
+        }
+
+        CHECK_EQ(count, 0);
+    }
+
+    join(threads);
+    CHECK_EQ(received, PRODUCERS * ITEMS);
+    CHECK_EQ(bad, 0);
+    CHECK(lockfree_stack_take_all(&stack) == NULL);
+}
+
+int main(void)
+{
+    RUN_TEST(test_mpsc_list_stress);
+    RUN_TEST(test_lockfree_stack_stress);
+
+    return TEST_EXIT_STATUS();
+}
@@ -0,0 +1,268 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Fixed-size message queue: single and batched copies and in-place slot
+ * access, with packed and cache line padded slots, including batches that
+ * wrap the slot array, and the typed queue generated for one message type.
+ * The Makefile also builds this test with MESSAGE_QUEUE_SPSC.
+ */
+
+#include <string.h>
+
+#include "message_queue_core.h"
+#include "test.h"
+
+#define SLOTS 8
+
+/* 12 bytes, so aligned slots are padded to a 16 byte stride */
+struct message {
+    uint32_t sequence;
+    uint32_t check;
+    uint32_t extra;
+};
+
+/* 12 slots are rounded down to 8 */
+DEFINE_TYPED_MESSAGE_QUEUE(typed_queue, struct message, 12)
+
+static struct message make(uint32_t sequence)
+{
+    struct message msg = { sequence, ~sequence, sequence * 3 };
+
+    return msg;
+}
+
+static bool matches(const struct message *msg, uint32_t sequence)
+{
+    return msg->sequence == sequence && msg->check == ~sequence && msg->extra == sequence * 3;
+}
+
+static void test_push_pop(void)
+{
+    static DECLARE_MESSAGE_QUEUE_BUFFER(SLOTS, sizeof(struct message));
+    struct message_queue mq;
+    struct message msg;
+
+    message_queue_init(&mq, buffer, sizeof(struct message), SLOTS + 3);
+    CHECK_EQ(mq.slot_count, SLOTS);
+    CHECK_EQ(message_queue_pop(&mq, &msg), -EAGAIN);
+    CHECK_EQ(message_queue_peek(&mq, &msg), -EAGAIN);
+
+    /* One slot is kept free */
+    for (uint32_t i = 0; i < SLOTS - 1; i++) {
+        msg = make(i);
+        CHECK_EQ(message_queue_push(&mq, &msg), 0);
+    }
+    CHECK_EQ(message_queue_push(&mq, &msg), -ENOBUFS);
+
+    /* Peek leaves the message queued, and the order holds across the wrap */
+    for (uint32_t i = 0; i < 3 * SLOTS; i++) {
+        CHECK_EQ(message_queue_peek(&mq, &msg), 0);
+        CHECK(matches(&msg, i));
+        CHECK_EQ(message_queue_pop(&mq, &msg), 0);
+        CHECK(matches(&msg, i));
+        msg = make(i + SLOTS - 1);
+        CHECK_EQ(message_queue_push(&mq, &msg), 0);
+    }
+
+    message_queue_flush(&mq);
+    CHECK_EQ(message_queue_pop(&mq, &msg), -EAGAIN);
+}
+
+static void check_batches(struct message_queue *mq)
+{
+    struct message in[SLOTS];
+    struct message out[SLOTS];
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+
+    CHECK_EQ(message_queue_pop_n(mq, out, 1), -EAGAIN);
+    CHECK_EQ(message_queue_push_n(mq, in, 0), 0);
+    CHECK_EQ(message_queue_pop_n(mq, out, 0), 0);
+
+    /* Batches of every size, so some of them wrap the slot array */
+    for (uint32_t round = 0; round < 4 * SLOTS; round++) {
+        uint32_t count = round % SLOTS + 1;
+        int ret;
+
+        for (uint32_t i = 0; i < count; i++) {
+            in[i] = make(pushed + i);
+        }
+
+        /* Only the free slots are filled */
+        ret = message_queue_push_n(mq, in, count);
+        CHECK_EQ(ret, count < SLOTS ? (int)count : SLOTS - 1);
+        pushed += (uint32_t)ret;
+
+        CHECK_EQ(message_queue_pop_n(mq, out, SLOTS), ret);
+        for (int i = 0; i < ret; i++) {
+            CHECK(matches(&out[i], popped + (uint32_t)i));
+        }
+        popped += (uint32_t)ret;
+    }
+
+    /* A full queue refuses a batch, a queue with fewer messages returns those */
+    CHECK_EQ(message_queue_push_n(mq, in, SLOTS - 1), SLOTS - 1);
+    CHECK_EQ(message_queue_push_n(mq, in, 1), -ENOBUFS);
+    CHECK_EQ(message_queue_pop_n(mq, out, 2), 2);
+    CHECK_EQ(message_queue_pop_n(mq, out, SLOTS), SLOTS - 3);
+    CHECK_EQ(message_queue_pop_n(mq, out, SLOTS), -EAGAIN);
+}
+
+static void test_batches(void)
+{
+    static DECLARE_MESSAGE_QUEUE_BUFFER(SLOTS, sizeof(struct message));
+    struct message_queue mq;
+
+    message_queue_init(&mq, buffer, sizeof(struct message), SLOTS);
+    check_batches(&mq);
+}
+
+static void test_batches_aligned(void)
+{
+    static DECLARE_ALIGNED_MESSAGE_QUEUE_BUFFER(SLOTS, sizeof(struct message));
+    struct message_queue mq;
+    struct message msg = make(7);
+
+    message_queue_init_aligned(&mq, buffer, sizeof(struct message), SLOTS);
+    CHECK_EQ(mq.stride, 16);
+    check_batches(&mq);
+
+    /* Each message starts on its own stride */
+    message_queue_flush(&mq);
+    CHECK_EQ(message_queue_push(&mq, &msg), 0);
+    CHECK_EQ(message_queue_push(&mq, &msg), 0);
+    CHECK(memcmp(&buffer[16], &msg, sizeof(msg)) == 0);
+}
+
+static void test_claim_publish(void)
+{
+    /* Slots are accessed in place, so align them for the message type */
+    static CACHE_LINE_ALIGNED DECLARE_MESSAGE_QUEUE_BUFFER(SLOTS, sizeof(struct message));
+    struct message_queue mq;
+    struct message *slot;
+    struct message msg;
+
+    message_queue_init(&mq, buffer, sizeof(struct message), SLOTS);
+
+    /* Claiming twice returns the same slot, and nothing is queued yet */
+    slot = message_queue_claim(&mq);
+    CHECK(slot != NULL);
+    CHECK(message_queue_claim(&mq) == slot);
+    *slot = make(1);
+    CHECK_EQ(message_queue_pop(&mq, &msg), -EAGAIN);
+
+    CHECK_EQ(message_queue_publish(&mq), 0);
+    CHECK(message_queue_claim(&mq) != slot);
+    CHECK_EQ(message_queue_pop(&mq, &msg), 0);
+    CHECK(matches(&msg, 1));
+
+    for (uint32_t i = 0; i < SLOTS - 1; i++) {
+        slot = message_queue_claim(&mq);
+        CHECK(slot != NULL);
+        if (!slot) {
+            return;
+        }
+        *slot = make(i);
+        CHECK_EQ(message_queue_publish(&mq), 0);
+    }
+    CHECK(message_queue_claim(&mq) == NULL);
+    CHECK_EQ(message_queue_publish(&mq), -ENOBUFS);
+
+    for (uint32_t i = 0; i < SLOTS - 1; i++) {
+        CHECK_EQ(message_queue_pop(&mq, &msg), 0);
+        CHECK(matches(&msg, i));
+    }
+}
+
+static void test_front_release(void)
+{
+    static CACHE_LINE_ALIGNED DECLARE_MESSAGE_QUEUE_BUFFER(SLOTS, sizeof(struct message));
+    struct message_queue mq;
+    struct message *front;
+    struct message msg;
+
+    message_queue_init(&mq, buffer, sizeof(struct message), SLOTS);
+    CHECK(message_queue_front(&mq) == NULL);
+    CHECK_EQ(message_queue_release(&mq), -EAGAIN);
+
+    /* Messages are read in place, across the wrap, until released */
+    for (uint32_t i = 0; i < 3 * SLOTS; i++) {
+        msg = make(i);
+        CHECK_EQ(message_queue_push(&mq, &msg), 0);
+
+        front = message_queue_front(&mq);
+        CHECK(front != NULL);
+        if (!front) {
+            return;
+        }
+        CHECK(front == (struct message *)&buffer[(i % SLOTS) * sizeof(msg)]);
+        CHECK(message_queue_front(&mq) == front);
+        CHECK(matches(front, i));
+        CHECK_EQ(message_queue_release(&mq), 0);
+    }
+    CHECK(message_queue_front(&mq) == NULL);
+}
+
+static void test_typed_queue(void)
+{
+    static struct typed_queue mq;
+    struct message msg;
+
+    CHECK_EQ(sizeof(mq.buffer) / sizeof(mq.buffer[0]), SLOTS);
+
+    typed_queue_init(&mq);
+    CHECK_EQ(typed_queue_pop(&mq, &msg), -EAGAIN);
+    CHECK_EQ(typed_queue_peek(&mq, &msg), -EAGAIN);
+
+    for (uint32_t i = 0; i < SLOTS - 1; i++) {
+        msg = make(i);
+        CHECK_EQ(typed_queue_push(&mq, &msg), 0);
+    }
+    CHECK_EQ(typed_queue_push(&mq, &msg), -ENOBUFS);
+
+    for (uint32_t i = 0; i < 3 * SLOTS; i++) {
+        CHECK_EQ(typed_queue_peek(&mq, &msg), 0);
+        CHECK(matches(&msg, i));
+        CHECK_EQ(typed_queue_pop(&mq, &msg), 0);
+        CHECK(matches(&msg, i));
+        msg = make(i + SLOTS - 1);
+        CHECK_EQ(typed_queue_push(&mq, &msg), 0);
+    }
+
+    typed_queue_flush(&mq);
+    CHECK_EQ(typed_queue_pop(&mq, &msg), -EAGAIN);
+}
+
+int main(void)
+{
+    RUN_TEST(test_push_pop);
+    RUN_TEST(test_batches);
+    RUN_TEST(test_batches_aligned);
+    RUN_TEST(test_claim_publish);
+    RUN_TEST(test_front_release);
+    RUN_TEST(test_typed_queue);
+
+    return TEST_EXIT_STATUS();
+}
@@ -0,0 +1,150 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Stress test of the MPMC message queue: several producers and consumers
+ * share a queue much smaller than the stream. Every message must come out
+ * exactly once, intact, and in order for each producer as seen by any one
+ * consumer.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "mpmc_message_queue.h"
+#include "test.h"
+
+#define PRODUCERS 4
+#define CONSUMERS 4
+#define MESSAGES 20000
+
+struct message {
+    uint32_t producer;
+    uint32_t sequence;
+    uint32_t check;
+};
+
+static DECLARE_MPMC_MESSAGE_QUEUE_BUFFER(8, sizeof(struct message));
+static struct mpmc_message_queue mq;
+
+static atomic_uint seen[PRODUCERS][MESSAGES];
+static atomic_uint consumed;
+static atomic_uint bad;
+
+static void *producer(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+
+    for (uint32_t i = 0; i < MESSAGES; i++) {
+        struct message msg = { id, i, ~(id * MESSAGES + i) };
+
+        while (mpmc_message_queue_push(&mq, &msg) != 0) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    uint32_t last[PRODUCERS];
+
+    (void)arg;
+    for (uint32_t p = 0; p < PRODUCERS; p++) {
+        last[p] = UINT32_MAX;
+    }
+
+    while (atomic_load(&consumed) < PRODUCERS * MESSAGES) {
+        struct message msg;
+
+        if (mpmc_message_queue_pop(&mq, &msg) != 0) {
+            sched_yield();
+            continue;
+        }
+
+        if (msg.producer >= PRODUCERS || msg.sequence >= MESSAGES ||
+            msg.check != ~(msg.producer * MESSAGES + msg.sequence) ||
+            (last[msg.producer] != UINT32_MAX && msg.sequence <= last[msg.producer]) ||
+            atomic_fetch_add(&seen[msg.producer][msg.sequence], 1) != 0) {
+            atomic_fetch_add(&bad, 1);
+        } else {
+            last[msg.producer] = msg.sequence;
+        }
+        atomic_fetch_add(&consumed, 1);
+    }
+
+    return NULL;
+}
+
+static void test_mpmc_stress(void)
+{
+    pthread_t producers[PRODUCERS];
+    pthread_t consumers[CONSUMERS];
+    struct message msg;
+
+    CHECK_EQ(mpmc_message_queue_init(&mq, buffer, sizeof(struct message), 8), 0);
+
+    for (uint32_t i = 0; i < CONSUMERS; i++) {
+        CHECK_EQ(pthread_create(&consumers[i], NULL, consumer, NULL), 0);
+    }
+    for (uint32_t i = 0; i < PRODUCERS; i++) {
+        CHECK_EQ(pthread_create(&producers[i], NULL, producer, (void *)(uintptr_t)i), 0);
+    }
+
+    for (uint32_t i = 0; i < PRODUCERS; i++) {
+        pthread_join(producers[i], NULL);
+    }
+    for (uint32_t i = 0; i < CONSUMERS; i++) {
+        pthread_join(consumers[i], NULL);
+    }
+
+    CHECK_EQ(atomic_load(&consumed), PRODUCERS * MESSAGES);
+    CHECK_EQ(atomic_load(&bad), 0);
+    CHECK_EQ(mpmc_message_queue_pop(&mq, &msg), -EAGAIN);
+}
+
+/* A queue needs two slots to tell a pending message from a free slot */
+static void test_init_too_small(void)
+{
+    struct message msg = { 0, 0, 0 };
+
+    CHECK_EQ(mpmc_message_queue_init(&mq, buffer, sizeof(struct message), 0), -EINVAL);
+    CHECK_EQ(mpmc_message_queue_init(&mq, buffer, sizeof(struct message), 1), -EINVAL);
+    CHECK_EQ(mpmc_message_queue_init(&mq, NULL, sizeof(struct message), 8), -EINVAL);
+
+    /* Three slots round down to two */
+    CHECK_EQ(mpmc_message_queue_init(&mq, buffer, sizeof(struct message), 3), 0);
+    CHECK_EQ(mpmc_message_queue_push(&mq, &msg), 0);
+    CHECK_EQ(mpmc_message_queue_push(&mq, &msg), 0);
+    CHECK_EQ(mpmc_message_queue_push(&mq, &msg), -ENOBUFS);
+}
+
+int main(void)
+{
+    RUN_TEST(test_init_too_small);
+    RUN_TEST(test_mpmc_stress);
+
+    return TEST_EXIT_STATUS();
+}
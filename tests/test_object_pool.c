@@ -0,0 +1,159 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Stress test of the object pool: threads allocate and release blocks
+ * concurrently, through the shared free list and through per-thread caches,
+ * and stamp every block they hold. A block handed to two threads at once
+ * shows up as a stamp overwritten before its owner frees it.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include "object_pool.h"
+#include "test.h"
+
+#define THREADS 4
+#define ROUNDS 20000
+#define BLOCKS 64
+#define HELD 6
+
+struct block {
+    uint32_t owner;
+    uint32_t round;
+    uint8_t payload[24];
+};
+
+static DECLARE_OBJECT_POOL_BUFFER(storage, BLOCKS, sizeof(struct block));
+static struct object_pool pool;
+static atomic_uint bad;
+
+static void stamp(struct block *b, uint32_t owner, uint32_t round)
+{
+    b->owner = owner;
+    b->round = round;
+    memset(b->payload, (int)(owner * 31 + round), sizeof(b->payload));
+}
+
+static bool stamped(const struct block *b, uint32_t owner, uint32_t round)
+{
+    if (b->owner != owner || b->round != round) {
+        return false;
+    }
+
+    for (size_t i = 0; i < sizeof(b->payload); i++) {
+        if (b->payload[i] != (uint8_t)(owner * 31 + round)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void *worker(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+    bool cached = id & 1;
+    struct object_pool_cache cache;
+    struct block *held[HELD];
+
+    object_pool_cache_init(&cache, &pool);
+
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        uint32_t count = round % HELD + 1;
+        uint32_t got = 0;
+
+        while (got < count) {
+            struct block *b = cached ? object_pool_cache_alloc(&cache) : object_pool_alloc(&pool);
+
+            if (!b) {
+                break;
+            }
+
+            stamp(b, id, round);
+            held[got++] = b;
+        }
+
+        if (!(round % 8)) {
+            sched_yield();
+        }
+
+        for (uint32_t i = 0; i < got; i++) {
+            if (!stamped(held[i], id, round)) {
+                atomic_fetch_add(&bad, 1);
+            }
+
+            int ret = cached ? object_pool_cache_free(&cache, held[i]) : object_pool_free(&pool, held[i]);
+            if (ret != 0) {
+                atomic_fetch_add(&bad, 1);
+            }
+        }
+    }
+
+    object_pool_cache_drain(&cache);
+
+    return NULL;
+}
+
+static void test_pool_stress(void)
+{
+    pthread_t threads[THREADS];
+    void *blocks[BLOCKS];
+    uint32_t count = 0;
+
+    CHECK_EQ(object_pool_init(&pool, storage, sizeof(struct block), BLOCKS), 0);
+
+    for (uint32_t i = 0; i < THREADS; i++) {
+        CHECK_EQ(pthread_create(&threads[i], NULL, worker, (void *)(uintptr_t)i), 0);
+    }
+    for (uint32_t i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    CHECK_EQ(atomic_load(&bad), 0);
+
+    /* Every block is back on the free list, exactly once */
+    while (count < BLOCKS) {
+        blocks[count] = object_pool_alloc(&pool);
+        if (!blocks[count]) {
+            break;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            CHECK(blocks[i] != blocks[count]);
+        }
+        count++;
+    }
+
+    CHECK_EQ(count, BLOCKS);
+    CHECK(object_pool_alloc(&pool) == NULL);
+}
+
+int main(void)
+{
+    RUN_TEST(test_pool_stress);
+
+    return TEST_EXIT_STATUS();
+}
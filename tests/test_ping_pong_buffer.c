@@ -0,0 +1,275 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Read contract of the ping-pong buffer: ping_pong_buffer_read() returns 0 on
+ * success, ping_pong_buffer_read_len() also reports the copied frame length.
+ * Also covers the N-buffer queue, in-place access, and the latest-value-wins
+ * triple buffer with a writer and a reader thread.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include "ping_pong_buffer.h"
+#include "test.h"
+
+static uint8_t buffer1[16];
+static uint8_t buffer2[16];
+static uint8_t buffer3[16];
+static uint8_t buffer4[16];
+
+#define FRAMES 100000
+
+static struct ping_pong_buffer shared;
+
+static void test_read_returns_zero(void)
+{
+    struct ping_pong_buffer ppb;
+    uint8_t data[] = {1, 2, 3};
+    uint8_t out[sizeof(buffer1)];
+
+    ping_pong_buffer_init(&ppb, buffer1, buffer2, sizeof(buffer1));
+
+    CHECK_EQ(ping_pong_buffer_read(&ppb, out, sizeof(out)), -EAGAIN);
+    CHECK_EQ(ping_pong_buffer_write(&ppb, data, sizeof(data)), 0);
+    CHECK_EQ(ping_pong_buffer_read(&ppb, out, sizeof(data)), 0);
+    CHECK(memcmp(out, data, sizeof(data)) == 0);
+    CHECK_EQ(ping_pong_buffer_read(&ppb, out, sizeof(out)), -EAGAIN);
+}
+
+static void test_read_len_reports_length(void)
+{
+    struct ping_pong_buffer ppb;
+    uint8_t data[] = {4, 5, 6, 7, 8};
+    uint8_t out[sizeof(buffer1)];
+    uint32_t copied = 0;
+
+    ping_pong_buffer_init(&ppb, buffer1, buffer2, sizeof(buffer1));
+
+    CHECK_EQ(ping_pong_buffer_read_len(&ppb, out, sizeof(buffer1) + 1, &copied), -EINVAL);
+
+    CHECK_EQ(ping_pong_buffer_write(&ppb, data, sizeof(data)), 0);
+    CHECK_EQ(ping_pong_buffer_read_len(&ppb, out, sizeof(out), &copied), 0);
+    CHECK_EQ(copied, sizeof(data));
+    CHECK(memcmp(out, data, sizeof(data)) == 0);
+
+    /* A shorter read truncates to the caller's length */
+    CHECK_EQ(ping_pong_buffer_write(&ppb, data, sizeof(data)), 0);
+    CHECK_EQ(ping_pong_buffer_read_len(&ppb, out, 2, &copied), 0);
+    CHECK_EQ(copied, 2);
+
+    CHECK_EQ(ping_pong_buffer_read_len(&ppb, out, sizeof(out), &copied), -EAGAIN);
+}
+
+static void test_init_n(void)
+{
+    struct ping_pong_buffer ppb;
+    uint8_t *const buffers[PING_PONG_BUFFER_MAX + 1] = { buffer1, buffer2 };
+
+    CHECK_EQ(ping_pong_buffer_init_n(&ppb, buffers, 1, sizeof(buffer1)), -EINVAL);
+    CHECK_EQ(ping_pong_buffer_init_n(&ppb, buffers, PING_PONG_BUFFER_MAX + 1, sizeof(buffer1)), -EINVAL);
+    CHECK_EQ(ping_pong_buffer_init_n(&ppb, buffers, 2, sizeof(buffer1)), 0);
+    CHECK_EQ(ppb.mode, PING_PONG_MODE_QUEUE);
+}
+
+/* Frames pass through all N buffers in order, and a full queue refuses more */
+static void test_queue_n(void)
+{
+    struct ping_pong_buffer ppb;
+    uint8_t *const buffers[4] = { buffer1, buffer2, buffer3, buffer4 };
+    uint8_t frame[sizeof(buffer1)];
+    uint32_t copied = 0;
+    uint32_t written = 0;
+    uint32_t read = 0;
+
+    CHECK_EQ(ping_pong_buffer_init_n(&ppb, buffers, 4, sizeof(buffer1)), 0);
+
+    for (uint32_t round = 0; round < 10; round++) {
+        /* Alternate between filling the queue and keeping one frame queued */
+        uint32_t target = round % 2 ? 4 : 1;
+
+        while (written - read < target) {
+            memset(frame, (int)written, sizeof(frame));
+            CHECK_EQ(ping_pong_buffer_write(&ppb, frame, written % sizeof(frame) + 1), 0);
+            written++;
+        }
+        if (target == 4) {
+            CHECK_EQ(ping_pong_buffer_write(&ppb, frame, 1), -EAGAIN);
+            CHECK(ping_pong_acquire_write(&ppb) == NULL);
+        }
+
+        while (written - read > target / 2) {
+            CHECK_EQ(ping_pong_buffer_read_len(&ppb, frame, sizeof(frame), &copied), 0);
+            CHECK_EQ(copied, read % sizeof(frame) + 1);
+            CHECK_EQ(frame[0], (uint8_t)read);
+            CHECK_EQ(frame[copied - 1], (uint8_t)read);
+            read++;
+        }
+    }
+}
+
+/* A frame is built and parsed in place, and each buffer is used in turn */
+static void test_in_place(void)
+{
+    struct ping_pong_buffer ppb;
+    uint8_t *const buffers[3] = { buffer1, buffer2, buffer3 };
+    uint8_t *ptr;
+    uint32_t length = 0;
+
+    CHECK_EQ(ping_pong_buffer_init_n(&ppb, buffers, 3, sizeof(buffer1)), 0);
+    CHECK(ping_pong_acquire_read(&ppb, &length) == NULL);
+
+    for (uint32_t i = 0; i < 6; i++) {
+        ptr = ping_pong_acquire_write(&ppb);
+        CHECK(ptr == buffers[i % 3]);
+        if (!ptr) {
+            return;
+        }
+        ptr[0] = (uint8_t)i;
+        CHECK_EQ(ping_pong_commit_write(&ppb, sizeof(buffer1) + 1), -EINVAL);
+        CHECK_EQ(ping_pong_commit_write(&ppb, 1), 0);
+
+        ptr = ping_pong_acquire_read(&ppb, &length);
+        CHECK(ptr == buffers[i % 3]);
+        if (!ptr) {
+            return;
+        }
+        CHECK_EQ(length, 1);
+        CHECK_EQ(ptr[0], i);
+        ping_pong_release_read(&ppb);
+    }
+    CHECK(ping_pong_acquire_read(&ppb, &length) == NULL);
+}
+
+/* The writer never blocks, and the reader gets the newest frame only once */
+static void test_triple_latest(void)
+{
+    struct ping_pong_buffer ppb;
+    uint8_t frame[sizeof(buffer1)];
+    uint8_t *front;
+    uint32_t copied = 0;
+
+    ping_pong_buffer_init_triple(&ppb, buffer1, buffer2, buffer3, sizeof(buffer1));
+    CHECK_EQ(ppb.mode, PING_PONG_MODE_LATEST);
+    CHECK_EQ(ping_pong_buffer_read(&ppb, frame, sizeof(frame)), -EAGAIN);
+
+    for (uint8_t i = 1; i <= 5; i++) {
+        memset(frame, i, i);
+        CHECK_EQ(ping_pong_buffer_write(&ppb, frame, i), 0);
+    }
+
+    memset(frame, 0, sizeof(frame));
+    CHECK_EQ(ping_pong_buffer_read_len(&ppb, frame, sizeof(frame), &copied), 0);
+    CHECK_EQ(copied, 5);
+    CHECK_EQ(frame[4], 5);
+    CHECK_EQ(ping_pong_buffer_read(&ppb, frame, sizeof(frame)), -EAGAIN);
+
+    /* The front buffer is left alone while the writer keeps publishing */
+    CHECK_EQ(ping_pong_buffer_write(&ppb, frame, 1), 0);
+    front = ping_pong_acquire_read(&ppb, &copied);
+    CHECK(front != NULL);
+    if (!front) {
+        return;
+    }
+    memset(front, 0xee, sizeof(buffer1));
+    for (uint8_t i = 0; i < 10; i++) {
+        memset(frame, i, sizeof(frame));
+        CHECK_EQ(ping_pong_buffer_write(&ppb, frame, sizeof(frame)), 0);
+        CHECK_EQ(front[0], 0xee);
+    }
+    ping_pong_release_read(&ppb);
+
+    CHECK_EQ(ping_pong_buffer_read_len(&ppb, frame, sizeof(frame), &copied), 0);
+    CHECK_EQ(copied, sizeof(frame));
+    CHECK_EQ(frame[0], 9);
+}
+
+static void *triple_writer(void *arg)
+{
+    (void)arg;
+    for (uint32_t i = 1; i <= FRAMES; i++) {
+        uint8_t *back = ping_pong_acquire_write(&shared);
+
+        /* Every word of a frame carries the same sequence number */
+        for (uint32_t j = 0; j < sizeof(buffer1); j += sizeof(i)) {
+            memcpy(back + j, &i, sizeof(i));
+        }
+        ping_pong_commit_write(&shared, sizeof(buffer1));
+        if (i % 64 == 0) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void test_triple_threads(void)
+{
+    pthread_t writer;
+    uint32_t last = 0;
+    uint32_t torn = 0;
+    uint32_t backwards = 0;
+
+    ping_pong_buffer_init_triple(&shared, buffer1, buffer2, buffer3, sizeof(buffer1));
+    CHECK_EQ(pthread_create(&writer, NULL, triple_writer, NULL), 0);
+
+    /* Frames may be skipped, but never torn or seen out of order */
+    while (last != FRAMES) {
+        uint32_t length = 0;
+        uint8_t *front = ping_pong_acquire_read(&shared, &length);
+        uint32_t first;
+
+        if (!front) {
+            sched_yield();
+            continue;
+        }
+
+        memcpy(&first, front, sizeof(first));
+        for (uint32_t j = 0; j < length; j += sizeof(first)) {
+            torn += memcmp(front + j, &first, sizeof(first)) != 0;
+        }
+        backwards += first <= last;
+        last = first;
+        ping_pong_release_read(&shared);
+    }
+
+    pthread_join(writer, NULL);
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(backwards, 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_read_returns_zero);
+    RUN_TEST(test_read_len_reports_length);
+    RUN_TEST(test_init_n);
+    RUN_TEST(test_queue_n);
+    RUN_TEST(test_in_place);
+    RUN_TEST(test_triple_latest);
+    RUN_TEST(test_triple_threads);
+
+    return TEST_EXIT_STATUS();
+}
@@ -0,0 +1,201 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Priority bands of the bounded message queue: the most urgent band comes
+ * out first, each band keeps FIFO order, and slots freed by any band are
+ * reused by the others. A random push/pop sequence is checked against a
+ * plain per-band array model.
+ */
+
+#include <stdlib.h>
+
+#include "prio_message_queue.h"
+#include "test.h"
+
+/* Not a power of two, and the message size is not a multiple of 4 */
+#define SLOTS 13
+
+struct message {
+    uint16_t band;
+    uint16_t sequence;
+    uint8_t tag;
+};
+
+static DECLARE_PRIO_MESSAGE_QUEUE_BUFFER(SLOTS, sizeof(struct message));
+
+static void test_init(void)
+{
+    struct prio_message_queue mq;
+    struct message msg = { 0, 0, 0 };
+
+    CHECK_EQ(prio_message_queue_init(&mq, buffer, sizeof(msg), 0), -EINVAL);
+    CHECK_EQ(prio_message_queue_init(&mq, buffer, sizeof(msg), PRIO_MESSAGE_QUEUE_NONE), -EINVAL);
+    CHECK_EQ(prio_message_queue_init(&mq, buffer, sizeof(msg), SLOTS), 0);
+    CHECK_EQ(mq.stride % 4, 0);
+    CHECK_EQ(prio_message_queue_count(&mq), 0);
+    CHECK_EQ(prio_message_queue_pop(&mq, &msg, NULL), -EAGAIN);
+    CHECK_EQ(prio_message_queue_peek(&mq, &msg, NULL), -EAGAIN);
+    CHECK_EQ(prio_message_queue_push(&mq, &msg, PRIO_MESSAGE_QUEUE_BANDS), -EINVAL);
+}
+
+static void test_band_order(void)
+{
+    struct prio_message_queue mq;
+    struct message msg;
+    uint32_t priority = 0;
+
+    CHECK_EQ(prio_message_queue_init(&mq, buffer, sizeof(msg), SLOTS), 0);
+
+    /* Interleave three bands, lowest urgency first */
+    for (uint16_t i = 0; i < 4; i++) {
+        static const uint16_t bands[] = { 7, 3, 0 };
+
+        for (uint32_t b = 0; b < 3; b++) {
+            msg.band = bands[b];
+            msg.sequence = i;
+            msg.tag = (uint8_t)(bands[b] * 16 + i);
+            CHECK_EQ(prio_message_queue_push(&mq, &msg, bands[b]), 0);
+        }
+    }
+    CHECK_EQ(prio_message_queue_count(&mq), 12);
+
+    /* Peek shows the head of the most urgent band without removing it */
+    CHECK_EQ(prio_message_queue_peek(&mq, &msg, &priority), 0);
+    CHECK_EQ(priority, 0);
+    CHECK_EQ(msg.sequence, 0);
+    CHECK_EQ(prio_message_queue_count(&mq), 12);
+
+    /* A later urgent message still overtakes the queued bulk ones */
+    CHECK_EQ(prio_message_queue_pop(&mq, &msg, &priority), 0);
+    msg.band = 1;
+    msg.sequence = 0;
+    msg.tag = 0x10;
+    CHECK_EQ(prio_message_queue_push(&mq, &msg, 1), 0);
+
+    static const uint16_t expect_band[] = { 0, 0, 0, 1, 3, 3, 3, 3, 7, 7, 7, 7 };
+    static const uint16_t expect_sequence[] = { 1, 2, 3, 0, 0, 1, 2, 3, 0, 1, 2, 3 };
+
+    for (uint32_t i = 0; i < 12; i++) {
+        CHECK_EQ(prio_message_queue_pop(&mq, &msg, &priority), 0);
+        CHECK_EQ(priority, expect_band[i]);
+        CHECK_EQ(msg.band, expect_band[i]);
+        CHECK_EQ(msg.sequence, expect_sequence[i]);
+        CHECK_EQ(msg.tag, (uint8_t)(expect_band[i] * 16 + expect_sequence[i]));
+    }
+    CHECK_EQ(prio_message_queue_pop(&mq, &msg, NULL), -EAGAIN);
+}
+
+static void test_full_and_flush(void)
+{
+    struct prio_message_queue mq;
+    struct message msg = { 0, 0, 0 };
+
+    CHECK_EQ(prio_message_queue_init(&mq, buffer, sizeof(msg), SLOTS), 0);
+
+    /* Every slot is usable, shared by all bands */
+    for (uint32_t i = 0; i < SLOTS; i++) {
+        CHECK_EQ(prio_message_queue_push(&mq, &msg, i % PRIO_MESSAGE_QUEUE_BANDS), 0);
+    }
+    CHECK_EQ(prio_message_queue_push(&mq, &msg, 0), -ENOBUFS);
+    CHECK_EQ(prio_message_queue_count(&mq), SLOTS);
+
+    /* A slot freed by one band is taken by another */
+    CHECK_EQ(prio_message_queue_pop(&mq, &msg, NULL), 0);
+    CHECK_EQ(prio_message_queue_push(&mq, &msg, PRIO_MESSAGE_QUEUE_BANDS - 1), 0);
+    CHECK_EQ(prio_message_queue_push(&mq, &msg, 0), -ENOBUFS);
+
+    prio_message_queue_flush(&mq);
+    CHECK_EQ(prio_message_queue_count(&mq), 0);
+    CHECK_EQ(prio_message_queue_pop(&mq, &msg, NULL), -EAGAIN);
+    for (uint32_t i = 0; i < SLOTS; i++) {
+        CHECK_EQ(prio_message_queue_push(&mq, &msg, 2), 0);
+    }
+}
+
+/* Random pushes and pops against a FIFO array per band */
+static void test_random_model(void)
+{
+    struct prio_message_queue mq;
+    uint16_t model[PRIO_MESSAGE_QUEUE_BANDS][SLOTS];
+    uint32_t model_head[PRIO_MESSAGE_QUEUE_BANDS] = { 0 };
+    uint32_t model_count[PRIO_MESSAGE_QUEUE_BANDS] = { 0 };
+    uint32_t total = 0;
+    uint32_t bad = 0;
+    uint16_t sequence = 0;
+
+    srand(1);
+    CHECK_EQ(prio_message_queue_init(&mq, buffer, sizeof(struct message), SLOTS), 0);
+
+    for (uint32_t step = 0; step < 100000; step++) {
+        struct message msg;
+        uint32_t priority = 0;
+
+        if (rand() % 2) {
+            uint32_t band = (uint32_t)rand() % PRIO_MESSAGE_QUEUE_BANDS;
+            int ret;
+
+            msg.band = (uint16_t)band;
+            msg.sequence = sequence;
+            msg.tag = (uint8_t)sequence;
+            ret = prio_message_queue_push(&mq, &msg, band);
+            if (total == SLOTS) {
+                bad += ret != -ENOBUFS;
+                continue;
+            }
+            bad += ret != 0;
+            model[band][(model_head[band] + model_count[band]) % SLOTS] = sequence++;
+            model_count[band]++;
+            total++;
+        } else {
+            int ret = prio_message_queue_pop(&mq, &msg, &priority);
+            uint32_t band = 0;
+
+            if (!total) {
+                bad += ret != -EAGAIN;
+                continue;
+            }
+            while (!model_count[band]) {
+                band++;
+            }
+            bad += ret != 0 || priority != band || msg.band != band;
+            bad += msg.sequence != model[band][model_head[band]] || msg.tag != (uint8_t)msg.sequence;
+            model_head[band] = (model_head[band] + 1) % SLOTS;
+            model_count[band]--;
+            total--;
+        }
+        bad += prio_message_queue_count(&mq) != total;
+    }
+    CHECK_EQ(bad, 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_init);
+    RUN_TEST(test_band_order);
+    RUN_TEST(test_full_and_flush);
+    RUN_TEST(test_random_model);
+
+    return TEST_EXIT_STATUS();
+}
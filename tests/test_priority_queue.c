@@ -0,0 +1,306 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <limits.h>
+#include <stdlib.h>
+
+#include "container_of.h"
+#include "priority_queue.h"
+#include "test.h"
+
+#define ITEMS 1000
+
+struct item {
+    int value;
+    struct heap_node node;
+};
+
+static struct item items[ITEMS];
+
+/* Smallest value first */
+static int item_compare(struct heap_node *a, struct heap_node *b)
+{
+    int x = CONTAINER_OF(a, struct item, node)->value;
+    int y = CONTAINER_OF(b, struct item, node)->value;
+    return (x < y) - (x > y);
+}
+
+static void item_set(struct item *item, int value)
+{
+    item->value = value;
+#ifdef PQ_INLINE_KEY
+    item->node.key = (uint64_t)((int64_t)value - INT_MIN);
+#endif
+}
+
+static void items_init(void)
+{
+    srand(1);
+    for (int i = 0; i < ITEMS; i++) {
+        items[i].node = (struct heap_node){ 0 };
+#ifdef PQ_USE_ARRAY_HEAP
+        items[i].node.index = PQ_INDEX_NONE;
+#endif
+        item_set(&items[i], rand() % 10000);
+    }
+}
+
+/* Pop everything, checking the order, and return the number of nodes */
+static int drain(struct priority_queue *pq)
+{
+    struct heap_node *node;
+    int last = INT_MIN;
+    int count = 0;
+
+    while ((node = pq_pop(pq))) {
+        int value = CONTAINER_OF(node, struct item, node)->value;
+        CHECK(value >= last);
+        last = value;
+        count++;
+    }
+
+    return count;
+}
+
+static void test_insert_pop(void)
+{
+    struct priority_queue pq;
+
+    items_init();
+    CHECK_EQ(pq_init(&pq, item_compare), 0);
+
+    for (int i = 0; i < ITEMS; i++) {
+        CHECK_EQ(pq_insert(&pq, &items[i].node), 0);
+    }
+    CHECK_EQ(pq_insert(&pq, &items[0].node), -EEXIST);
+
+    CHECK_EQ(drain(&pq), ITEMS);
+    CHECK(pq_peek(&pq) == NULL);
+    pq_deinit(&pq);
+}
+
+static void test_remove_update(void)
+{
+    struct priority_queue pq;
+
+    items_init();
+    pq_init(&pq, item_compare);
+
+    for (int i = 0; i < ITEMS; i++) {
+        pq_insert(&pq, &items[i].node);
+    }
+
+    for (int i = 0; i < ITEMS; i += 3) {
+        CHECK_EQ(pq_remove(&pq, &items[i].node), 0);
+        CHECK_EQ(pq_remove(&pq, &items[i].node), -ENOENT);
+        CHECK_EQ(pq_update_key(&pq, &items[i].node), -ENOENT);
+    }
+
+    for (int i = 1; i < ITEMS; i += 3) {
+        item_set(&items[i], items[i].value % 2 ? -items[i].value : items[i].value * 2);
+        CHECK_EQ(pq_update_key(&pq, &items[i].node), 0);
+    }
+
+    CHECK_EQ(drain(&pq), ITEMS - (ITEMS + 2) / 3);
+    pq_deinit(&pq);
+}
+
+/* A popped node is no longer queued and can be queued again */
+static void test_pop_reinsert(void)
+{
+    struct priority_queue pq;
+
+    items_init();
+    pq_init(&pq, item_compare);
+
+    for (int i = 0; i < 3; i++) {
+        item_set(&items[i], i);
+        pq_insert(&pq, &items[i].node);
+    }
+
+    struct heap_node *node = pq_pop(&pq);
+    CHECK(node == &items[0].node);
+    CHECK_EQ(pq_remove(&pq, node), -ENOENT);
+    CHECK_EQ(pq_update_key(&pq, node), -ENOENT);
+
+    item_set(&items[0], 5);
+    CHECK_EQ(pq_insert(&pq, node), 0);
+    CHECK(pq_pop(&pq) == &items[1].node);
+    CHECK(pq_pop(&pq) == &items[2].node);
+    CHECK(pq_pop(&pq) == &items[0].node);
+    CHECK(pq_pop(&pq) == NULL);
+    pq_deinit(&pq);
+}
+
+static void test_build(void)
+{
+    struct priority_queue pq;
+    struct heap_node *nodes[ITEMS];
+
+    items_init();
+    pq_init(&pq, item_compare);
+
+    for (int i = 0; i < ITEMS; i++) {
+        nodes[i] = &items[i].node;
+    }
+
+    CHECK_EQ(pq_insert_batch(&pq, nodes, ITEMS / 2), 0);
+    CHECK_EQ(pq_build(&pq, nodes + ITEMS / 4, ITEMS / 2), 0);
+    CHECK_EQ(drain(&pq), ITEMS / 2);
+
+    nodes[ITEMS - 1] = nodes[0];
+    CHECK_EQ(pq_insert_batch(&pq, nodes, ITEMS), -EEXIST);
+    CHECK(pq_peek(&pq) == NULL);
+    pq_deinit(&pq);
+}
+
+/* A rejected pq_build() leaves the previous contents queued */
+static void test_build_invalid(void)
+{
+    struct priority_queue pq;
+    struct heap_node *nodes[ITEMS];
+
+    items_init();
+    pq_init(&pq, item_compare);
+
+    for (int i = 0; i < ITEMS; i++) {
+        nodes[i] = &items[i].node;
+    }
+
+    CHECK_EQ(pq_insert_batch(&pq, nodes, ITEMS / 2), 0);
+
+    nodes[ITEMS - 1] = NULL;
+    CHECK_EQ(pq_build(&pq, nodes + ITEMS / 4, ITEMS * 3 / 4), -EINVAL);
+
+    nodes[ITEMS - 1] = nodes[ITEMS / 4];
+    CHECK_EQ(pq_build(&pq, nodes + ITEMS / 4, ITEMS * 3 / 4), -EEXIST);
+
+    nodes[ITEMS - 1] = nodes[ITEMS / 2];
+    CHECK_EQ(pq_build(&pq, nodes + ITEMS / 4, ITEMS * 3 / 4), -EEXIST);
+
+    /* The rejected nodes are not queued, the previous ones all are */
+    CHECK_EQ(pq_remove(&pq, nodes[ITEMS / 2]), -ENOENT);
+    CHECK_EQ(pq_insert(&pq, nodes[ITEMS / 2]), 0);
+    CHECK_EQ(pq_remove(&pq, nodes[ITEMS / 2]), 0);
+    CHECK_EQ(drain(&pq), ITEMS / 2);
+    pq_deinit(&pq);
+}
+
+#ifdef PQ_INLINE_KEY
+/* Nodes are ordered by key alone, including the upper 32 bits */
+static void test_inline_key(void)
+{
+    struct priority_queue pq;
+
+    items_init();
+    CHECK_EQ(pq_init(&pq, NULL), 0);
+
+    for (int i = 0; i < ITEMS; i++) {
+        items[i].node.key = ((uint64_t)(ITEMS - i) << 32) | (uint32_t)i;
+        CHECK_EQ(pq_insert(&pq, &items[i].node), 0);
+    }
+
+    /* Move one node to the front and one to the back */
+    items[0].node.key = 0;
+    CHECK_EQ(pq_update_key(&pq, &items[0].node), 0);
+    items[ITEMS - 1].node.key = UINT64_MAX;
+    CHECK_EQ(pq_update_key(&pq, &items[ITEMS - 1].node), 0);
+
+    CHECK(pq_pop(&pq) == &items[0].node);
+    for (int i = ITEMS - 2; i > 0; i--) {
+        CHECK(pq_pop(&pq) == &items[i].node);
+    }
+    CHECK(pq_pop(&pq) == &items[ITEMS - 1].node);
+    CHECK(pq_pop(&pq) == NULL);
+    pq_deinit(&pq);
+}
+#endif
+
+struct event {
+    uint64_t deadline;
+    uint32_t id;
+};
+
+#define EVENT_BEFORE(a, b) ((a)->deadline < (b)->deadline)
+
+DEFINE_TYPED_PRIORITY_QUEUE(event_queue, struct event, EVENT_BEFORE)
+
+static void test_typed(void)
+{
+    struct event storage[ITEMS];
+    struct event_queue pq;
+    struct event event = { 0, 0 };
+    uint64_t last = 0;
+    uint32_t bad = 0;
+
+    CHECK_EQ(event_queue_init(&pq, NULL, ITEMS), -EINVAL);
+    CHECK_EQ(event_queue_init(&pq, storage, 0), -EINVAL);
+    CHECK_EQ(event_queue_init(&pq, storage, ITEMS), 0);
+    CHECK(event_queue_peek(&pq) == NULL);
+    CHECK_EQ(event_queue_pop(&pq, &event), -EAGAIN);
+
+    srand(2);
+    for (uint32_t i = 0; i < ITEMS; i++) {
+        event.deadline = (uint64_t)(rand() % 5000);
+        event.id = i;
+        CHECK_EQ(event_queue_push(&pq, &event), 0);
+    }
+    CHECK_EQ(event_queue_push(&pq, &event), -ENOBUFS);
+    CHECK_EQ(event_queue_size(&pq), ITEMS);
+
+    /* Pop half, push some earlier ones, then drain in order */
+    for (uint32_t i = 0; i < ITEMS / 2; i++) {
+        CHECK_EQ(event_queue_pop(&pq, &event), 0);
+        bad += event.deadline < last;
+        last = event.deadline;
+    }
+    for (uint32_t i = 0; i < ITEMS / 4; i++) {
+        event.deadline = last + (uint64_t)(rand() % 100);
+        CHECK_EQ(event_queue_push(&pq, &event), 0);
+    }
+    while (event_queue_peek(&pq)) {
+        uint64_t front = event_queue_peek(&pq)->deadline;
+
+        CHECK_EQ(event_queue_pop(&pq, &event), 0);
+        bad += event.deadline != front || event.deadline < last;
+        last = event.deadline;
+    }
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(event_queue_size(&pq), 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_insert_pop);
+    RUN_TEST(test_remove_update);
+    RUN_TEST(test_pop_reinsert);
+    RUN_TEST(test_build);
+    RUN_TEST(test_build_invalid);
+#ifdef PQ_INLINE_KEY
+    RUN_TEST(test_inline_key);
+#endif
+    RUN_TEST(test_typed);
+
+    return TEST_EXIT_STATUS();
+}
@@ -0,0 +1,290 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * C++20 awaitables of queue_coro.hpp: sleeping coroutines resume on the
+ * tick their timer expires, parked consumers are served in arrival order by
+ * the producer call that makes data available, and destroying a suspended
+ * coroutine withdraws its timer or its place in the waiter list.
+ */
+
+#include <cstring>
+
+#include "queue_coro.hpp"
+#include "test.h"
+
+/* A coroutine that stays suspended at its end, so the test can destroy it */
+struct task {
+    struct promise_type {
+        task get_return_object() noexcept { return task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    explicit task(std::coroutine_handle<promise_type> handle) noexcept : handle(handle) {}
+    task(const task &) = delete;
+    task &operator=(const task &) = delete;
+    ~task() { handle.destroy(); }
+
+    bool done() const noexcept { return handle.done(); }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+static uint64_t now;
+
+static void tick(struct timer_base *base, int count)
+{
+    while (count-- > 0) {
+        now++;
+        timer_increment_tick_on(base);
+    }
+}
+
+static coro::detached sleeper(struct timer_base *base, uint64_t ticks, uint64_t *woke, int *result)
+{
+    *result = co_await coro::timer_sleep(base, ticks);
+    *woke = now;
+}
+
+static void test_sleep(void)
+{
+    struct timer_base base;
+    uint64_t woke[3] = { 0, 0, 0 };
+    int result[3] = { -1, -1, -1 };
+
+    timer_base_init(&base);
+    now = 0;
+
+    sleeper(&base, 7, &woke[0], &result[0]);
+    sleeper(&base, 3, &woke[1], &result[1]);
+    CHECK_EQ(result[0], -1);
+    CHECK_EQ(result[1], -1);
+
+    tick(&base, 2);
+    CHECK_EQ(result[1], -1);
+    tick(&base, 1);
+    CHECK_EQ(result[1], 0);
+    CHECK_EQ(woke[1], 3);
+    tick(&base, 10);
+    CHECK_EQ(result[0], 0);
+    CHECK_EQ(woke[0], 7);
+
+    /* Zero ticks does not suspend */
+    sleeper(&base, 0, &woke[2], &result[2]);
+    CHECK_EQ(result[2], 0);
+    CHECK_EQ(woke[2], 13);
+    CHECK_EQ(timer_next_expiry_on(&base), TIMER_NO_EXPIRY);
+
+    timer_base_deinit(&base);
+}
+
+#ifdef PQ_USE_ARRAY_HEAP
+/* A sleep that cannot be queued completes at once with the error */
+static void test_sleep_error(void)
+{
+    PQ_SLOT storage[1];
+    struct timer_base base;
+    uint64_t woke[2] = { 0, 0 };
+    int result[2] = { -1, -1 };
+
+    CHECK_EQ(timer_base_init_storage(&base, storage, 1), 0);
+    now = 0;
+
+    sleeper(&base, 5, &woke[0], &result[0]);
+    sleeper(&base, 5, &woke[1], &result[1]);
+    CHECK_EQ(result[0], -1);
+    CHECK_EQ(result[1], -ENOBUFS);
+
+    tick(&base, 5);
+    CHECK_EQ(result[0], 0);
+    CHECK_EQ(woke[0], 5);
+
+    timer_base_deinit(&base);
+}
+#endif
+
+static task sleep_task(struct timer_base *base, uint64_t ticks, bool *woke)
+{
+    co_await coro::timer_sleep(base, ticks);
+    *woke = true;
+}
+
+/* Destroying a sleeping coroutine stops its timer */
+static void test_sleep_destroyed(void)
+{
+    struct timer_base base;
+    bool woke = false;
+
+    timer_base_init(&base);
+    {
+        task t = sleep_task(&base, 4, &woke);
+
+        CHECK(!t.done());
+        CHECK_EQ(timer_next_expiry_on(&base), 4);
+    }
+    CHECK_EQ(timer_next_expiry_on(&base), TIMER_NO_EXPIRY);
+    tick(&base, 10);
+    CHECK(!woke);
+
+    timer_base_deinit(&base);
+}
+
+static DECLARE_MESSAGE_QUEUE_BUFFER(4, sizeof(uint32_t));
+
+static coro::detached consumer(coro::message_channel &channel, uint32_t *out, int count, int *done)
+{
+    for (int i = 0; i < count; i++) {
+        co_await channel.pop(&out[i]);
+        (*done)++;
+    }
+}
+
+static void test_message_channel(void)
+{
+    struct message_queue mq;
+    uint32_t first[2] = { 0, 0 };
+    uint32_t second[2] = { 0, 0 };
+    int done_first = 0;
+    int done_second = 0;
+
+    message_queue_init(&mq, buffer, sizeof(uint32_t), 4);
+    coro::message_channel channel(mq);
+
+    /* A message pushed before anyone waits is taken without suspending */
+    uint32_t value = 10;
+    CHECK_EQ(channel.push(&value), 0);
+    consumer(channel, first, 2, &done_first);
+    CHECK_EQ(done_first, 1);
+    CHECK_EQ(first[0], 10);
+
+    /* Parked consumers are served oldest first */
+    consumer(channel, second, 2, &done_second);
+    CHECK_EQ(done_second, 0);
+    for (value = 11; value <= 13; value++) {
+        CHECK_EQ(channel.push(&value), 0);
+    }
+    CHECK_EQ(done_first, 2);
+    CHECK_EQ(first[1], 11);
+    CHECK_EQ(done_second, 2);
+    CHECK_EQ(second[0], 12);
+    CHECK_EQ(second[1], 13);
+
+    /* With nobody waiting the queue fills up as usual */
+    for (value = 0; value < 3; value++) {
+        CHECK_EQ(channel.push(&value), 0);
+    }
+    CHECK_EQ(channel.push(&value), -ENOBUFS);
+}
+
+static task pop_task(coro::message_channel &channel, uint32_t *out)
+{
+    co_await channel.pop(out);
+}
+
+/* Destroying a parked consumer removes it from the waiter list */
+static void test_message_channel_destroyed(void)
+{
+    struct message_queue mq;
+    uint32_t lost = 0;
+    uint32_t kept = 0;
+    uint32_t value = 42;
+
+    message_queue_init(&mq, buffer, sizeof(uint32_t), 4);
+    coro::message_channel channel(mq);
+
+    task waiting = pop_task(channel, &kept);
+    {
+        task gone = pop_task(channel, &lost);
+        task also_gone = pop_task(channel, &lost);
+
+        CHECK(!gone.done());
+    }
+    CHECK_EQ(channel.push(&value), 0);
+    CHECK(waiting.done());
+    CHECK_EQ(kept, 42);
+    CHECK_EQ(lost, 0);
+    CHECK_EQ(message_queue_pop(&mq, &value), -EAGAIN);
+}
+
+static uint8_t ring_storage[16];
+
+static coro::detached reader(coro::ring_channel &channel, uint8_t *out, uint32_t length, int *done)
+{
+    co_await channel.read(out, length);
+    (*done)++;
+}
+
+static void test_ring_channel(void)
+{
+    struct ring_buffer rb;
+    uint8_t data[sizeof(ring_storage)];
+    uint8_t big[8];
+    uint8_t small[2];
+    int done_big = 0;
+    int done_small = 0;
+
+    for (uint8_t i = 0; i < sizeof(data); i++) {
+        data[i] = i;
+    }
+    ring_buffer_init(&rb, ring_storage, sizeof(ring_storage));
+    coro::ring_channel channel(rb);
+
+    /* The short read waits behind the long one until both can be served */
+    reader(channel, big, sizeof(big), &done_big);
+    reader(channel, small, sizeof(small), &done_small);
+    CHECK_EQ(channel.write(data, 4), 4);
+    CHECK_EQ(done_big, 0);
+    CHECK_EQ(done_small, 0);
+
+    CHECK_EQ(channel.write(data + 4, 6), 6);
+    CHECK_EQ(done_big, 1);
+    CHECK_EQ(done_small, 1);
+    CHECK(std::memcmp(big, data, sizeof(big)) == 0);
+    CHECK(std::memcmp(small, data + 8, sizeof(small)) == 0);
+
+    /* Data that is already buffered completes a read without suspending */
+    CHECK_EQ(channel.write(data, 2), 2);
+    reader(channel, small, sizeof(small), &done_small);
+    CHECK_EQ(done_small, 2);
+    CHECK(ring_buffer_is_empty(&rb));
+
+    CHECK_EQ(channel.write(data, sizeof(ring_storage)), -ENOBUFS);
+}
+
+int main(void)
+{
+    RUN_TEST(test_sleep);
+#ifdef PQ_USE_ARRAY_HEAP
+    RUN_TEST(test_sleep_error);
+#endif
+    RUN_TEST(test_sleep_destroyed);
+    RUN_TEST(test_message_channel);
+    RUN_TEST(test_message_channel_destroyed);
+    RUN_TEST(test_ring_channel);
+
+    return TEST_EXIT_STATUS();
+}
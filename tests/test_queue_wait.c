@@ -0,0 +1,174 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Blocking wait layer over the SPSC message queue and ring buffer. Built with
+ * MESSAGE_QUEUE_SPSC and RING_BUFFER_SPSC, see the Makefile. A producer and a
+ * consumer thread stream numbered messages and bytes through queues much
+ * smaller than the stream, so both sides keep blocking and waking up.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include "queue_wait.h"
+#include "test.h"
+
+#if !defined(MESSAGE_QUEUE_SPSC) || !defined(RING_BUFFER_SPSC)
+#error "build with -DMESSAGE_QUEUE_SPSC -DRING_BUFFER_SPSC"
+#endif
+
+#define MESSAGES 100000
+#define RING_BYTES 1000000
+
+struct message {
+    uint32_t sequence;
+    uint32_t check;
+};
+
+static DECLARE_MESSAGE_QUEUE_BUFFER(8, sizeof(struct message));
+static struct message_queue mq;
+static struct queue_waiter mq_waiter;
+
+static uint8_t ring_storage[64];
+static struct ring_buffer rb;
+static struct queue_waiter rb_waiter;
+
+static void *message_producer(void *arg)
+{
+    (void)arg;
+    for (uint32_t i = 0; i < MESSAGES; i++) {
+        struct message msg = { i, ~i };
+
+        while (message_queue_push_notify(&mq, &msg, &mq_waiter) != 0) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void test_message_queue_wait(void)
+{
+    pthread_t producer;
+    uint32_t bad = 0;
+
+    message_queue_init(&mq, buffer, sizeof(struct message), 8);
+    CHECK_EQ(queue_waiter_init(&mq_waiter, NULL, NULL, NULL), 0);
+    CHECK_EQ(pthread_create(&producer, NULL, message_producer, NULL), 0);
+
+    for (uint32_t i = 0; i < MESSAGES; i++) {
+        struct message msg;
+
+        CHECK_EQ(message_queue_pop_wait(&mq, &msg, &mq_waiter, 16), 0);
+        if (msg.sequence != i || msg.check != ~i) {
+            bad++;
+        }
+    }
+
+    pthread_join(producer, NULL);
+    CHECK_EQ(bad, 0);
+    CHECK(message_queue_front(&mq) == NULL);
+}
+
+static void *ring_producer(void *arg)
+{
+    uint8_t chunk[13];
+    uint32_t sent = 0;
+
+    (void)arg;
+    while (sent < RING_BYTES) {
+        uint32_t length = RING_BYTES - sent < sizeof(chunk) ? RING_BYTES - sent : sizeof(chunk);
+
+        for (uint32_t i = 0; i < length; i++) {
+            chunk[i] = (uint8_t)((sent + i) * 7);
+        }
+
+        int ret = ring_buffer_write_notify(&rb, chunk, length, &rb_waiter);
+        if (ret > 0) {
+            sent += (uint32_t)ret;
+        } else {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void test_ring_buffer_wait(void)
+{
+    pthread_t producer;
+    uint8_t chunk[29];
+    uint32_t received = 0;
+    uint32_t bad = 0;
+
+    ring_buffer_init(&rb, ring_storage, sizeof(ring_storage));
+    CHECK_EQ(queue_waiter_init(&rb_waiter, NULL, NULL, NULL), 0);
+    CHECK_EQ(pthread_create(&producer, NULL, ring_producer, NULL), 0);
+
+    while (received < RING_BYTES) {
+        int ret = ring_buffer_read_wait(&rb, chunk, sizeof(chunk), &rb_waiter, 16);
+
+        CHECK(ret > 0);
+        if (ret <= 0) {
+            break;
+        }
+
+        for (int i = 0; i < ret; i++) {
+            if (chunk[i] != (uint8_t)((received + i) * 7)) {
+                bad++;
+            }
+        }
+        received += (uint32_t)ret;
+    }
+
+    pthread_join(producer, NULL);
+    CHECK_EQ(received, RING_BYTES);
+    CHECK_EQ(bad, 0);
+}
+
+static void dummy_wait(void *ctx, atomic_uint *sequence, uint32_t expected)
+{
+    (void)ctx;
+    (void)sequence;
+    (void)expected;
+}
+
+static void test_waiter_hooks(void)
+{
+    struct queue_waiter w;
+
+    CHECK_EQ(queue_waiter_init(&w, dummy_wait, NULL, NULL), -EINVAL);
+    CHECK_EQ(queue_waiter_init(&w, NULL, NULL, NULL), 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_message_queue_wait);
+    RUN_TEST(test_ring_buffer_wait);
+    RUN_TEST(test_waiter_hooks);
+
+    return TEST_EXIT_STATUS();
+}
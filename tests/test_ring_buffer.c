@@ -0,0 +1,265 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Byte ring buffer: single-byte and bulk copies, the zero-copy reserve/commit
+ * and peek/release regions, and data that wraps the end of the storage. Only
+ * ring_buffer_capacity() depends on the index mode, so the Makefile also
+ * builds this test with RING_BUFFER_FREE_RUNNING.
+ */
+
+#include <string.h>
+
+#include "ring_buffer.h"
+#include "test.h"
+
+#define SIZE 64
+
+static uint8_t storage[SIZE];
+
+static void fill(uint8_t *data, uint32_t length, uint8_t first)
+{
+    for (uint32_t i = 0; i < length; i++) {
+        data[i] = (uint8_t)(first + i);
+    }
+}
+
+/* Move both indices to @offset so the next data starts there */
+static void advance(struct ring_buffer *rb, uint32_t offset)
+{
+    uint8_t scratch[SIZE];
+
+    CHECK_EQ(ring_buffer_copy_from_stream(rb, scratch, offset), offset);
+    CHECK_EQ(ring_buffer_copy_to_stream(rb, scratch, offset), offset);
+}
+
+static void test_push_pop(void)
+{
+    struct ring_buffer rb;
+    uint8_t byte = 0;
+
+    ring_buffer_init(&rb, storage, SIZE);
+    CHECK(ring_buffer_is_empty(&rb));
+    CHECK_EQ(ring_buffer_pop(&rb, &byte), -EAGAIN);
+
+    for (uint32_t i = 0; i < ring_buffer_capacity(&rb); i++) {
+        CHECK_EQ(ring_buffer_push(&rb, (uint8_t)i), 0);
+    }
+    CHECK(ring_buffer_is_full(&rb));
+    CHECK_EQ(ring_buffer_push(&rb, 0), -ENOBUFS);
+
+    /* Keep the buffer full across the wrap point */
+    for (uint32_t i = 0; i < 3 * SIZE; i++) {
+        CHECK_EQ(ring_buffer_pop(&rb, &byte), 0);
+        CHECK_EQ(byte, (uint8_t)i);
+        CHECK_EQ(ring_buffer_push(&rb, (uint8_t)(i + ring_buffer_capacity(&rb))), 0);
+    }
+    for (uint32_t i = 3 * SIZE; i < 3 * SIZE + ring_buffer_capacity(&rb); i++) {
+        CHECK_EQ(ring_buffer_pop(&rb, &byte), 0);
+        CHECK_EQ(byte, (uint8_t)i);
+    }
+    CHECK(ring_buffer_is_empty(&rb));
+}
+
+static void test_init_checked(void)
+{
+    struct ring_buffer rb;
+
+    CHECK_EQ(ring_buffer_init_checked(&rb, storage, SIZE + 10), ring_buffer_capacity(&rb));
+    CHECK_EQ(rb.size, SIZE);
+    CHECK_EQ(ring_buffer_init_checked(&rb, storage, 0), -EINVAL);
+    CHECK_EQ(ring_buffer_init_checked(&rb, storage, 0x80000000U), -EINVAL);
+#ifndef RING_BUFFER_FREE_RUNNING
+    /* One byte is kept free, so a single-byte buffer holds nothing */
+    CHECK_EQ(ring_buffer_init_checked(&rb, storage, 1), -EINVAL);
+#else
+    CHECK_EQ(ring_buffer_init_checked(&rb, storage, 1), 1);
+#endif
+}
+
+/* Bulk copies split at the end of the storage and keep the byte order */
+static void test_copy_wraps(void)
+{
+    struct ring_buffer rb;
+    uint8_t in[SIZE];
+    uint8_t out[SIZE];
+
+    ring_buffer_init(&rb, storage, SIZE);
+
+    for (uint32_t offset = 0; offset < SIZE; offset += 7) {
+        for (uint32_t length = 1; length <= ring_buffer_capacity(&rb); length += 5) {
+            advance(&rb, offset);
+            fill(in, length, (uint8_t)(offset + length));
+            memset(out, 0, sizeof(out));
+
+            CHECK_EQ(ring_buffer_copy_from_stream(&rb, in, length), length);
+            CHECK_EQ(ring_buffer_copy_to_stream(&rb, out, length), length);
+            CHECK(memcmp(in, out, length) == 0);
+            CHECK(ring_buffer_is_empty(&rb));
+        }
+    }
+}
+
+static void test_copy_limits(void)
+{
+    struct ring_buffer rb;
+    uint32_t capacity;
+    uint8_t in[SIZE];
+    uint8_t out[SIZE];
+
+    ring_buffer_init(&rb, storage, SIZE);
+    capacity = ring_buffer_capacity(&rb);
+    fill(in, SIZE, 0);
+
+    CHECK_EQ(ring_buffer_copy_from_stream(&rb, in, capacity + 1), -ENOBUFS);
+    CHECK(ring_buffer_is_empty(&rb));
+    CHECK_EQ(ring_buffer_copy_to_stream(&rb, out, 1), -EAGAIN);
+
+    /* The partial variants move what fits and report it */
+    CHECK_EQ(ring_buffer_copy_from_stream(&rb, in, 10), 10);
+    CHECK_EQ(ring_buffer_copy_from_stream_partial(&rb, in + 10, SIZE), capacity - 10);
+    CHECK_EQ(ring_buffer_copy_from_stream_partial(&rb, in, 1), 0);
+    CHECK_EQ(ring_buffer_copy_to_stream(&rb, out, capacity + 1), -EAGAIN);
+    CHECK_EQ(ring_buffer_copy_to_stream_partial(&rb, out, 5), 5);
+    CHECK_EQ(ring_buffer_copy_to_stream_partial(&rb, out + 5, SIZE), capacity - 5);
+    CHECK(memcmp(in, out, capacity) == 0);
+    CHECK_EQ(ring_buffer_copy_to_stream_partial(&rb, out, 1), 0);
+}
+
+static void test_reserve_commit(void)
+{
+    struct ring_buffer rb;
+    uint8_t *ptr = NULL;
+    uint8_t out[SIZE];
+
+    ring_buffer_init(&rb, storage, SIZE);
+    advance(&rb, SIZE - 8);
+
+    /* The region stops at the end of the storage */
+    CHECK_EQ(ring_buffer_write_reserve(&rb, &ptr, SIZE), 8);
+    CHECK(ptr == &storage[SIZE - 8]);
+    CHECK_EQ(ring_buffer_write_reserve(&rb, &ptr, 3), 3);
+
+    /* Nothing is visible until it is committed */
+    fill(ptr, 8, 100);
+    CHECK(ring_buffer_is_empty(&rb));
+    CHECK_EQ(ring_buffer_write_commit(&rb, 8), 0);
+
+    /* The next region starts over at the beginning */
+    CHECK_EQ(ring_buffer_write_reserve(&rb, &ptr, SIZE), ring_buffer_capacity(&rb) - 8);
+    CHECK(ptr == storage);
+    fill(ptr, 4, 108);
+    CHECK_EQ(ring_buffer_write_commit(&rb, 4), 0);
+    CHECK_EQ(ring_buffer_write_commit(&rb, ring_buffer_capacity(&rb)), -EINVAL);
+
+    CHECK_EQ(ring_buffer_copy_to_stream(&rb, out, 12), 12);
+    for (uint32_t i = 0; i < 12; i++) {
+        CHECK_EQ(out[i], 100 + i);
+    }
+
+    /* A full buffer offers no region */
+    while (ring_buffer_push(&rb, 0) == 0) {
+    }
+    CHECK_EQ(ring_buffer_write_reserve(&rb, &ptr, SIZE), 0);
+    CHECK_EQ(ring_buffer_write_commit(&rb, 1), -EINVAL);
+}
+
+static void test_peek_release(void)
+{
+    struct ring_buffer rb;
+    uint8_t *ptr = NULL;
+    uint8_t in[SIZE];
+
+    ring_buffer_init(&rb, storage, SIZE);
+    CHECK_EQ(ring_buffer_read_peek(&rb, &ptr), 0);
+    CHECK_EQ(ring_buffer_read_release(&rb, 1), -EINVAL);
+
+    advance(&rb, SIZE - 5);
+    fill(in, 20, 50);
+    CHECK_EQ(ring_buffer_copy_from_stream(&rb, in, 20), 20);
+
+    /* The first region ends at the wrap point, the rest follows from the start */
+    CHECK_EQ(ring_buffer_read_peek(&rb, &ptr), 5);
+    CHECK(ptr == &storage[SIZE - 5]);
+    CHECK(memcmp(ptr, in, 5) == 0);
+
+    /* Consume part of it; the remainder is offered again */
+    CHECK_EQ(ring_buffer_read_release(&rb, 2), 0);
+    CHECK_EQ(ring_buffer_read_peek(&rb, &ptr), 3);
+    CHECK(memcmp(ptr, in + 2, 3) == 0);
+    CHECK_EQ(ring_buffer_read_release(&rb, 3), 0);
+
+    CHECK_EQ(ring_buffer_read_peek(&rb, &ptr), 15);
+    CHECK(ptr == storage);
+    CHECK(memcmp(ptr, in + 5, 15) == 0);
+    CHECK_EQ(ring_buffer_read_release(&rb, 16), -EINVAL);
+    CHECK_EQ(ring_buffer_read_release(&rb, 15), 0);
+    CHECK(ring_buffer_is_empty(&rb));
+}
+
+#if defined(RING_BUFFER_FREE_RUNNING) && !defined(RING_BUFFER_SPSC)
+/* Every byte is usable, and the counters may overflow while data is buffered */
+static void test_free_running_counters(void)
+{
+    struct ring_buffer rb;
+    uint8_t in[SIZE];
+    uint8_t out[SIZE];
+    uint8_t *ptr = NULL;
+
+    ring_buffer_init(&rb, storage, SIZE);
+    CHECK_EQ(ring_buffer_capacity(&rb), SIZE);
+
+    rb.head = UINT32_MAX - 20;
+    rb.tail = UINT32_MAX - 20;
+    fill(in, SIZE, 1);
+
+    CHECK_EQ(ring_buffer_copy_from_stream(&rb, in, SIZE), SIZE);
+    CHECK(ring_buffer_is_full(&rb));
+    CHECK(rb.head < rb.tail);
+    CHECK_EQ(ring_buffer_write_reserve(&rb, &ptr, 1), 0);
+
+    /* The counters start 21 bytes before the end of the storage */
+    CHECK_EQ(ring_buffer_read_peek(&rb, &ptr), 21);
+    CHECK(memcmp(ptr, in, 21) == 0);
+    CHECK_EQ(ring_buffer_read_release(&rb, 21), 0);
+    CHECK_EQ(ring_buffer_copy_to_stream(&rb, out, SIZE - 21), SIZE - 21);
+    CHECK(memcmp(in + 21, out, SIZE - 21) == 0);
+    CHECK(ring_buffer_is_empty(&rb));
+}
+#endif
+
+int main(void)
+{
+    RUN_TEST(test_push_pop);
+    RUN_TEST(test_init_checked);
+    RUN_TEST(test_copy_wraps);
+    RUN_TEST(test_copy_limits);
+    RUN_TEST(test_reserve_commit);
+    RUN_TEST(test_peek_release);
+#if defined(RING_BUFFER_FREE_RUNNING) && !defined(RING_BUFFER_SPSC)
+    RUN_TEST(test_free_running_counters);
+#endif
+
+    return TEST_EXIT_STATUS();
+}
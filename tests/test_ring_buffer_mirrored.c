@@ -0,0 +1,169 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Mirrored ring buffer. Built with RING_BUFFER_MIRRORED, once more with
+ * RING_BUFFER_FREE_RUNNING, see the Makefile. The storage is mapped twice
+ * back to back, so copies and zero-copy regions never split at the wrap.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ring_buffer.h"
+#include "test.h"
+
+#ifndef RING_BUFFER_MIRRORED
+#error "build with -DRING_BUFFER_MIRRORED"
+#endif
+
+static void fill(uint8_t *data, uint32_t length, uint8_t first)
+{
+    for (uint32_t i = 0; i < length; i++) {
+        data[i] = (uint8_t)(first + i);
+    }
+}
+
+static void test_init(void)
+{
+    struct ring_buffer rb;
+    long page = sysconf(_SC_PAGESIZE);
+    int capacity;
+
+    /* Small requests get one page, others the next power of two */
+    capacity = ring_buffer_init_mirrored(&rb, 10);
+    CHECK(capacity > 0);
+    CHECK_EQ(rb.size, page);
+    CHECK_EQ(capacity, ring_buffer_capacity(&rb));
+    CHECK(rb.mirrored);
+    ring_buffer_deinit_mirrored(&rb);
+    CHECK(rb.buffer == NULL);
+
+    capacity = ring_buffer_init_mirrored(&rb, 3 * (uint32_t)page);
+    CHECK_EQ(rb.size, 4 * page);
+    CHECK_EQ(capacity, ring_buffer_capacity(&rb));
+    ring_buffer_deinit_mirrored(&rb);
+
+    CHECK_EQ(ring_buffer_init_mirrored(&rb, 0x80000000U), -EINVAL);
+
+    /* Releasing a buffer that was not mapped by the ring is a no-op */
+    static uint8_t storage[64];
+    ring_buffer_init(&rb, storage, sizeof(storage));
+    ring_buffer_deinit_mirrored(&rb);
+    CHECK(rb.buffer == storage);
+}
+
+/* The largest buffer's capacity still fits in the int return value */
+static void test_init_largest(void)
+{
+    struct ring_buffer rb;
+    int capacity = ring_buffer_init_mirrored(&rb, INT32_MAX);
+
+    /* The mapping is never touched, but the host may still refuse it */
+    if (capacity == -ENOMEM) {
+        return;
+    }
+
+    CHECK_EQ(rb.size, 0x80000000U);
+    CHECK_EQ(capacity, INT32_MAX);
+    ring_buffer_deinit_mirrored(&rb);
+}
+
+static void test_mirror_aliases(void)
+{
+    struct ring_buffer rb;
+
+    CHECK(ring_buffer_init_mirrored(&rb, 4096) > 0);
+
+    rb.buffer[5] = 0x5a;
+    CHECK_EQ(rb.buffer[rb.size + 5], 0x5a);
+    rb.buffer[rb.size + 9] = 0xa5;
+    CHECK_EQ(rb.buffer[9], 0xa5);
+
+    ring_buffer_deinit_mirrored(&rb);
+}
+
+static void test_regions_span_wrap(void)
+{
+    struct ring_buffer rb;
+    uint8_t *ptr = NULL;
+    uint8_t *in;
+    uint8_t *out;
+    uint32_t capacity;
+    uint32_t length;
+
+    CHECK(ring_buffer_init_mirrored(&rb, 4096) > 0);
+    capacity = ring_buffer_capacity(&rb);
+    in = malloc(rb.size);
+    out = malloc(rb.size);
+    CHECK(in && out);
+    if (!in || !out) {
+        free(in);
+        free(out);
+        ring_buffer_deinit_mirrored(&rb);
+        return;
+    }
+    fill(in, rb.size, 3);
+
+    /* Empty the buffer with both indices close to the end */
+    CHECK_EQ(ring_buffer_copy_from_stream(&rb, in, rb.size - 100), rb.size - 100);
+    CHECK_EQ(ring_buffer_copy_to_stream(&rb, out, rb.size - 100), rb.size - 100);
+
+    /* One reserve covers all the free space, past the end of the storage */
+    length = ring_buffer_write_reserve(&rb, &ptr, rb.size);
+    CHECK_EQ(length, capacity);
+    CHECK(ptr == &rb.buffer[rb.size - 100]);
+    memcpy(ptr, in, length);
+    CHECK_EQ(ring_buffer_write_commit(&rb, length), 0);
+
+    /* One peek covers all buffered data, and reads back what was written */
+    CHECK_EQ(ring_buffer_read_peek(&rb, &ptr), capacity);
+    CHECK(ptr == &rb.buffer[rb.size - 100]);
+    CHECK(memcmp(ptr, in, capacity) == 0);
+    CHECK_EQ(ring_buffer_read_release(&rb, 200), 0);
+
+    /* Bulk copies across the wrap take the same path */
+    CHECK_EQ(ring_buffer_copy_to_stream(&rb, out, capacity - 200), capacity - 200);
+    CHECK(memcmp(out, in + 200, capacity - 200) == 0);
+    CHECK_EQ(ring_buffer_copy_from_stream(&rb, in, 300), 300);
+    CHECK_EQ(ring_buffer_copy_to_stream(&rb, out, 300), 300);
+    CHECK(memcmp(out, in, 300) == 0);
+    CHECK(ring_buffer_is_empty(&rb));
+
+    free(in);
+    free(out);
+    ring_buffer_deinit_mirrored(&rb);
+}
+
+int main(void)
+{
+    RUN_TEST(test_init);
+    RUN_TEST(test_init_largest);
+    RUN_TEST(test_mirror_aliases);
+    RUN_TEST(test_regions_span_wrap);
+
+    return TEST_EXIT_STATUS();
+}
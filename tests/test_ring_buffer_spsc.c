@@ -0,0 +1,151 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Lock-free SPSC ring buffer. Built with RING_BUFFER_SPSC, see the Makefile.
+ * A producer and a consumer thread stream a numbered byte sequence through a
+ * small buffer, once with single-byte push/pop and once through the
+ * zero-copy regions, and the consumer checks every byte arrives in order.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "ring_buffer.h"
+#include "test.h"
+
+#ifndef RING_BUFFER_SPSC
+#error "build with -DRING_BUFFER_SPSC"
+#endif
+
+#define STREAM_BYTES 1000000
+
+static uint8_t storage[64];
+static struct ring_buffer rb;
+
+static uint8_t expected(uint32_t index)
+{
+    return (uint8_t)(index * 13 + (index >> 8));
+}
+
+static void *byte_producer(void *arg)
+{
+    (void)arg;
+    for (uint32_t i = 0; i < STREAM_BYTES; i++) {
+        while (ring_buffer_push(&rb, expected(i)) != 0) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void test_push_pop_stream(void)
+{
+    pthread_t producer;
+    uint32_t bad = 0;
+
+    ring_buffer_init(&rb, storage, sizeof(storage));
+    CHECK_EQ(pthread_create(&producer, NULL, byte_producer, NULL), 0);
+
+    for (uint32_t i = 0; i < STREAM_BYTES; i++) {
+        uint8_t byte;
+
+        while (ring_buffer_pop(&rb, &byte) != 0) {
+            sched_yield();
+        }
+        bad += byte != expected(i);
+    }
+
+    pthread_join(producer, NULL);
+    CHECK_EQ(bad, 0);
+    CHECK(ring_buffer_is_empty(&rb));
+}
+
+static void *region_producer(void *arg)
+{
+    uint32_t sent = 0;
+
+    (void)arg;
+    while (sent < STREAM_BYTES) {
+        uint8_t *ptr;
+        uint32_t want = STREAM_BYTES - sent < 23 ? STREAM_BYTES - sent : 23;
+        uint32_t length = ring_buffer_write_reserve(&rb, &ptr, want);
+
+        if (!length) {
+            sched_yield();
+            continue;
+        }
+
+        for (uint32_t i = 0; i < length; i++) {
+            ptr[i] = expected(sent + i);
+        }
+        ring_buffer_write_commit(&rb, length);
+        sent += length;
+    }
+
+    return NULL;
+}
+
+static void test_region_stream(void)
+{
+    pthread_t producer;
+    uint32_t received = 0;
+    uint32_t bad = 0;
+
+    ring_buffer_init(&rb, storage, sizeof(storage));
+    CHECK_EQ(pthread_create(&producer, NULL, region_producer, NULL), 0);
+
+    while (received < STREAM_BYTES) {
+        uint8_t *ptr;
+        uint32_t length = ring_buffer_read_peek(&rb, &ptr);
+
+        if (!length) {
+            sched_yield();
+            continue;
+        }
+
+        /* Release less than was offered now and then */
+        if (length > 1 && received % 3 == 0) {
+            length /= 2;
+        }
+        for (uint32_t i = 0; i < length; i++) {
+            bad += ptr[i] != expected(received + i);
+        }
+        CHECK_EQ(ring_buffer_read_release(&rb, length), 0);
+        received += length;
+    }
+
+    pthread_join(producer, NULL);
+    CHECK_EQ(received, STREAM_BYTES);
+    CHECK_EQ(bad, 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_push_pop_stream);
+    RUN_TEST(test_region_stream);
+
+    return TEST_EXIT_STATUS();
+}
@@ -0,0 +1,161 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Shared-memory message queue in a single process: round trips, batches that
+ * wrap, reattaching to a queue holding messages, and a peer that corrupts the
+ * header after the handle was bound.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "shm_message_queue.h"
+#include "test.h"
+
+static char path[64];
+
+static void make_path(void)
+{
+    snprintf(path, sizeof(path), "/tmp/test_shm_message_queue.%ld", (long)getpid());
+    unlink(path);
+}
+
+static void test_round_trip(void)
+{
+    struct shm_message_queue producer;
+    struct shm_message_queue consumer;
+    uint32_t value;
+
+    make_path();
+    CHECK_EQ(shm_message_queue_create(&producer, path, sizeof(value), 4), 0);
+    CHECK_EQ(shm_message_queue_create(&consumer, path, sizeof(value), 4), -EEXIST);
+    CHECK_EQ(shm_message_queue_attach(&consumer, path), 0);
+
+    for (value = 0; value < 4; value++) {
+        CHECK_EQ(shm_message_queue_push(&producer, &value), 0);
+    }
+    CHECK_EQ(shm_message_queue_push(&producer, &value), -ENOBUFS);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        CHECK_EQ(shm_message_queue_pop(&consumer, &value), 0);
+        CHECK_EQ(value, i);
+    }
+    CHECK_EQ(shm_message_queue_pop(&consumer, &value), -EAGAIN);
+
+    shm_message_queue_detach(&consumer);
+    shm_message_queue_detach(&producer);
+    unlink(path);
+}
+
+static void test_batch_wrap(void)
+{
+    struct shm_message_queue q;
+    uint8_t in[6] = {1, 2, 3, 4, 5, 6};
+    uint8_t out[8];
+
+    make_path();
+    CHECK_EQ(shm_message_queue_create(&q, path, 1, 8), 0);
+
+    CHECK_EQ(shm_message_queue_push_n(&q, in, 6), 6);
+    CHECK_EQ(shm_message_queue_pop_n(&q, out, 6), 6);
+    CHECK_EQ(shm_message_queue_push_n(&q, in, 6), 6);
+    CHECK_EQ(shm_message_queue_push_n(&q, in, 6), 2);
+    CHECK_EQ(shm_message_queue_pop_n(&q, out, sizeof(out)), 8);
+    CHECK(memcmp(out, in, 6) == 0);
+    CHECK(memcmp(out + 6, in, 2) == 0);
+
+    shm_message_queue_detach(&q);
+    unlink(path);
+}
+
+static void test_reattach(void)
+{
+    struct shm_message_queue q;
+    uint32_t value = 42;
+
+    make_path();
+    CHECK_EQ(shm_message_queue_create(&q, path, sizeof(value), 4), 0);
+    CHECK_EQ(shm_message_queue_push(&q, &value), 0);
+    shm_message_queue_detach(&q);
+
+    value = 0;
+    CHECK_EQ(shm_message_queue_attach(&q, path), 0);
+    CHECK_EQ(shm_message_queue_pop(&q, &value), 0);
+    CHECK_EQ(value, 42);
+
+    /* A header that no longer matches the file is refused */
+    q.header->slot_count = 1U << 20;
+    shm_message_queue_detach(&q);
+    CHECK_EQ(shm_message_queue_attach(&q, path), -EBADMSG);
+    unlink(path);
+}
+
+static void test_corrupt_peer(void)
+{
+    struct shm_message_queue q;
+    uint32_t value = 7;
+    uint32_t batch[4];
+
+    make_path();
+    CHECK_EQ(shm_message_queue_create(&q, path, sizeof(value), 4), 0);
+    CHECK_EQ(shm_message_queue_push(&q, &value), 0);
+
+    /* Geometry rewritten after binding is ignored */
+    q.header->slot_count = 1U << 20;
+    q.header->stride = 1U << 20;
+    q.header->slot_size = 1U << 20;
+    CHECK_EQ(shm_message_queue_push(&q, &value), 0);
+    CHECK_EQ(shm_message_queue_pop_n(&q, batch, 4), 2);
+    CHECK_EQ(batch[0], 7);
+    CHECK_EQ(batch[1], 7);
+
+    /* Indices moved further apart than the queue holds are refused */
+    atomic_store(&q.header->head, 2 + 100);
+    CHECK_EQ(shm_message_queue_pop(&q, &value), -EBADMSG);
+    CHECK_EQ(shm_message_queue_pop_n(&q, batch, 4), -EBADMSG);
+    CHECK_EQ(shm_message_queue_release(&q), -EBADMSG);
+    CHECK(shm_message_queue_front(&q) == NULL);
+
+    /* The producer reloads the tail once its cached copy runs out */
+    atomic_store(&q.header->head, 2);
+    atomic_store(&q.header->tail, 2 + 100);
+    CHECK_EQ(shm_message_queue_push_n(&q, batch, 4), -EBADMSG);
+    CHECK_EQ(shm_message_queue_push(&q, &value), -EBADMSG);
+    CHECK_EQ(shm_message_queue_publish(&q), -EBADMSG);
+    CHECK(shm_message_queue_claim(&q) == NULL);
+
+    shm_message_queue_detach(&q);
+    unlink(path);
+}
+
+int main(void)
+{
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_batch_wrap);
+    RUN_TEST(test_reattach);
+    RUN_TEST(test_corrupt_peer);
+
+    return TEST_EXIT_STATUS();
+}
@@ -0,0 +1,106 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Statistics counters of the SPSC ring buffer and message queue. Built with
+ * RING_BUFFER_SPSC, RING_BUFFER_STATS, MESSAGE_QUEUE_SPSC and
+ * MESSAGE_QUEUE_STATS, see the Makefile. The producer's cached copy of the
+ * tail trails the consumer, which must not inflate the high-water mark.
+ */
+
+#include "message_queue_core.h"
+#include "ring_buffer.h"
+#include "test.h"
+
+#if !defined(RING_BUFFER_SPSC) || !defined(RING_BUFFER_STATS) || !defined(MESSAGE_QUEUE_SPSC) || \
+    !defined(MESSAGE_QUEUE_STATS)
+#error "build with -DRING_BUFFER_SPSC -DRING_BUFFER_STATS -DMESSAGE_QUEUE_SPSC -DMESSAGE_QUEUE_STATS"
+#endif
+
+static void test_ring_buffer_stats(void)
+{
+    static uint8_t storage[16];
+    struct ring_buffer rb;
+    struct queue_stats stats;
+    uint8_t byte = 0;
+
+    ring_buffer_init(&rb, storage, sizeof(storage));
+    CHECK_EQ(ring_buffer_pop(&rb, &byte), -EAGAIN);
+
+    /* Fill to three, drain, then refill to three: the mark stays at three */
+    for (int round = 0; round < 4; round++) {
+        for (uint8_t i = 0; i < 3; i++) {
+            CHECK_EQ(ring_buffer_push(&rb, i), 0);
+        }
+        for (uint8_t i = 0; i < 3; i++) {
+            CHECK_EQ(ring_buffer_pop(&rb, &byte), 0);
+            CHECK_EQ(byte, i);
+        }
+    }
+
+    ring_buffer_get_stats(&rb, &stats);
+    CHECK_EQ(stats.high_water, 3);
+    CHECK_EQ(stats.full, 0);
+    CHECK_EQ(stats.empty, 1);
+
+    while (ring_buffer_push(&rb, 0xaa) == 0) {
+    }
+    ring_buffer_get_stats(&rb, &stats);
+    CHECK_EQ(stats.high_water, ring_buffer_capacity(&rb));
+    CHECK_EQ(stats.full, 1);
+}
+
+static void test_message_queue_stats(void)
+{
+    static DECLARE_MESSAGE_QUEUE_BUFFER(8, sizeof(uint32_t));
+    struct message_queue mq;
+    struct queue_stats stats;
+    uint32_t value;
+
+    message_queue_init(&mq, buffer, sizeof(uint32_t), 8);
+    CHECK_EQ(message_queue_pop(&mq, &value), -EAGAIN);
+
+    for (uint32_t round = 0; round < 4; round++) {
+        for (uint32_t i = 0; i < 2; i++) {
+            CHECK_EQ(message_queue_push(&mq, &i), 0);
+        }
+        for (uint32_t i = 0; i < 2; i++) {
+            CHECK_EQ(message_queue_pop(&mq, &value), 0);
+            CHECK_EQ(value, i);
+        }
+    }
+
+    message_queue_get_stats(&mq, &stats);
+    CHECK_EQ(stats.high_water, 2);
+    CHECK_EQ(stats.full, 0);
+    CHECK_EQ(stats.empty, 1);
+}
+
+int main(void)
+{
+    RUN_TEST(test_ring_buffer_stats);
+    RUN_TEST(test_message_queue_stats);
+
+    return TEST_EXIT_STATUS();
+}
@@ -0,0 +1,448 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "timer.h"
+#include "test.h"
+
+static int fired[4];
+
+static void count_callback(struct timer *timer, void *data)
+{
+    (void)timer;
+    fired[(long)data]++;
+}
+
+static void ticks(int count)
+{
+    while (count-- > 0) {
+        timer_increment_tick();
+    }
+}
+
+static void reset(void)
+{
+    for (int i = 0; i < 4; i++) {
+        fired[i] = 0;
+    }
+    timer_module_init();
+}
+
+static void test_start_stop_restart(void)
+{
+    struct timer a, b, c;
+
+    reset();
+    timer_init(&a, count_callback, (void *)0);
+    timer_init(&b, count_callback, (void *)1);
+    timer_init(&c, count_callback, (void *)2);
+
+    timer_start(&a, 100, false);
+    timer_start(&b, 50, true);
+    timer_start(&c, 10, false);
+    timer_stop(&c);
+
+    ticks(30);
+    timer_restart(&a, 5);
+    ticks(170);
+    timer_stop(&b);
+    ticks(100);
+
+    CHECK_EQ(fired[0], 1);
+    CHECK_EQ(fired[1], 4);
+    CHECK_EQ(fired[2], 0);
+}
+
+/* A one-shot timer is popped when it fires and must be restartable */
+static void test_pop_then_restart(void)
+{
+    struct timer a, b, c;
+
+    reset();
+    timer_init(&a, count_callback, (void *)0);
+    timer_init(&b, count_callback, (void *)1);
+    timer_init(&c, count_callback, (void *)2);
+
+    timer_start(&a, 1, false);
+    timer_start(&b, 2, false);
+    timer_start(&c, 3, false);
+    ticks(1);
+    CHECK_EQ(fired[0], 1);
+
+    /* Restart the popped timer, stop it again, then restart it for real */
+    timer_restart(&a, 5);
+    timer_stop(&a);
+    timer_stop(&a);
+    timer_restart(&a, 4);
+    ticks(2);
+    CHECK_EQ(fired[0], 1);
+    CHECK_EQ(fired[1], 1);
+    CHECK_EQ(fired[2], 1);
+
+    timer_restart(&b, 1);
+    ticks(3);
+    CHECK_EQ(fired[0], 2);
+    CHECK_EQ(fired[1], 2);
+    CHECK_EQ(fired[2], 1);
+
+    ticks(10);
+    CHECK_EQ(fired[0], 2);
+    CHECK_EQ(fired[1], 2);
+    CHECK_EQ(fired[2], 1);
+}
+
+static struct timer self;
+
+/* Restart the timer that is firing from within its own callback */
+static void restart_callback(struct timer *timer, void *data)
+{
+    (void)data;
+    if (++fired[3] < 3) {
+        timer_restart(timer, 2);
+    }
+}
+
+static void test_restart_from_callback(void)
+{
+    reset();
+    timer_init(&self, restart_callback, NULL);
+    timer_start(&self, 1, false);
+
+    ticks(10);
+    CHECK_EQ(fired[3], 3);
+    CHECK_EQ(timer_next_expiry(), TIMER_NO_EXPIRY);
+}
+
+/* A timer armed on one base must be stopped before moving to another */
+static void test_start_remote(void)
+{
+    struct timer_base local, remote;
+    struct timer a;
+
+    reset();
+    timer_base_init(&local);
+    timer_base_init(&remote);
+    timer_init(&a, count_callback, (void *)0);
+
+    timer_start_on(&local, &a, 5, false);
+    CHECK_EQ(timer_start_remote(&remote, &a, 2, false), -EBUSY);
+
+    timer_stop(&a);
+    CHECK_EQ(timer_start_remote(&remote, &a, 2, false), 0);
+    CHECK_EQ(timer_start_remote(&remote, &a, 2, false), -EBUSY);
+
+    for (int i = 0; i < 10; i++) {
+        timer_increment_tick_on(&local);
+    }
+    CHECK_EQ(fired[0], 0);
+
+    for (int i = 0; i < 3; i++) {
+        timer_increment_tick_on(&remote);
+    }
+    CHECK_EQ(fired[0], 1);
+
+    /* Once fired, the one-shot timer can be handed over again */
+    CHECK_EQ(timer_start_remote(&local, &a, 1, false), 0);
+    timer_increment_tick_on(&local);
+    timer_increment_tick_on(&local);
+    CHECK_EQ(fired[0], 2);
+
+    timer_base_deinit(&local);
+    timer_base_deinit(&remote);
+}
+
+static void tick_base(struct timer_base *base, int count)
+{
+    while (count-- > 0) {
+        timer_increment_tick_on(base);
+    }
+}
+
+/* Stopping a timer still waiting in the inbox withdraws the handoff */
+static void test_remote_stop_before_merge(void)
+{
+    struct timer_base remote;
+    struct timer a;
+
+    reset();
+    timer_base_init(&remote);
+    timer_init(&a, count_callback, (void *)0);
+
+    CHECK_EQ(timer_start_remote(&remote, &a, 2, false), 0);
+    timer_stop(&a);
+
+    /* Still linked in the inbox until the owner merges it */
+    CHECK_EQ(timer_start_remote(&remote, &a, 2, false), -EBUSY);
+
+    tick_base(&remote, 5);
+    CHECK_EQ(fired[0], 0);
+    CHECK_EQ(timer_next_expiry_on(&remote), TIMER_NO_EXPIRY);
+
+    CHECK_EQ(timer_start_remote(&remote, &a, 1, false), 0);
+    tick_base(&remote, 2);
+    CHECK_EQ(fired[0], 1);
+
+    timer_base_deinit(&remote);
+}
+
+/* Restarting a timer before the merge wins over the handoff */
+static void test_remote_restart_before_merge(void)
+{
+    struct timer_base local, remote;
+    struct timer a, b;
+
+    reset();
+    timer_base_init(&local);
+    timer_base_init(&remote);
+    timer_init(&a, count_callback, (void *)0);
+    timer_init(&b, count_callback, (void *)1);
+
+    /* Moved to another base: must not be armed on the inbox base too */
+    CHECK_EQ(timer_start_remote(&remote, &a, 10, false), 0);
+    timer_start_on(&local, &a, 2, false);
+
+    /* Restarted on the inbox base itself: armed once, at the new expiry */
+    CHECK_EQ(timer_start_remote(&remote, &b, 10, false), 0);
+    timer_restart(&b, 3);
+
+    tick_base(&remote, 2);
+    CHECK_EQ(fired[1], 0);
+    tick_base(&remote, 1);
+    CHECK_EQ(fired[1], 1);
+    tick_base(&remote, 20);
+    CHECK_EQ(fired[0], 0);
+    CHECK_EQ(fired[1], 1);
+    CHECK_EQ(timer_next_expiry_on(&remote), TIMER_NO_EXPIRY);
+
+    tick_base(&local, 2);
+    CHECK_EQ(fired[0], 1);
+    CHECK_EQ(timer_next_expiry_on(&local), TIMER_NO_EXPIRY);
+
+    timer_base_deinit(&local);
+    timer_base_deinit(&remote);
+}
+
+/* Deinitializing a base stops the timers it still holds */
+static void test_base_deinit(void)
+{
+    struct timer_base base;
+    struct timer near, exact, far, handed;
+
+    reset();
+    timer_base_init(&base);
+    timer_init(&near, count_callback, (void *)0);
+    timer_init(&exact, count_callback, (void *)1);
+    timer_init(&far, count_callback, (void *)2);
+    timer_init(&handed, count_callback, (void *)3);
+    timer_set_flags(&exact, TIMER_FLAG_EXACT);
+
+    timer_start_on(&base, &near, 5, true);
+    timer_start_on(&base, &exact, 5, false);
+    timer_start_on(&base, &far, UINT64_MAX / 2, false);
+    CHECK_EQ(timer_start_remote(&base, &handed, 5, false), 0);
+    timer_base_deinit(&base);
+
+    CHECK(!near.armed);
+    CHECK(!exact.armed);
+    CHECK(!far.armed);
+    CHECK(!handed.armed);
+    CHECK_EQ(handed.remote, TIMER_REMOTE_NONE);
+
+    /* The base can be used again */
+    timer_base_init(&base);
+    tick_base(&base, 10);
+    CHECK_EQ(timer_start_on(&base, &near, 1, false), 0);
+    tick_base(&base, 1);
+    CHECK_EQ(fired[0], 1);
+    CHECK_EQ(fired[1] + fired[2] + fired[3], 0);
+    timer_base_deinit(&base);
+}
+
+#ifdef PQ_USE_ARRAY_HEAP
+/* A start that cannot queue the timer reports it and leaves it stopped */
+static void test_start_full(void)
+{
+    PQ_SLOT storage[2];
+    struct timer_base base, remote;
+    struct timer timers[3];
+
+    reset();
+    CHECK_EQ(timer_base_init_storage(&base, storage, 2), 0);
+    timer_base_init(&remote);
+    for (long i = 0; i < 3; i++) {
+        timer_init(&timers[i], count_callback, (void *)i);
+        timer_set_flags(&timers[i], TIMER_FLAG_EXACT);
+    }
+
+    CHECK_EQ(timer_start_on(&base, &timers[0], 1, false), 0);
+    CHECK_EQ(timer_start_on(&base, &timers[1], 2, false), 0);
+    CHECK_EQ(timer_start_on(&base, &timers[2], 3, false), -ENOBUFS);
+    CHECK_EQ(timer_restart(&timers[2], 3), -ENOBUFS);
+
+    /* Not armed, so it can still be handed over elsewhere */
+    CHECK_EQ(timer_start_remote(&remote, &timers[2], 1, false), 0);
+    timer_increment_tick_on(&remote);
+    timer_increment_tick_on(&remote);
+    CHECK_EQ(fired[2], 1);
+
+    /* Moving an armed timer within a full heap needs no room */
+    CHECK_EQ(timer_restart(&timers[1], 5), 0);
+    for (int i = 0; i < 5; i++) {
+        timer_increment_tick_on(&base);
+    }
+    CHECK_EQ(fired[0], 1);
+    CHECK_EQ(fired[1], 1);
+
+    timer_base_deinit(&base);
+    timer_base_deinit(&remote);
+}
+#endif
+
+#define SLACK_TIMERS 16
+
+static uint64_t slack_now;
+static uint64_t slack_fired_at[SLACK_TIMERS][4];
+static uint32_t slack_fired[SLACK_TIMERS];
+
+static void slack_callback(struct timer *timer, void *data)
+{
+    long i = (long)data;
+
+    (void)timer;
+    if (slack_fired[i] < 4) {
+        slack_fired_at[i][slack_fired[i]] = slack_now;
+    }
+    slack_fired[i]++;
+}
+
+static void slack_ticks(struct timer_base *base, uint64_t count)
+{
+    while (count--) {
+        slack_now++;
+        timer_increment_tick_on(base);
+    }
+}
+
+/* Each timer fires inside its window, and overlapping windows share a tick */
+static void test_slack_coalescing(void)
+{
+    struct timer_base base;
+    struct timer timers[SLACK_TIMERS];
+    uint64_t distinct[SLACK_TIMERS];
+    uint32_t distinct_count = 0;
+
+    timer_base_init(&base);
+    slack_now = 0;
+    for (long i = 0; i < SLACK_TIMERS; i++) {
+        slack_fired[i] = 0;
+        timer_init(&timers[i], slack_callback, (void *)i);
+    }
+
+    /* Deadlines 100..115 with 32 ticks of slack all overlap at tick 128 */
+    slack_ticks(&base, 3);
+    for (long i = 0; i < SLACK_TIMERS; i++) {
+        CHECK_EQ(timer_start_slack_on(&base, &timers[i], 97 + (uint64_t)i, 32, false), 0);
+    }
+    slack_ticks(&base, 200);
+
+    for (long i = 0; i < SLACK_TIMERS; i++) {
+        uint64_t at = slack_fired_at[i][0];
+        uint32_t j = 0;
+
+        CHECK_EQ(slack_fired[i], 1);
+        CHECK(at >= 100 + (uint64_t)i && at <= 132 + (uint64_t)i);
+        while (j < distinct_count && distinct[j] != at) {
+            j++;
+        }
+        if (j == distinct_count) {
+            distinct[distinct_count++] = at;
+        }
+    }
+    CHECK_EQ(distinct_count, 1);
+
+    /* Without slack each timer keeps its own tick */
+    for (long i = 0; i < SLACK_TIMERS; i++) {
+        slack_fired[i] = 0;
+        CHECK_EQ(timer_start_slack_on(&base, &timers[i], 10 + (uint64_t)i, 0, false), 0);
+    }
+    slack_ticks(&base, 50);
+    for (long i = 0; i < SLACK_TIMERS; i++) {
+        CHECK_EQ(slack_fired[i], 1);
+        CHECK_EQ(slack_fired_at[i][0], 203 + 10 + (uint64_t)i);
+    }
+
+    timer_base_deinit(&base);
+}
+
+/* Slack never lets a periodic timer drift beyond one window per period */
+static void test_slack_periodic(void)
+{
+    struct timer_base base;
+    struct timer timer;
+
+    timer_base_init(&base);
+    slack_now = 0;
+    slack_fired[0] = 0;
+    timer_init(&timer, slack_callback, (void *)0);
+
+    CHECK_EQ(timer_start_slack_on(&base, &timer, 50, 10, true), 0);
+    slack_ticks(&base, 210);
+    timer_stop(&timer);
+
+    CHECK_EQ(slack_fired[0], 4);
+    for (uint32_t n = 0; n < 4; n++) {
+        uint64_t due = 50 * (n + 1);
+
+        CHECK(slack_fired_at[0][n] >= due && slack_fired_at[0][n] <= due + 10);
+    }
+
+    /* A restart keeps the slack */
+    slack_fired[0] = 0;
+    CHECK_EQ(timer_restart(&timer, 25), 0);
+    slack_ticks(&base, 40);
+    CHECK(slack_fired[0] >= 1);
+    CHECK(slack_fired_at[0][0] >= 235 && slack_fired_at[0][0] <= 245);
+    timer_stop(&timer);
+
+    timer_base_deinit(&base);
+}
+
+int main(void)
+{
+    RUN_TEST(test_start_stop_restart);
+    RUN_TEST(test_pop_then_restart);
+    RUN_TEST(test_restart_from_callback);
+    RUN_TEST(test_start_remote);
+    RUN_TEST(test_remote_stop_before_merge);
+    RUN_TEST(test_remote_restart_before_merge);
+    RUN_TEST(test_base_deinit);
+    RUN_TEST(test_slack_coalescing);
+    RUN_TEST(test_slack_periodic);
+#ifdef PQ_USE_ARRAY_HEAP
+    RUN_TEST(test_start_full);
+#endif
+
+    timer_module_deinit();
+
+    return TEST_EXIT_STATUS();
+}
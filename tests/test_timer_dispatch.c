@@ -0,0 +1,167 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Felipe Neves
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Expired timers handed to worker threads. Built with TIMER_USE_DISPATCH, see
+ * the Makefile. Checks that a callback never runs on two workers at once and
+ * that a one-shot timer can re-arm itself through timer_start_remote().
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "timer.h"
+#include "test.h"
+
+#ifndef TIMER_USE_DISPATCH
+#error "build with -DTIMER_USE_DISPATCH"
+#endif
+
+#define WORKERS 3
+#define TIMERS 8
+#define TICKS 2000
+#define ONESHOT_RUNS 200
+
+static struct timer_base base;
+static struct timer_dispatch dispatch;
+static struct timer_worker workers[WORKERS];
+static struct timer timers[TIMERS];
+static struct timer oneshot;
+
+static atomic_int running[TIMERS];
+static int runs[TIMERS];
+static atomic_int overlaps;
+static atomic_int oneshot_runs;
+static atomic_int errors;
+static atomic_bool stop;
+
+static void periodic_callback(struct timer *timer, void *data)
+{
+    long i = (long)data;
+
+    (void)timer;
+    if (atomic_fetch_add(&running[i], 1) != 0) {
+        atomic_fetch_add(&overlaps, 1);
+    }
+
+    /* Not atomic: only safe if callbacks of one timer never overlap */
+    runs[i]++;
+    sched_yield();
+
+    atomic_fetch_sub(&running[i], 1);
+}
+
+static void oneshot_callback(struct timer *timer, void *data)
+{
+    (void)data;
+    if (atomic_fetch_add(&oneshot_runs, 1) + 1 < ONESHOT_RUNS) {
+        if (timer_start_remote(&base, timer, 1, false) != 0) {
+            atomic_fetch_add(&errors, 1);
+        }
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+
+    while (!atomic_load(&stop)) {
+        if (!timer_dispatch_run(&dispatch, id)) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static bool dispatch_idle(void)
+{
+    for (int i = 0; i < TIMERS; i++) {
+        if (atomic_load_explicit(&timers[i].dispatch, memory_order_acquire) != TIMER_DISPATCH_IDLE) {
+            return false;
+        }
+    }
+
+    return atomic_load_explicit(&oneshot.dispatch, memory_order_acquire) == TIMER_DISPATCH_IDLE;
+}
+
+static void test_dispatch(void)
+{
+    pthread_t threads[WORKERS];
+
+    timer_base_init(&base);
+    CHECK_EQ(timer_dispatch_init(&dispatch, workers, WORKERS), 0);
+    timer_base_set_dispatch(&base, &dispatch);
+
+    for (long i = 0; i < TIMERS; i++) {
+        timer_init(&timers[i], periodic_callback, (void *)i);
+        timer_start_on(&base, &timers[i], 1 + i % 3, true);
+    }
+    timer_init(&oneshot, oneshot_callback, NULL);
+    timer_start_on(&base, &oneshot, 1, false);
+
+    for (uintptr_t i = 0; i < WORKERS; i++) {
+        CHECK_EQ(pthread_create(&threads[i], NULL, worker_main, (void *)i), 0);
+    }
+
+    for (int tick = 0; tick < TICKS; tick++) {
+        timer_increment_tick_on(&base);
+        sched_yield();
+    }
+
+    for (int i = 0; i < TIMERS; i++) {
+        timer_stop(&timers[i]);
+    }
+
+    /* Keep ticking until the one-shot chain is done and the workers are idle */
+    for (long spin = 0; spin < 10000000; spin++) {
+        if (atomic_load(&oneshot_runs) >= ONESHOT_RUNS && dispatch_idle()) {
+            break;
+        }
+        timer_increment_tick_on(&base);
+        sched_yield();
+    }
+
+    atomic_store(&stop, true);
+    for (int i = 0; i < WORKERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    timer_base_deinit(&base);
+    CHECK(dispatch_idle());
+    CHECK_EQ(atomic_load(&overlaps), 0);
+    CHECK_EQ(atomic_load(&errors), 0);
+    CHECK_EQ(atomic_load(&oneshot_runs), ONESHOT_RUNS);
+    for (int i = 0; i < TIMERS; i++) {
+        CHECK(runs[i] > 0);
+        CHECK(runs[i] <= TICKS);
+    }
+}
+
+int main(void)
+{
+    RUN_TEST(test_dispatch);
+
+    return TEST_EXIT_STATUS();
+}
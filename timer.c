@@ -22,44 +22,503 @@
  * SOFTWARE.
  */
 
-#include "timer_module.h"
+#include "timer.h"
+#include <errno.h>
 #include "container_of.h"
 
-static struct priority_queue timer_queue;
-static uint64_t global_ticks;
+static struct timer_base default_base;
 
+/* The earliest expiry has the highest priority */
 static int timer_compare(struct heap_node *a, struct heap_node *b)
 {
     struct timer *timer_a = CONTAINER_OF(a, struct timer, node);
     struct timer *timer_b = CONTAINER_OF(b, struct timer, node);
-    return (timer_a->expiry > timer_b->expiry) - (timer_a->expiry < timer_b->expiry);
+    return (timer_a->expiry < timer_b->expiry) - (timer_a->expiry > timer_b->expiry);
+}
+
+/* Copy the expiry into the heap key before (re)queueing the timer */
+static inline void timer_set_key(struct timer *timer)
+{
+#ifdef PQ_INLINE_KEY
+    timer->node.key = timer->expiry;
+#else
+    (void)timer;
+#endif
+}
+
+/*
+ * Pick the tick in [@earliest, @earliest + @slack] with the most trailing
+ * zero bits. Timers whose windows overlap tend to land on the same tick,
+ * so they expire together instead of one per tick.
+ */
+static inline uint64_t timer_slack_expiry(uint64_t earliest, uint32_t slack)
+{
+    uint64_t latest = earliest + slack;
+
+    if (!slack || latest < earliest) {
+        return earliest;
+    }
+
+    /* Bits above the highest differing bit are shared by the whole window */
+    uint64_t low_mask = (1ULL << (63 - __builtin_clzll(earliest ^ latest))) - 1;
+
+    if (!(earliest & ((low_mask << 1) | 1))) {
+        return earliest;
+    }
+
+    return latest & ~low_mask;
+}
+
+/* Account for an expiration due at tick @due, processed at @base->ticks */
+static inline void timer_stat_fire(struct timer_base *base, uint64_t due)
+{
+#ifdef TIMER_STATS
+    uint64_t lag = base->ticks > due ? base->ticks - due : 0;
+
+    stat_inc(&base->fired);
+    if (lag) {
+        stat_inc(&base->late);
+        stat_add(&base->lag_total, (uintptr_t)lag);
+        stat_max(&base->lag_max, (uintptr_t)lag);
+    }
+#else
+    (void)base;
+    (void)due;
+#endif
+}
+
+/* Invoke the callback on the ticking thread, timing it if a clock is set */
+static inline void timer_run_callback(struct timer_base *base, struct timer *timer)
+{
+#if defined(TIMER_STATS) && defined(TIMER_STATS_CLOCK)
+    uintptr_t start = (uintptr_t)TIMER_STATS_CLOCK();
+
+    timer->callback(timer, timer->data);
+
+    uintptr_t duration = (uintptr_t)TIMER_STATS_CLOCK() - start;
+
+    stat_add(&base->callback_total, duration);
+    stat_max(&base->callback_max, duration);
+#else
+    (void)base;
+    timer->callback(timer, timer->data);
+#endif
+}
+
+/* Run the callback of an expired timer due at @due, or queue it to a worker */
+static inline void timer_fire(struct timer_base *base, struct timer *timer, uint64_t due)
+{
+    timer_stat_fire(base, due);
+
+#ifdef TIMER_USE_DISPATCH
+    struct timer_dispatch *dispatch = base->dispatch;
+
+    if (dispatch) {
+        unsigned int state = atomic_load_explicit(&timer->dispatch, memory_order_acquire);
+
+        /* Still queued or running: have the worker run the callback again */
+        while (state != TIMER_DISPATCH_IDLE) {
+            if (state == TIMER_DISPATCH_AGAIN ||
+                atomic_compare_exchange_weak_explicit(&timer->dispatch, &state, TIMER_DISPATCH_AGAIN,
+                                                      memory_order_release, memory_order_acquire)) {
+                return;
+            }
+        }
+
+        atomic_store_explicit(&timer->dispatch, TIMER_DISPATCH_BUSY, memory_order_relaxed);
+
+        for (uint32_t i = 0; i < dispatch->count; i++) {
+            struct timer_worker *worker = &dispatch->workers[dispatch->next];
+
+            if (++dispatch->next == dispatch->count) {
+                dispatch->next = 0;
+            }
+
+            if (mpmc_message_queue_push(&worker->queue, &timer) == 0) {
+                return;
+            }
+        }
+
+        atomic_store_explicit(&timer->dispatch, TIMER_DISPATCH_IDLE, memory_order_relaxed);
+    }
+#endif
+
+    timer_run_callback(base, timer);
+}
+
+#ifdef TIMER_USE_WHEEL
+
+/*
+ * Link a timer on the wheel level whose span covers its distance from @now,
+ * the earliest tick whose slot has not been processed yet. Return false if the
+ * expiry lies beyond the range of the wheel.
+ */
+static bool timer_wheel_add(struct timer_base *base, struct timer *timer, uint64_t now)
+{
+    uint64_t expiry = timer->expiry > now ? timer->expiry : now;
+    uint64_t delta = expiry - now;
+
+    for (unsigned int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        unsigned int shift = level * TIMER_WHEEL_BITS;
+
+        if (delta < (1ULL << (shift + TIMER_WHEEL_BITS))) {
+            struct list_head *slot = &base->wheel[level][(expiry >> shift) & TIMER_WHEEL_MASK];
+
+            list_append(slot, &timer->entry);
+            timer->slot = slot;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void timer_wheel_del(struct timer *timer)
+{
+    if (timer->slot) {
+        list_remove_from(timer->slot, &timer->entry);
+        timer->slot = NULL;
+    }
+}
+
+/* Move the slot of @level that is due at tick @now down the wheel */
+static void timer_wheel_cascade(struct timer_base *base, unsigned int level, uint64_t now)
+{
+    struct list_head *slot = &base->wheel[level][(now >> (level * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK];
+    struct list_node *entry, *tmp;
+    struct list_head pending = *slot;
+
+    list_init(slot);
+
+    list_for_each_safe(&pending, entry, tmp) {
+        struct timer *timer = CONTAINER_OF(entry, struct timer, entry);
+        timer_wheel_add(base, timer, now);
+    }
+}
+
+/* Fire every wheel timer due at tick @now, return true if the heap changed */
+static bool timer_wheel_run(struct timer_base *base, uint64_t now)
+{
+    bool reinserted = false;
+
+    for (unsigned int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        if ((now >> ((level - 1) * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK) {
+            break;
+        }
+        timer_wheel_cascade(base, level, now);
+    }
+
+    /*
+     * Detach the due slot first: callbacks may rearm timers onto it for the
+     * next revolution, or stop timers that are still pending here.
+     */
+    struct list_head *slot = &base->wheel[0][now & TIMER_WHEEL_MASK];
+    struct list_node *entry;
+
+    base->expired = *slot;
+    list_init(slot);
+
+    for (entry = base->expired.head; entry; entry = entry->next) {
+        CONTAINER_OF(entry, struct timer, entry)->slot = &base->expired;
+    }
+
+    while ((entry = list_peek_head(&base->expired))) {
+        struct timer *timer = CONTAINER_OF(entry, struct timer, entry);
+
+        uint64_t due = timer->expiry;
+
+        timer_wheel_del(timer);
+
+        if (timer->period) {
+            timer->deadline += timer->period;
+            timer->expiry = timer_slack_expiry(timer->deadline, timer->slack);
+            if (!timer_wheel_add(base, timer, now + 1)) {
+                timer_set_key(timer);
+                /* A timer that cannot be queued again is left stopped */
+                timer->armed = pq_insert(&base->queue, &timer->node) == 0;
+                reinserted = true;
+            }
+        } else {
+            timer->armed = false;
+        }
+
+        timer_fire(base, timer, due);
+    }
+
+    return reinserted;
+}
+
+#endif /* TIMER_USE_WHEEL */
+
+void timer_base_init(struct timer_base *base)
+{
+    pq_init(&base->queue, timer_compare);
+    base->ticks = 0;
+    atomic_init(&base->inbox, NULL);
+
+#ifdef TIMER_USE_WHEEL
+    for (unsigned int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (unsigned int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            list_init(&base->wheel[level][slot]);
+        }
+    }
+    list_init(&base->expired);
+#endif
+#ifdef TIMER_USE_DISPATCH
+    base->dispatch = NULL;
+#endif
+#ifdef TIMER_STATS
+    stat_init(&base->fired);
+    stat_init(&base->late);
+    stat_init(&base->lag_max);
+    stat_init(&base->lag_total);
+    stat_init(&base->callback_max);
+    stat_init(&base->callback_total);
+#endif
+}
+
+#ifdef PQ_USE_ARRAY_HEAP
+int timer_base_init_storage(struct timer_base *base, PQ_SLOT *storage, uint32_t capacity)
+{
+    if (!storage || !capacity) {
+        return -EINVAL;
+    }
+
+    timer_base_init(base);
+    return pq_init_storage(&base->queue, timer_compare, storage, capacity);
+}
+#endif
+
+void timer_base_deinit(struct timer_base *base)
+{
+    struct timer *timer = atomic_exchange_explicit(&base->inbox, NULL, memory_order_acquire);
+    struct heap_node *node;
+
+    while (timer) {
+        struct timer *next = timer->remote_next;
+
+        timer->remote_next = NULL;
+        timer->remote = TIMER_REMOTE_NONE;
+        timer->armed = false;
+        timer = next;
+    }
+
+#ifdef TIMER_USE_WHEEL
+    for (unsigned int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (unsigned int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            struct list_node *entry;
+
+            while ((entry = list_peek_head(&base->wheel[level][slot]))) {
+                timer = CONTAINER_OF(entry, struct timer, entry);
+                timer_wheel_del(timer);
+                timer->armed = false;
+            }
+        }
+    }
+#endif
+
+    while ((node = pq_pop(&base->queue))) {
+        CONTAINER_OF(node, struct timer, node)->armed = false;
+    }
+
+    pq_deinit(&base->queue);
 }
 
 void timer_module_init(void)
 {
-    pq_init(&timer_queue, timer_compare);
-    global_ticks = 0;
+    /* Release the heap of a previous initialization, if any */
+    timer_base_deinit(&default_base);
+    timer_base_init(&default_base);
+}
+
+void timer_module_deinit(void)
+{
+    timer_base_deinit(&default_base);
 }
 
 void timer_init(struct timer *timer, void (*callback)(struct timer *timer, void *data), void *data)
 {
+    timer->node = (struct heap_node){ 0 };
+#ifdef TIMER_USE_WHEEL
+    timer->entry = (struct list_node){ 0 };
+    timer->slot = NULL;
+#endif
+    timer->base = NULL;
+    timer->remote_next = NULL;
+    timer->flags = 0;
+    timer->slack = 0;
+    timer->armed = false;
+    timer->remote = TIMER_REMOTE_NONE;
+#ifdef TIMER_USE_DISPATCH
+    atomic_init(&timer->dispatch, TIMER_DISPATCH_IDLE);
+#endif
     timer->callback = callback;
     timer->data = data;
     timer->expiry = 0;
+    timer->deadline = 0;
     timer->period = 0;
 }
 
-void timer_start(struct timer *timer, uint64_t ticks, bool periodic)
+void timer_set_flags(struct timer *timer, uint32_t flags)
+{
+    timer->flags = flags;
+}
+
+/* Queue @timer on @base at its expiry, leaving it stopped on failure */
+static int timer_arm(struct timer_base *base, struct timer *timer)
+{
+    int ret = 0;
+
+    timer->armed = true;
+
+#ifdef TIMER_USE_WHEEL
+    timer_wheel_del(timer);
+
+    if (!(timer->flags & TIMER_FLAG_EXACT) && timer_wheel_add(base, timer, base->ticks + 1)) {
+        pq_remove(&base->queue, &timer->node);
+        return 0;
+    }
+#endif
+
+    timer_set_key(timer);
+    if (pq_update_key(&base->queue, &timer->node) < 0) {
+        ret = pq_insert(&base->queue, &timer->node);
+        if (ret < 0) {
+            timer->armed = false;
+            return ret;
+        }
+        pq_reorder(&base->queue);
+    }
+
+    return ret;
+}
+
+/* The owner stopped or restarted a timer still waiting in the inbox */
+static inline void timer_cancel_remote(struct timer *timer)
+{
+    if (timer->remote == TIMER_REMOTE_PENDING) {
+        timer->remote = TIMER_REMOTE_CANCELLED;
+    }
+}
+
+/* Arm the timers handed over by other threads since the last merge */
+static void timer_merge_remote(struct timer_base *base)
+{
+    if (!atomic_load_explicit(&base->inbox, memory_order_relaxed)) {
+        return;
+    }
+
+    struct timer *timer = atomic_exchange_explicit(&base->inbox, NULL, memory_order_acquire);
+
+    while (timer) {
+        struct timer *next = timer->remote_next;
+
+        bool pending = timer->remote == TIMER_REMOTE_PENDING && timer->base == base;
+
+        timer->remote_next = NULL;
+        timer->remote = TIMER_REMOTE_NONE;
+
+        /* Nobody to report a failure to: the timer is then left stopped */
+        if (pending) {
+            timer->expiry += base->ticks;
+            timer->deadline = timer->expiry;
+            (void)timer_arm(base, timer);
+        }
+        timer = next;
+    }
+}
+
+int timer_start_on(struct timer_base *base, struct timer *timer, uint64_t ticks, bool periodic)
+{
+    if (timer->base && timer->base != base) {
+        timer_stop(timer);
+    }
+
+    timer_cancel_remote(timer);
+    timer->base = base;
+    timer->slack = 0;
+    timer->deadline = base->ticks + ticks;
+    timer->expiry = timer->deadline;
+    timer->period = periodic ? ticks : 0;
+    return timer_arm(base, timer);
+}
+
+int timer_start(struct timer *timer, uint64_t ticks, bool periodic)
+{
+    return timer_start_on(&default_base, timer, ticks, periodic);
+}
+
+int timer_start_slack_on(struct timer_base *base, struct timer *timer, uint64_t ticks, uint32_t slack,
+                         bool periodic)
 {
-    timer->expiry = global_ticks + ticks;
+    if (timer->base && timer->base != base) {
+        timer_stop(timer);
+    }
+
+    timer_cancel_remote(timer);
+    timer->base = base;
+    timer->slack = slack;
+    timer->deadline = base->ticks + ticks;
+    timer->expiry = timer_slack_expiry(timer->deadline, slack);
     timer->period = periodic ? ticks : 0;
-    pq_insert(&timer_queue, &timer->node);
-    pq_reorder(&timer_queue);
+    return timer_arm(base, timer);
+}
+
+int timer_start_slack(struct timer *timer, uint64_t ticks, uint32_t slack, bool periodic)
+{
+    return timer_start_slack_on(&default_base, timer, ticks, slack, periodic);
+}
+
+int timer_start_remote(struct timer_base *base, struct timer *timer, uint64_t ticks, bool periodic)
+{
+    if (timer->armed || timer->remote != TIMER_REMOTE_NONE) {
+        return -EBUSY;
+    }
+
+    /* The expiry holds the relative delay until the owner merges the timer */
+    timer->armed = true;
+    timer->remote = TIMER_REMOTE_PENDING;
+    timer->base = base;
+    timer->slack = 0;
+    timer->expiry = ticks;
+    timer->period = periodic ? ticks : 0;
+
+    struct timer *head = atomic_load_explicit(&base->inbox, memory_order_relaxed);
+    do {
+        timer->remote_next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&base->inbox, &head, timer,
+                                                    memory_order_release, memory_order_relaxed));
+
+    return 0;
+}
+
+int timer_restart(struct timer *timer, uint64_t ticks)
+{
+    struct timer_base *base = timer->base ? timer->base : &default_base;
+
+    timer_cancel_remote(timer);
+    timer->base = base;
+    timer->deadline = base->ticks + ticks;
+    timer->expiry = timer_slack_expiry(timer->deadline, timer->slack);
+    return timer_arm(base, timer);
 }
 
 void timer_stop(struct timer *timer)
 {
-    pq_remove(&timer_queue, &timer->node);
+    if (!timer->base) {
+        return;
+    }
+
+    timer->armed = false;
+    timer_cancel_remote(timer);
+
+#ifdef TIMER_USE_WHEEL
+    if (timer->slot) {
+        timer_wheel_del(timer);
+        return;
+    }
+#endif
+    pq_remove(&timer->base->queue, &timer->node);
 }
 
 void timer_set_period(struct timer *timer, uint64_t ticks)
@@ -67,28 +526,220 @@ void timer_set_period(struct timer *timer, uint64_t ticks)
     timer->period = ticks;
 }
 
-void timer_increment_tick(void)
+/* Fire every timer due at tick @now, return true if the heap needs a reorder */
+static bool timer_expire(struct timer_base *base, uint64_t now)
 {
-    global_ticks++;
-
     bool expired = false;
+
+#ifdef TIMER_USE_WHEEL
+    expired = timer_wheel_run(base, now);
+#endif
+
     struct timer *next_timer = NULL;
-    struct heap_node *node = pq_peek(&timer_queue);
+    struct heap_node *node = pq_peek(&base->queue);
 
-    while (node && (next_timer = CONTAINER_OF(node, struct timer, node))->expiry <= global_ticks) {
-        pq_pop(&timer_queue);
-        next_timer->callback(next_timer, next_timer->data);
+    while (node && (next_timer = CONTAINER_OF(node, struct timer, node))->expiry <= now) {
+        uint64_t due = next_timer->expiry;
 
+        pq_pop(&base->queue);
+
+        /* Re-arm first so the callback may stop or restart its own timer */
         if (next_timer->period) {
-            next_timer->expiry += next_timer->period;
-            pq_insert(&timer_queue, &next_timer->node);
+            next_timer->deadline += next_timer->period;
+            next_timer->expiry = timer_slack_expiry(next_timer->deadline, next_timer->slack);
+            timer_set_key(next_timer);
+            /* A timer that cannot be queued again is left stopped */
+            next_timer->armed = pq_insert(&base->queue, &next_timer->node) == 0;
 	    expired = true;
+        } else {
+            next_timer->armed = false;
         }
 
-        node = pq_peek(&timer_queue);
+        timer_fire(base, next_timer, due);
+        node = pq_peek(&base->queue);
+    }
+
+    return expired;
+}
+
+/* Earliest tick after @now at which a timer may fire, UINT64_MAX if none */
+static uint64_t timer_next_event(struct timer_base *base, uint64_t now)
+{
+    uint64_t next = UINT64_MAX;
+    struct heap_node *node = pq_peek(&base->queue);
+
+    if (node) {
+        uint64_t expiry = CONTAINER_OF(node, struct timer, node)->expiry;
+        next = expiry > now ? expiry : now + 1;
+    }
+
+#ifdef TIMER_USE_WHEEL
+    /*
+     * A level-0 slot holds timers due exactly at its tick. Timers on higher
+     * levels are only known to expire no earlier than the cascade of their
+     * slot, so that tick is reported instead, at worst an early wakeup.
+     */
+    for (unsigned int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        unsigned int shift = level * TIMER_WHEEL_BITS;
+        uint64_t index = now >> shift;
+
+        if (((index + 1) << shift) >= next) {
+            break;
+        }
+
+        for (uint64_t k = 1; k <= TIMER_WHEEL_SLOTS; k++) {
+            uint64_t tick = (index + k) << shift;
+
+            if (tick >= next) {
+                break;
+            }
+
+            if (!list_is_empty(&base->wheel[level][(index + k) & TIMER_WHEEL_MASK])) {
+                next = tick;
+                break;
+            }
+        }
+    }
+#endif
+
+    return next;
+}
+
+void timer_increment_tick_on(struct timer_base *base)
+{
+    timer_merge_remote(base);
+
+    base->ticks++;
+
+    if (timer_expire(base, base->ticks))
+    	pq_reorder(&base->queue);
+}
+
+void timer_increment_tick(void)
+{
+    timer_increment_tick_on(&default_base);
+}
+
+void timer_advance_on(struct timer_base *base, uint64_t ticks)
+{
+    timer_merge_remote(base);
+
+    uint64_t target = base->ticks + ticks;
+    bool expired = false;
+    uint64_t next;
+
+    while ((next = timer_next_event(base, base->ticks)) <= target) {
+        base->ticks = next;
+        expired |= timer_expire(base, next);
+    }
+
+    base->ticks = target;
+
+    if (expired)
+        pq_reorder(&base->queue);
+}
+
+void timer_advance(uint64_t ticks)
+{
+    timer_advance_on(&default_base, ticks);
+}
+
+uint64_t timer_next_expiry_on(struct timer_base *base)
+{
+    timer_merge_remote(base);
+
+    uint64_t next = timer_next_event(base, base->ticks);
+
+    return next == UINT64_MAX ? TIMER_NO_EXPIRY : next - base->ticks;
+}
+
+uint64_t timer_next_expiry(void)
+{
+    return timer_next_expiry_on(&default_base);
+}
+
+#ifdef TIMER_STATS
+void timer_get_stats_on(struct timer_base *base, struct timer_stats *stats)
+{
+    stats->fired = stat_read(&base->fired);
+    stats->late = stat_read(&base->late);
+    stats->lag_max = stat_read(&base->lag_max);
+    stats->lag_total = stat_read(&base->lag_total);
+    stats->callback_max = stat_read(&base->callback_max);
+    stats->callback_total = stat_read(&base->callback_total);
+}
+
+void timer_get_stats(struct timer_stats *stats)
+{
+    timer_get_stats_on(&default_base, stats);
+}
+#endif
+
+#ifdef TIMER_USE_DISPATCH
+
+int timer_dispatch_init(struct timer_dispatch *dispatch, struct timer_worker *workers, uint32_t count)
+{
+    if (!dispatch || !workers || !count) {
+        return -EINVAL;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        int ret = mpmc_message_queue_init(&workers[i].queue, workers[i].buffer, sizeof(struct timer *),
+                                          TIMER_DISPATCH_DEPTH);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    dispatch->workers = workers;
+    dispatch->count = count;
+    dispatch->next = 0;
+
+    return 0;
+}
+
+void timer_base_set_dispatch(struct timer_base *base, struct timer_dispatch *dispatch)
+{
+    base->dispatch = dispatch;
+}
+
+/* Run a dispatched callback, again for every expiration coalesced meanwhile */
+static void timer_dispatch_callback(struct timer *timer)
+{
+    unsigned int state;
+
+    do {
+        timer->callback(timer, timer->data);
+
+        state = TIMER_DISPATCH_BUSY;
+        if (atomic_compare_exchange_strong_explicit(&timer->dispatch, &state, TIMER_DISPATCH_IDLE,
+                                                    memory_order_release, memory_order_acquire)) {
+            return;
+        }
+
+        /* Only the ticking thread moves BUSY to AGAIN, and only the worker back */
+        atomic_store_explicit(&timer->dispatch, TIMER_DISPATCH_BUSY, memory_order_relaxed);
+    } while (1);
+}
+
+bool timer_dispatch_run(struct timer_dispatch *dispatch, uint32_t worker)
+{
+    /* Own queue first, then the others in turn */
+    for (uint32_t i = 0; i < dispatch->count; i++) {
+        uint32_t victim = worker + i;
+        struct timer *timer;
+
+        if (victim >= dispatch->count) {
+            victim -= dispatch->count;
+        }
+
+        if (mpmc_message_queue_pop(&dispatch->workers[victim].queue, &timer) == 0) {
+            timer_dispatch_callback(timer);
+            return true;
+        }
     }
 
-    if(expired)
-    	pq_reorder(&timer_queue);
+    return false;
 }
 
+#endif /* TIMER_USE_DISPATCH */
@@ -27,29 +27,263 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "atomic_compat.h"
 #include "priority_queue.h"
+#include "linked_list.h"
+
+/*
+ * Define TIMER_USE_WHEEL to schedule timers on a hierarchical timing wheel
+ * of TIMER_WHEEL_LEVELS levels with 2^TIMER_WHEEL_BITS slots each, giving
+ * O(1) start/stop and amortized O(1) tick processing. Timers flagged with
+ * TIMER_FLAG_EXACT, and timers due beyond the range of the wheel, are kept
+ * on the priority queue.
+ */
+#ifdef TIMER_USE_WHEEL
+
+#ifndef TIMER_WHEEL_BITS
+#define TIMER_WHEEL_BITS 8
+#endif
+
+#ifndef TIMER_WHEEL_LEVELS
+#define TIMER_WHEEL_LEVELS 4
+#endif
+
+#if (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS) >= 64
+#error "The timer wheel must cover less than 2^64 ticks"
+#endif
+
+#define TIMER_WHEEL_SLOTS (1U << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+#endif /* TIMER_USE_WHEEL */
+
+/*
+ * Define TIMER_USE_DISPATCH to let a timer base hand expired timers to worker
+ * threads instead of running their callbacks on the ticking thread. Each
+ * worker has an MPMC queue of TIMER_DISPATCH_DEPTH entries that the ticking
+ * thread fills round-robin; the worker takes from its own queue and idle
+ * workers take from the queues of busy ones, so one slow callback no longer
+ * delays the others. Periodic timers are still re-armed on the base by the
+ * ticking thread.
+ */
+#ifdef TIMER_USE_DISPATCH
+
+#include "mpmc_message_queue.h"
+
+#ifndef TIMER_DISPATCH_DEPTH
+#define TIMER_DISPATCH_DEPTH 64
+#endif
+
+#if (TIMER_DISPATCH_DEPTH & (TIMER_DISPATCH_DEPTH - 1)) || TIMER_DISPATCH_DEPTH < 2
+#error "TIMER_DISPATCH_DEPTH must be a power of two of at least 2"
+#endif
+
+/**
+ * struct timer_worker - Per-worker queue of expired timers
+ * @queue: Queue of timer pointers, pushed by the ticking thread and popped
+ *         by the worker or by idle workers stealing from it
+ * @buffer: Storage of @queue
+ */
+struct timer_worker {
+    struct mpmc_message_queue queue;
+    DECLARE_MPMC_MESSAGE_QUEUE_BUFFER(TIMER_DISPATCH_DEPTH, sizeof(void *));
+};
+
+/**
+ * struct timer_dispatch - Set of workers running expired timer callbacks
+ * @workers: Array of @count workers
+ * @count: Number of workers
+ * @next: Worker the next expired timer is pushed to
+ */
+struct timer_dispatch {
+    struct timer_worker *workers;
+    uint32_t count;
+    uint32_t next;
+};
+
+#endif /* TIMER_USE_DISPATCH */
+
+/*
+ * Define TIMER_STATS to count, per timer base, how many timers fired, how
+ * many fired after their due tick and by how many ticks. Define
+ * TIMER_STATS_CLOCK() as well, to an expression reading a free-running
+ * counter such as a cycle counter, to also measure the callbacks run on the
+ * ticking thread. Callbacks handed to dispatch workers are not timed.
+ */
+#ifdef TIMER_STATS
+
+#include "stats.h"
+
+/**
+ * struct timer_stats - Snapshot of the statistics of a timer base
+ * @fired: Number of timer expirations processed
+ * @late: Number of expirations processed after their due tick
+ * @lag_max: Largest delay in ticks between due tick and expiration
+ * @lag_total: Sum of the delays in ticks, for averaging over @fired
+ * @callback_max: Longest callback in TIMER_STATS_CLOCK() units
+ * @callback_total: Sum of the callback durations in TIMER_STATS_CLOCK() units
+ */
+struct timer_stats {
+    uintptr_t fired;
+    uintptr_t late;
+    uintptr_t lag_max;
+    uintptr_t lag_total;
+    uintptr_t callback_max;
+    uintptr_t callback_total;
+};
+
+#endif /* TIMER_STATS */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Returned by timer_next_expiry() when no timer is armed */
+#define TIMER_NO_EXPIRY UINT64_MAX
+
+/* Keep the timer on the priority queue even when the wheel is enabled */
+#define TIMER_FLAG_EXACT (1U << 0)
+
+/* Values of timer::remote: not handed over, waiting in an inbox, withdrawn */
+#define TIMER_REMOTE_NONE 0U
+#define TIMER_REMOTE_PENDING 1U
+#define TIMER_REMOTE_CANCELLED 2U
+
+#ifdef TIMER_USE_DISPATCH
+/* Values of timer::dispatch: not queued, queued or running, run once more */
+#define TIMER_DISPATCH_IDLE 0U
+#define TIMER_DISPATCH_BUSY 1U
+#define TIMER_DISPATCH_AGAIN 2U
+#endif
+
+struct timer_base;
 
 /**
  * struct timer - Timer structure for managing expiration and callbacks
  * @node: Priority queue node for scheduling
+ * @entry: Wheel slot list node (TIMER_USE_WHEEL only)
+ * @slot: Wheel slot the timer is linked on, NULL if none (TIMER_USE_WHEEL only)
+ * @base: Timer base the timer was last started on
+ * @remote_next: Next timer in the handoff list of @base
  * @expiry: Tick count when the timer expires
+ * @deadline: Earliest tick the timer may expire, @expiry before the slack
+ *            delays it; periodic timers are re-armed from here so the slack
+ *            does not accumulate
  * @period: Period of the timer in ticks (0 for non-periodic)
+ * @flags: TIMER_FLAG_* scheduling flags
+ * @slack: Ticks the expiry may be delayed to coalesce it with other timers
+ * @armed: True while the timer is queued on @base or handed over to it
+ * @remote: TIMER_REMOTE_* state of the handoff to @base; a timer stopped or
+ *          restarted by the owner before the merge stays in the inbox until
+ *          then, withdrawn
+ * @dispatch: TIMER_DISPATCH_* state of the callback (TIMER_USE_DISPATCH only)
  * @callback: Function to call when the timer expires
  * @data: User-defined data passed to the callback
+ *
+ * A timer belongs to the thread owning the base it was last started on, and
+ * only that thread may restart or stop it. A timer that was never started
+ * belongs to whoever initialized it.
  */
 struct timer {
     struct heap_node node;
+#ifdef TIMER_USE_WHEEL
+    struct list_node entry;
+    struct list_head *slot;
+#endif
+    struct timer_base *base;
+    struct timer *remote_next;
+    uint32_t flags;
+    uint32_t slack;
+    bool armed;
+    uint8_t remote;
+#ifdef TIMER_USE_DISPATCH
+    atomic_uint dispatch;
+#endif
     uint64_t expiry;
+    uint64_t deadline;
     uint64_t period;
     void (*callback)(struct timer *timer, void *data);
     void *data;
 };
 
+/**
+ * struct timer_base - Independent set of timers driven by one tick source
+ * @queue: Priority queue of armed timers
+ * @ticks: Tick counter of this base
+ * @inbox: Timers handed over by other threads, merged on the next tick
+ * @wheel: Timing wheel slots (TIMER_USE_WHEEL only)
+ * @expired: Wheel timers being fired by the current tick (TIMER_USE_WHEEL only)
+ * @dispatch: Workers running the expired callbacks, NULL to run them on the
+ *            ticking thread (TIMER_USE_DISPATCH only)
+ * @fired, @late, @lag_max, @lag_total, @callback_max, @callback_total:
+ *            Counters described in struct timer_stats (TIMER_STATS only)
+ *
+ * Each base is owned by a single thread, typically one per core; only
+ * timer_start_remote() may be called on it from elsewhere.
+ */
+struct timer_base {
+    struct priority_queue queue;
+    uint64_t ticks;
+    _Atomic(struct timer *) inbox;
+#ifdef TIMER_USE_WHEEL
+    struct list_head wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    struct list_head expired;
+#endif
+#ifdef TIMER_USE_DISPATCH
+    struct timer_dispatch *dispatch;
+#endif
+#ifdef TIMER_STATS
+    struct stat_counter fired;
+    struct stat_counter late;
+    struct stat_counter lag_max;
+    struct stat_counter lag_total;
+    struct stat_counter callback_max;
+    struct stat_counter callback_total;
+#endif
+};
+
 /**
  * timer_module_init - Initialize the global timer module
  */
 void timer_module_init(void);
 
+/**
+ * timer_module_deinit - Release the resources of the global timer module
+ *
+ * Timers still armed on the global base are stopped.
+ */
+void timer_module_deinit(void);
+
+/**
+ * timer_base_init - Initialize a timer base
+ * @base: Pointer to the timer base
+ */
+void timer_base_init(struct timer_base *base);
+
+/**
+ * timer_base_deinit - Release the resources held by a timer base
+ * @base: Timer base owned by the calling thread
+ *
+ * Timers still armed on @base, or waiting in its inbox, are stopped; they
+ * must not be freed before this call. The base may be initialized again.
+ */
+void timer_base_deinit(struct timer_base *base);
+
+#ifdef PQ_USE_ARRAY_HEAP
+/**
+ * timer_base_init_storage - Initialize a timer base over a fixed heap array
+ * @base: Pointer to the timer base
+ * @storage: Array of PQ_SLOT holding the armed heap timers, never reallocated
+ * @capacity: Number of entries in @storage
+ *
+ * Starting a timer on a full base fails with -ENOBUFS instead of growing the
+ * heap from the system allocator.
+ *
+ * Return: 0 on success, -EINVAL on invalid parameters
+ */
+int timer_base_init_storage(struct timer_base *base, PQ_SLOT *storage, uint32_t capacity);
+#endif
+
 /**
  * timer_init - Initialize a timer
  * @timer: Pointer to the timer structure
@@ -63,12 +297,104 @@ void timer_init(struct timer *timer, void (*callback)(struct timer *timer, void
  * @timer: Pointer to the timer structure
  * @ticks: Number of ticks before the timer expires
  * @periodic: Whether the timer should repeat periodically
+ *
+ * A periodic timer that cannot be queued again after it fires is left
+ * stopped as well.
+ *
+ * Return: 0 on success, or the error of pq_insert() (-ENOMEM, or -ENOBUFS on
+ * fixed storage) if the timer could not be queued; it is then left stopped
  */
-void timer_start(struct timer *timer, uint64_t ticks, bool periodic);
+int timer_start(struct timer *timer, uint64_t ticks, bool periodic);
+
+/**
+ * timer_start_on - Start or restart a timer on a given timer base
+ * @base: Timer base owned by the calling thread
+ * @timer: Pointer to the timer structure
+ * @ticks: Number of ticks before the timer expires
+ * @periodic: Whether the timer should repeat periodically
+ *
+ * Return: 0 on success, or a negative errno value as for timer_start()
+ */
+int timer_start_on(struct timer_base *base, struct timer *timer, uint64_t ticks, bool periodic);
+
+/**
+ * timer_start_slack - Start or restart a timer that may fire a little late
+ * @timer: Pointer to the timer structure
+ * @ticks: Minimum number of ticks before the timer expires
+ * @slack: Extra ticks the expiry may be delayed by
+ * @periodic: Whether the timer should repeat periodically
+ *
+ * The expiry is placed on the tick within [now + @ticks, now + @ticks +
+ * @slack] that is the multiple of the largest power of two, so timers with
+ * overlapping windows share expiry ticks and fire in one batch. The slack
+ * also applies when a periodic timer is re-armed and to timer_restart(),
+ * until the timer is started again with timer_start(). Each period is
+ * counted from the start of the previous window, so the delays do not add
+ * up.
+ *
+ * Return: 0 on success, or a negative errno value as for timer_start()
+ */
+int timer_start_slack(struct timer *timer, uint64_t ticks, uint32_t slack, bool periodic);
+
+/**
+ * timer_start_slack_on - Start or restart a timer with slack on a given timer base
+ * @base: Timer base owned by the calling thread
+ * @timer: Pointer to the timer structure
+ * @ticks: Minimum number of ticks before the timer expires
+ * @slack: Extra ticks the expiry may be delayed by
+ * @periodic: Whether the timer should repeat periodically
+ *
+ * Return: 0 on success, or a negative errno value as for timer_start()
+ */
+int timer_start_slack_on(struct timer_base *base, struct timer *timer, uint64_t ticks, uint32_t slack,
+                         bool periodic);
+
+/**
+ * timer_start_remote - Start a timer on a timer base owned by another thread
+ * @base: Target timer base
+ * @timer: Pointer to the timer structure
+ * @ticks: Number of ticks before the timer expires
+ * @periodic: Whether the timer should repeat periodically
+ *
+ * The timer is pushed lock-free onto the handoff list of @base and armed by
+ * the owner on its next tick, @ticks after that tick. The caller must own
+ * @timer and it must not be armed: stop it first on the base it runs on.
+ * Ownership passes to the thread owning @base, so the caller must not touch
+ * the timer again. If the owner cannot queue the timer when it merges it,
+ * the timer is left stopped.
+ *
+ * Stopping or restarting the timer on its base before the owner merges it
+ * withdraws the handoff.
+ *
+ * Return: 0 on success, -EBUSY if @timer is armed or still being handed over
+ */
+int timer_start_remote(struct timer_base *base, struct timer *timer, uint64_t ticks, bool periodic);
+
+/**
+ * timer_set_flags - Set the scheduling flags of a stopped timer
+ * @timer: Pointer to the timer structure
+ * @flags: TIMER_FLAG_* flags, taking effect on the next start
+ */
+void timer_set_flags(struct timer *timer, uint32_t flags);
+
+/**
+ * timer_restart - Move the expiry of a timer in place
+ * @timer: Pointer to the timer structure
+ * @ticks: Number of ticks from now before the timer expires
+ *
+ * The period and slack are left untouched. An armed timer is repositioned
+ * in the queue in O(log n) instead of being removed and reinserted; a
+ * stopped timer is armed again.
+ *
+ * Return: 0 on success, or a negative errno value as for timer_start()
+ */
+int timer_restart(struct timer *timer, uint64_t ticks);
 
 /**
  * timer_stop - Stop a timer
  * @timer: Pointer to the timer structure
+ *
+ * Must be called from the thread owning the timer's base.
  */
 void timer_stop(struct timer *timer);
 
@@ -84,5 +410,110 @@ void timer_set_period(struct timer *timer, uint64_t ticks);
  */
 void timer_increment_tick(void);
 
+/**
+ * timer_increment_tick_on - Increment the tick counter of a timer base
+ * @base: Timer base owned by the calling thread
+ */
+void timer_increment_tick_on(struct timer_base *base);
+
+/**
+ * timer_advance - Move the global tick counter forward by several ticks
+ * @ticks: Number of ticks elapsed since the last tick was processed
+ *
+ * Fires every timer due within the elapsed ticks in expiry order, with the
+ * tick counter set to each timer's tick while its callback runs. Periodic
+ * timers fire once per elapsed period. The queue is reordered once at the end.
+ */
+void timer_advance(uint64_t ticks);
+
+/**
+ * timer_advance_on - Move the tick counter of a timer base forward
+ * @base: Timer base owned by the calling thread
+ * @ticks: Number of ticks elapsed since the last tick was processed
+ */
+void timer_advance_on(struct timer_base *base, uint64_t ticks);
+
+/**
+ * timer_next_expiry - Get the number of ticks until the next timer fires
+ *
+ * Lets a tickless caller sleep for the returned number of ticks and then
+ * catch up with timer_advance(). With the timing wheel the result may be
+ * earlier than the real deadline, when a wheel level has to cascade first.
+ *
+ * Return: ticks until the earliest deadline (at least 1), or TIMER_NO_EXPIRY
+ * if no timer is armed
+ */
+uint64_t timer_next_expiry(void);
+
+/**
+ * timer_next_expiry_on - Get the number of ticks until a timer of a base fires
+ * @base: Timer base owned by the calling thread
+ *
+ * Return: ticks until the earliest deadline (at least 1), or TIMER_NO_EXPIRY
+ * if no timer is armed
+ */
+uint64_t timer_next_expiry_on(struct timer_base *base);
+
+#ifdef TIMER_STATS
+/**
+ * timer_get_stats - Read the statistics counters of the global timer base
+ * @stats: Pointer to store the counters
+ *
+ * The heap depth is tracked by the priority queue itself, see PQ_STATS.
+ */
+void timer_get_stats(struct timer_stats *stats);
+
+/**
+ * timer_get_stats_on - Read the statistics counters of a timer base
+ * @base: Timer base, may be owned by another thread
+ * @stats: Pointer to store the counters
+ */
+void timer_get_stats_on(struct timer_base *base, struct timer_stats *stats);
+#endif
+
+#ifdef TIMER_USE_DISPATCH
+/**
+ * timer_dispatch_init - Initialize a set of callback workers
+ * @dispatch: Pointer to the dispatch structure
+ * @workers: Array of @count workers
+ * @count: Number of workers, at least one
+ *
+ * Return: 0 on success, -EINVAL on invalid parameters
+ */
+int timer_dispatch_init(struct timer_dispatch *dispatch, struct timer_worker *workers, uint32_t count);
+
+/**
+ * timer_base_set_dispatch - Run the expired callbacks of a base on workers
+ * @base: Timer base owned by the calling thread
+ * @dispatch: Workers to hand expired timers to, NULL to run them inline
+ *
+ * Callbacks of dispatched timers run on the worker threads, concurrently with
+ * each other and with the ticking thread, so they must only use
+ * timer_start_remote() on the base, and only for timers that are not armed.
+ * The callback of a given timer never runs twice at once: a timer expiring
+ * again while its callback is still queued or running is not queued again,
+ * its callback is run once more after the current run returns instead. When
+ * every queue is full, the callback runs inline on the ticking thread.
+ */
+void timer_base_set_dispatch(struct timer_base *base, struct timer_dispatch *dispatch);
+
+/**
+ * timer_dispatch_run - Run one expired timer callback on a worker thread
+ * @dispatch: Pointer to the dispatch structure
+ * @worker: Index of the calling worker
+ *
+ * Takes the oldest timer queued to @worker, or steals one from the other
+ * workers when its own queue is empty. Workers call this in a loop and
+ * sleep or yield when it returns false.
+ *
+ * Return: true if a callback was run, false if no work was found
+ */
+bool timer_dispatch_run(struct timer_dispatch *dispatch, uint32_t worker);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* TIMER_MODULE_H */
 